@@ -0,0 +1,80 @@
+#include "analysis_manager.h"
+
+AnalysisManager::Entry& AnalysisManager::entry(size_t fn) {
+    if (fn >= entries.size()) entries.resize(module.functionCount());
+    if (!entries[fn]) entries[fn].reset(new Entry());
+    Entry& e = *entries[fn];
+    uint32_t revision = module.function(fn).revision;
+    if (e.revision != revision) {
+        e.hasCFG = e.hasLoops = e.hasSymbols = e.hasGlobals = e.hasLiveness = false;
+        e.revision = revision;
+    }
+    return e;
+}
+
+const CFG& AnalysisManager::cfg(size_t fn) {
+    Entry& e = entry(fn);
+    if (e.hasCFG) {
+        ++reuseCount;
+        return e.cfg;
+    }
+    e.cfg.build(module.code(fn), module.function(fn).labelCount);
+    e.hasCFG = true;
+    ++computeCount;
+    return e.cfg;
+}
+
+const LoopInfo& AnalysisManager::loops(size_t fn) {
+    Entry& e = entry(fn);
+    if (e.hasLoops) {
+        ++reuseCount;
+        return e.loops;
+    }
+    e.loops.compute(cfg(fn));
+    e.hasLoops = true;
+    ++computeCount;
+    return e.loops;
+}
+
+const LocalSymbols& AnalysisManager::symbols(size_t fn) {
+    Entry& e = entry(fn);
+    if (e.hasSymbols) {
+        ++reuseCount;
+        return e.symbols;
+    }
+    e.symbols.build(module, fn);
+    e.hasSymbols = true;
+    ++computeCount;
+    return e.symbols;
+}
+
+const LocalSymbols& AnalysisManager::globalSymbols(size_t fn) {
+    Entry& e = entry(fn);
+    if (e.hasGlobals) {
+        ++reuseCount;
+        return e.globals;
+    }
+    e.globals.build(module, fn, &cfg(fn));
+    e.hasGlobals = true;
+    ++computeCount;
+    return e.globals;
+}
+
+const Liveness& AnalysisManager::liveness(size_t fn) {
+    Entry& e = entry(fn);
+    if (e.hasLiveness) {
+        ++reuseCount;
+        return e.live;
+    }
+    e.live.compute(module, fn, cfg(fn), globalSymbols(fn));
+    e.hasLiveness = true;
+    ++computeCount;
+    return e.live;
+}
+
+void AnalysisManager::invalidate(size_t fn) {
+    if (fn < entries.size() && entries[fn]) {
+        Entry& e = *entries[fn];
+        e.hasCFG = e.hasLoops = e.hasSymbols = e.hasGlobals = e.hasLiveness = false;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ANALYSIS_MANAGER_H
+#define ANALYSIS_MANAGER_H
+
+#include "liveness.h"
+#include "loops.h"
+#include <memory>
+#include <vector>
+
+// Per-function cache of the CFG, loop nest, symbol numberings and liveness.
+// Entries are keyed on IRFunction::revision, so any change to a function
+// invalidates them; a returned reference is only good until the function
+// is next modified.
+class AnalysisManager {
+public:
+    explicit AnalysisManager(const IRModule& module) : module(module) {}
+
+    const CFG& cfg(size_t fn);
+    const LoopInfo& loops(size_t fn);
+    const LocalSymbols& symbols(size_t fn);         // every var and temp
+    const LocalSymbols& globalSymbols(size_t fn);   // names live across blocks
+    const Liveness& liveness(size_t fn);            // over globalSymbols(fn)
+    void invalidate(size_t fn);
+
+    size_t computed() const { return computeCount; }
+    size_t reused() const { return reuseCount; }
+
+private:
+    struct Entry {
+        uint32_t revision = 0;
+        bool hasCFG = false;
+        bool hasLoops = false;
+        bool hasSymbols = false;
+        bool hasGlobals = false;
+        bool hasLiveness = false;
+        CFG cfg;
+        LoopInfo loops;
+        LocalSymbols symbols;
+        LocalSymbols globals;
+        Liveness live;
+    };
+
+    const IRModule& module;
+    std::vector<std::unique_ptr<Entry>> entries;
+    size_t computeCount = 0;
+    size_t reuseCount = 0;
+
+    Entry& entry(size_t fn);
+};
+
+#endif
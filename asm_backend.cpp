@@ -0,0 +1,337 @@
+#include "asm_backend.h"
+#include "type_checker.h"
+
+namespace {
+
+const char* const INT_ARGS[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+const size_t INT_ARG_COUNT = 6;
+const size_t FLOAT_ARG_COUNT = 8;
+
+std::string symbol(const BytecodeFunction& f) { return "tac_" + f.name; }
+
+class FunctionWriter {
+public:
+    FunctionWriter(std::ostream& out, const BytecodeVM& vm, size_t fn)
+        : out(out), vm(vm), fn(fn), f(vm.function(fn)) {}
+
+    void write();
+
+private:
+    std::ostream& out;
+    const BytecodeVM& vm;
+    size_t fn;
+    const BytecodeFunction& f;
+
+    std::string label(uint32_t target) const { return ".L" + std::to_string(fn) + "_" + std::to_string(target); }
+    std::string slot(uint32_t s) const { return "QWORD PTR [rbp-" + std::to_string(8 * (s + 1)) + "]"; }
+    std::string mem(uint32_t r) const {
+        uint32_t constants = static_cast<uint32_t>(f.constants.size());
+        if (r < f.constBase) return slot(r);
+        if (r < f.constBase + constants) return "QWORD PTR .LC" + std::to_string(fn) + "_" + std::to_string(r - f.constBase) + "[rip]";
+        return slot(r - constants);
+    }
+    void op(const std::string& text) { out << "\t" << text << "\n"; }
+    void flag(const std::string& setcc) {
+        op(setcc + "\tal");
+        op("movzx\teax, al");
+    }
+    void instruction(const VMInstr& vi);
+};
+
+void FunctionWriter::instruction(const VMInstr& vi) {
+    std::string a = mem(vi.a), b = mem(vi.b), c = mem(vi.c);
+    switch (vi.op) {
+        case VMOp::Mov:
+            op("mov\trax, " + b);
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::AddI:
+        case VMOp::SubI:
+        case VMOp::MulI:
+            op("mov\trax, " + b);
+            op(std::string(vi.op == VMOp::AddI ? "add" : vi.op == VMOp::SubI ? "sub" : "imul") + "\trax, " + c);
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::DivI:
+        case VMOp::ModI: {
+            std::string ok = label(static_cast<uint32_t>(&vi - f.code.data())) + "_div";
+            op("mov\trax, " + b);
+            op("mov\trcx, " + c);
+            op("test\trcx, rcx");
+            op("je\t.Ltac_division_error");
+            op("cmp\trcx, -1");
+            op("jne\t" + ok);
+            op("movabs\trdx, -9223372036854775808");
+            op("cmp\trax, rdx");
+            op("je\t.Ltac_division_error");
+            out << ok << ":\n";
+            op("cqo");
+            op("idiv\trcx");
+            op("mov\t" + a + (vi.op == VMOp::DivI ? ", rax" : ", rdx"));
+            break;
+        }
+        case VMOp::AddF:
+        case VMOp::SubF:
+        case VMOp::MulF:
+        case VMOp::DivF: {
+            static const char* const ops[] = {"addsd", "subsd", "mulsd", "divsd"};
+            op("movsd\txmm0, " + b);
+            op(std::string(ops[static_cast<int>(vi.op) - static_cast<int>(VMOp::AddF)]) + "\txmm0, " + c);
+            op("movsd\t" + a + ", xmm0");
+            break;
+        }
+        case VMOp::EqI:
+        case VMOp::NeI:
+        case VMOp::LtI:
+        case VMOp::LeI: {
+            static const char* const cc[] = {"sete", "setne", "setl", "setle"};
+            op("mov\trax, " + b);
+            op("cmp\trax, " + c);
+            flag(cc[static_cast<int>(vi.op) - static_cast<int>(VMOp::EqI)]);
+            op("mov\t" + a + ", rax");
+            break;
+        }
+        case VMOp::EqF:
+        case VMOp::NeF:
+            op("movsd\txmm0, " + b);
+            op("ucomisd\txmm0, " + c);
+            op(vi.op == VMOp::EqF ? "sete\tal" : "setne\tal");
+            op(vi.op == VMOp::EqF ? "setnp\tcl" : "setp\tcl");
+            op(vi.op == VMOp::EqF ? "and\tal, cl" : "or\tal, cl");
+            op("movzx\teax, al");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::LtF:
+        case VMOp::LeF:
+            op("movsd\txmm0, " + c);
+            op("ucomisd\txmm0, " + b);
+            flag(vi.op == VMOp::LtF ? "seta" : "setae");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::And:
+        case VMOp::Or:
+            op("mov\trax, " + b);
+            op("test\trax, rax");
+            op("setne\tal");
+            op("mov\trcx, " + c);
+            op("test\trcx, rcx");
+            op("setne\tcl");
+            op(vi.op == VMOp::And ? "and\tal, cl" : "or\tal, cl");
+            op("movzx\teax, al");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::Not:
+            op("mov\trax, " + b);
+            op("test\trax, rax");
+            flag("sete");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::NegI:
+            op("mov\trax, " + b);
+            op("neg\trax");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::NegF:
+            op("mov\trax, " + b);
+            op("btc\trax, 63");
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::IntToFloat:
+            op("pxor\txmm0, xmm0");
+            op("cvtsi2sd\txmm0, " + b);
+            op("movsd\t" + a + ", xmm0");
+            break;
+        case VMOp::FloatToInt:
+            op("cvttsd2si\trax, " + b);
+            op("mov\t" + a + ", rax");
+            break;
+        case VMOp::Jump:
+            op("jmp\t" + label(vi.a));
+            break;
+        case VMOp::JumpIfTrue:
+        case VMOp::JumpIfFalse:
+            op("mov\trax, " + b);
+            op("test\trax, rax");
+            op(std::string(vi.op == VMOp::JumpIfTrue ? "jne" : "je") + "\t" + label(vi.a));
+            break;
+        case VMOp::JumpEqI:
+        case VMOp::JumpNeI:
+        case VMOp::JumpLtI:
+        case VMOp::JumpLeI: {
+            static const char* const cc[] = {"je", "jne", "jl", "jle"};
+            op("mov\trax, " + b);
+            op("cmp\trax, " + c);
+            op(std::string(cc[static_cast<int>(vi.op) - static_cast<int>(VMOp::JumpEqI)]) + "\t" + label(vi.a));
+            break;
+        }
+        case VMOp::JumpEqF:
+        case VMOp::JumpNeF: {
+            op("movsd\txmm0, " + b);
+            op("ucomisd\txmm0, " + c);
+            if (vi.op == VMOp::JumpEqF) {
+                std::string skip = label(static_cast<uint32_t>(&vi - f.code.data())) + "_nan";
+                op("jp\t" + skip);
+                op("je\t" + label(vi.a));
+                out << skip << ":\n";
+            } else {
+                op("jp\t" + label(vi.a));
+                op("jne\t" + label(vi.a));
+            }
+            break;
+        }
+        case VMOp::JumpLtF:
+        case VMOp::JumpLeF:
+            op("movsd\txmm0, " + c);
+            op("ucomisd\txmm0, " + b);
+            op(std::string(vi.op == VMOp::JumpLtF ? "ja" : "jae") + "\t" + label(vi.a));
+            break;
+        case VMOp::Call:
+        case VMOp::CallNative: {
+            const BytecodeFunction& callee = vm.function(vi.b);
+            size_t ints = 0, floats = 0;
+            for (size_t p = 0; p < callee.paramTypes.size(); ++p) {
+                std::string arg = mem(vi.c + static_cast<uint32_t>(p));
+                if (callee.paramTypes[p] == T_FLOAT) op("movsd\txmm" + std::to_string(floats++) + ", " + arg);
+                else op(std::string("mov\t") + INT_ARGS[ints++] + ", " + arg);
+            }
+            op("call\t" + symbol(callee));
+            op(callee.returnType == T_FLOAT ? "movsd\t" + a + ", xmm0" : "mov\t" + a + ", rax");
+            break;
+        }
+        case VMOp::Return:
+            op(f.returnType == T_FLOAT ? "movsd\txmm0, " + a : "mov\trax, " + a);
+            op("leave");
+            op("ret");
+            break;
+        case VMOp::ReturnVoid:
+            op("xor\teax, eax");
+            op("leave");
+            op("ret");
+            break;
+        case VMOp::Unlowered:
+            throw AsmException("Cannot compile " + f.name + ": " + f.loweringError);
+    }
+}
+
+void FunctionWriter::write() {
+    size_t ints = 0, floats = 0;
+    for (BasicType t : f.paramTypes) (t == T_FLOAT ? floats : ints)++;
+    if (ints > INT_ARG_COUNT || floats > FLOAT_ARG_COUNT)
+        throw AsmException("Cannot compile " + f.name + ": too many params for registers");
+
+    uint32_t slots = f.frameSize - static_cast<uint32_t>(f.constants.size());
+    uint32_t frameBytes = (8 * slots + 15) & ~15u;
+    std::string name = symbol(f);
+    out << "\t.globl\t" << name << "\n\t.type\t" << name << ", @function\n" << name << ":\n";
+    op("push\trbp");
+    op("mov\trbp, rsp");
+    if (frameBytes) op("sub\trsp, " + std::to_string(frameBytes));
+    ints = floats = 0;
+    for (size_t p = 0; p < f.paramTypes.size(); ++p) {
+        if (f.paramTypes[p] == T_FLOAT) op("movsd\t" + slot(static_cast<uint32_t>(p)) + ", xmm" + std::to_string(floats++));
+        else op("mov\t" + slot(static_cast<uint32_t>(p)) + ", " + INT_ARGS[ints++]);
+    }
+    for (uint32_t s = static_cast<uint32_t>(f.paramTypes.size()); s < f.constBase; ++s) op("mov\t" + slot(s) + ", 0");
+
+    // Only jump targets get labels.
+    std::vector<char> targets(f.code.size() + 1, 0);
+    for (const VMInstr& vi : f.code) {
+        if (vi.op == VMOp::Jump || vi.op == VMOp::JumpIfTrue || vi.op == VMOp::JumpIfFalse ||
+            (vi.op >= VMOp::JumpEqI && vi.op <= VMOp::JumpLeF))
+            targets[vi.a] = 1;
+    }
+    for (size_t i = 0; i < f.code.size(); ++i) {
+        if (targets[i]) out << label(static_cast<uint32_t>(i)) << ":\n";
+        instruction(f.code[i]);
+    }
+    out << "\t.size\t" << name << ", .-" << name << "\n";
+
+    if (!f.constants.empty()) {
+        out << "\t.section\t.rodata\n\t.align\t8\n";
+        for (size_t k = 0; k < f.constants.size(); ++k) {
+            out << ".LC" << fn << "_" << k << ":\n\t.quad\t" << f.constants[k].i << "\n";
+        }
+        out << "\t.text\n";
+    }
+    out << "\n";
+}
+
+}
+
+void AsmBackend::emit(std::ostream& out, size_t entry) const {
+    out << "\t.intel_syntax noprefix\n\t.text\n\n";
+    for (size_t fn = 0; fn < vm.functionCount(); ++fn) FunctionWriter(out, vm, fn).write();
+
+    out << ".Ltac_division_error:\n"
+        << "\tlea\trdi, .Ltac_division_message[rip]\n"
+        << "\tcall\tputs@PLT\n"
+        << "\tmov\tedi, 1\n"
+        << "\tcall\texit@PLT\n\n";
+    emitMain(out, entry);
+
+    out << "\t.section\t.rodata\n"
+        << ".Ltac_division_message:\n\t.string\t\"integer division error\"\n"
+        << ".Ltac_usage:\n\t.string\t\"usage: " << vm.function(entry).name;
+    for (BasicType t : vm.function(entry).paramTypes) out << " <" << basicTypeToStr(t) << ">";
+    out << "\"\n"
+        << ".Ltac_int_format:\n\t.string\t\"%ld\\n\"\n"
+        << ".Ltac_float_format:\n\t.string\t\"%.17g\\n\"\n"
+        << ".Ltac_true:\n\t.string\t\"true\"\n"
+        << ".Ltac_false:\n\t.string\t\"false\"\n"
+        << "\t.section\t.note.GNU-stack,\"\",@progbits\n";
+}
+
+// main(argc, argv): ints are parsed with strtoll and floats with strtod;
+// a bool is true when spelled `true` or as a nonzero int, so true/false and
+// 1/0 both work. The result is printed as the VM's --run would.
+void AsmBackend::emitMain(std::ostream& out, size_t entry) const {
+    const BytecodeFunction& f = vm.function(entry);
+    size_t params = f.paramTypes.size();
+    uint32_t frameBytes = static_cast<uint32_t>((8 * params + 15) & ~static_cast<size_t>(15));
+    auto arg = [](size_t p) { return "QWORD PTR [rbp-" + std::to_string(24 + 8 * p) + "]"; };
+
+    out << "\t.globl\tmain\n\t.type\tmain, @function\nmain:\n"
+        << "\tpush\trbp\n\tmov\trbp, rsp\n\tpush\trbx\n\tpush\tr12\n";
+    if (frameBytes) out << "\tsub\trsp, " << frameBytes << "\n";
+    out << "\tcmp\tedi, " << params + 1 << "\n\tjne\t.Ltac_main_usage\n\tmov\trbx, rsi\n";
+    for (size_t p = 0; p < params; ++p) {
+        out << "\tmov\trdi, QWORD PTR [rbx+" << 8 * (p + 1) << "]\n\txor\tesi, esi\n";
+        if (f.paramTypes[p] == T_FLOAT) {
+            out << "\tcall\tstrtod@PLT\n\tmovsd\t" << arg(p) << ", xmm0\n";
+        } else if (f.paramTypes[p] == T_BOOL) {
+            // 116 is 't': `true` and `t...` skip the strtoll.
+            std::string parsed = ".Ltac_main_bool" + std::to_string(p);
+            out << "\tmov\teax, 1\n\tcmp\tBYTE PTR [rdi], 116\n\tje\t" << parsed << "\n"
+                << "\tmov\tedx, 10\n\tcall\tstrtoll@PLT\n\ttest\trax, rax\n\tsetne\tal\n\tmovzx\teax, al\n"
+                << parsed << ":\n\tmov\t" << arg(p) << ", rax\n";
+        } else {
+            out << "\tmov\tedx, 10\n\tcall\tstrtoll@PLT\n\tmov\t" << arg(p) << ", rax\n";
+        }
+    }
+    size_t ints = 0, floats = 0;
+    for (size_t p = 0; p < params; ++p) {
+        if (f.paramTypes[p] == T_FLOAT) out << "\tmovsd\txmm" << floats++ << ", " << arg(p) << "\n";
+        else out << "\tmov\t" << INT_ARGS[ints++] << ", " << arg(p) << "\n";
+    }
+    out << "\tcall\t" << symbol(f) << "\n";
+    switch (f.returnType) {
+        case T_FLOAT:
+            out << "\tlea\trdi, .Ltac_float_format[rip]\n\tmov\teax, 1\n\tcall\tprintf@PLT\n";
+            break;
+        case T_BOOL:
+            out << "\tlea\trdi, .Ltac_false[rip]\n\tlea\trcx, .Ltac_true[rip]\n\ttest\trax, rax\n"
+                << "\tcmovne\trdi, rcx\n\tcall\tputs@PLT\n";
+            break;
+        case T_VOID:
+            break;
+        default:
+            out << "\tmov\trsi, rax\n\tlea\trdi, .Ltac_int_format[rip]\n\txor\teax, eax\n\tcall\tprintf@PLT\n";
+            break;
+    }
+    out << "\txor\teax, eax\n"
+        << ".Ltac_main_exit:\n"
+        << "\tlea\trsp, [rbp-16]\n\tpop\tr12\n\tpop\trbx\n\tpop\trbp\n\tret\n"
+        << ".Ltac_main_usage:\n"
+        << "\tlea\trdi, .Ltac_usage[rip]\n\tcall\tputs@PLT\n\tmov\teax, 2\n\tjmp\t.Ltac_main_exit\n"
+        << "\t.size\tmain, .-main\n\n";
+}
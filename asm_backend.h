@@ -0,0 +1,40 @@
+#ifndef ASM_BACKEND_H
+#define ASM_BACKEND_H
+
+#include "bytecode_vm.h"
+#include <exception>
+#include <iostream>
+#include <string>
+
+class AsmException : public std::exception
+{
+    std::string message;
+public:
+    explicit AsmException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// Ahead-of-time x86-64 backend: GNU assembler text (Intel syntax, System V,
+// position independent) for every function of a lowered module, plus a C
+// `main` that parses the entry function's arguments from argv, calls it and
+// prints the result. Build with `cc out.s -o prog`.
+//
+// Code follows the JIT's shape: each register has a stack slot in a frame
+// sized from the function's vars, temps and outgoing arguments, constants
+// live in .rodata, ints go through rax/rcx and floats through SSE2.
+// Functions are emitted as `tac_<name>` so they cannot clash with libc.
+// Integer division errors print a message and exit with status 1. As in
+// the JIT, params beyond the System V argument registers are rejected.
+class AsmBackend {
+public:
+    explicit AsmBackend(const BytecodeVM& vm) : vm(vm) {}
+
+    void emit(std::ostream& out, size_t entry) const;
+
+private:
+    const BytecodeVM& vm;
+
+    void emitMain(std::ostream& out, size_t entry) const;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "batch.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <numeric>
+
+// Kernels only touch row r of each column, but a destination column may be
+// a source too (a = a + b), so the compiler must be told the loop carries
+// no dependence before it vectorizes without a runtime overlap check.
+#if defined(__clang__)
+#define BATCH_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define BATCH_IVDEP _Pragma("GCC ivdep")
+#else
+#define BATCH_IVDEP
+#endif
+
+namespace {
+
+const size_t N = BatchExecutor::CHUNK_ROWS;
+
+// Runs body(row) for each selected row, or for the whole chunk when the
+// selection covers it. A full chunk has a fixed trip count, which is what
+// lets -O2 vectorize the loop; only the last, partial chunk of a run takes
+// the variable-length one.
+template <typename Body>
+inline void forRows(const std::vector<uint32_t>& sel, size_t chunkRows, Body body) {
+    if (sel.size() == N) {
+        BATCH_IVDEP
+        for (size_t r = 0; r < N; ++r) body(r);
+    } else if (sel.size() == chunkRows) {
+        for (size_t r = 0; r < chunkRows; ++r) body(r);
+    } else {
+        for (uint32_t r : sel) body(r);
+    }
+}
+
+// Moves the rows where cond holds from `sel` to the end of `out`, without
+// branching on the condition.
+template <typename Cond>
+inline void split(std::vector<uint32_t>& sel, std::vector<uint32_t>& out, Cond cond) {
+    size_t base = out.size();
+    out.resize(base + sel.size());
+    size_t taken = base, kept = 0;
+    for (uint32_t r : sel) {
+        bool t = cond(r);
+        out[taken] = r;
+        sel[kept] = r;
+        taken += t;
+        kept += !t;
+    }
+    out.resize(taken);
+    sel.resize(kept);
+}
+
+inline bool divisionError(int64_t a, int64_t b) {
+    return b == 0 || (a == LLONG_MIN && b == -1);
+}
+
+VMSlot readSlot(const BatchColumn& column, size_t row, BasicType type) {
+    VMSlot slot;
+    if (column.type == T_FLOAT) {
+        double d = static_cast<const double*>(column.data)[row];
+        if (type == T_FLOAT) slot.f = d;
+        else slot.i = floatToInt(d);
+    } else {
+        int64_t i = column.type == T_BOOL ? static_cast<const bool*>(column.data)[row]
+                                          : static_cast<const int64_t*>(column.data)[row];
+        if (type == T_FLOAT) slot.f = static_cast<double>(i);
+        else slot.i = i;
+    }
+    return slot;
+}
+
+void writeSlot(const BatchColumn& column, size_t row, VMSlot slot) {
+    switch (column.type) {
+        case T_FLOAT: static_cast<double*>(column.data)[row] = slot.f; break;
+        case T_BOOL: static_cast<bool*>(column.data)[row] = slot.i != 0; break;
+        default: static_cast<int64_t*>(column.data)[row] = slot.i; break;
+    }
+}
+
+}
+
+void BatchExecutor::fail(uint8_t* failed, uint32_t row, const std::string& message) {
+    failed[row] = 1;
+    if (errorMessage.empty()) errorMessage = message;
+}
+
+size_t BatchExecutor::run(size_t fn, const std::vector<BatchColumn>& inputs, BatchColumn output, size_t rows,
+                          uint8_t* errors) {
+    const BytecodeFunction& f = vm.function(fn);
+    if (inputs.size() != f.paramTypes.size()) {
+        throw VMException(f.name + " takes " + std::to_string(f.paramTypes.size()) + " columns, got " +
+                          std::to_string(inputs.size()));
+    }
+    for (const BatchColumn& column : inputs) {
+        if (column.type != T_INT && column.type != T_FLOAT && column.type != T_BOOL)
+            throw VMException("Batch columns must be int, float or bool");
+    }
+    if (f.returnType != T_VOID && output.type != f.returnType)
+        throw VMException("Output column of " + f.name + " must be " + basicTypeToStr(f.returnType));
+
+    errorMessage.clear();
+    std::vector<VMSlot>& frame = activations[0].frame;
+    frame.resize(static_cast<size_t>(f.frameSize) * N);
+    std::vector<VMSlot> result(N);
+    std::vector<uint8_t> failed(N);
+    size_t failures = 0;
+    for (size_t start = 0; start < rows; start += N) {
+        size_t count = std::min(N, rows - start);
+        for (size_t p = 0; p < inputs.size(); ++p) {
+            VMSlot* column = frame.data() + p * N;
+            for (size_t r = 0; r < count; ++r) column[r] = readSlot(inputs[p], start + r, f.paramTypes[p]);
+        }
+        std::vector<uint32_t>& sel = activations[0].rows;
+        sel.resize(count);
+        std::iota(sel.begin(), sel.end(), 0);
+        std::fill(failed.begin(), failed.end(), 0);
+        execute(fn, 0, count, result.data(), failed.data());
+
+        for (size_t r = 0; r < count; ++r) {
+            if (failed[r]) {
+                if (!errors) throw VMException(errorMessage + " at row " + std::to_string(start + r));
+                ++failures;
+            } else if (f.returnType != T_VOID) {
+                writeSlot(output, start + r, result[r]);
+            }
+            if (errors) errors[start + r] = failed[r];
+        }
+    }
+    return failures;
+}
+
+// Runs fn for activations[depth].rows of a chunk whose params are already
+// in the activation's frame (one column of N slots per register) and leaves
+// each row's return value in result[row].
+void BatchExecutor::execute(size_t fn, unsigned depth, size_t chunkRows, VMSlot* result, uint8_t* failed) {
+    const BytecodeFunction& f = vm.function(fn);
+    Activation& act = activations[depth];
+    VMSlot* frame = act.frame.data();
+    std::vector<uint32_t>& sel = act.sel;
+    std::vector<uint32_t>& taken = act.taken;
+    for (size_t reg = f.paramTypes.size(); reg < f.constBase; ++reg) {
+        VMSlot* column = frame + reg * N;
+        forRows(act.rows, chunkRows, [&](size_t r) { column[r].i = 0; });
+    }
+    for (size_t k = 0; k < f.constants.size(); ++k) {
+        VMSlot* column = frame + (f.constBase + k) * N;
+        VMSlot value = f.constants[k];
+        forRows(act.rows, chunkRows, [&](size_t r) { column[r] = value; });
+    }
+
+    // Rows waiting at each instruction; the lowest one runs next.
+    std::vector<std::vector<uint32_t>>& pending = act.pending;
+    std::vector<uint32_t>& waiting = act.waiting;
+    if (pending.size() < f.code.size()) pending.resize(f.code.size());
+    waiting.clear();
+    auto schedule = [&](uint32_t pc, std::vector<uint32_t>& rows) {
+        if (rows.empty()) return;
+        std::vector<uint32_t>& at = pending[pc];
+        if (at.empty()) {
+            at.swap(rows);
+            waiting.push_back(pc);
+            std::push_heap(waiting.begin(), waiting.end(), std::greater<uint32_t>());
+        } else {
+            at.insert(at.end(), rows.begin(), rows.end());
+        }
+        rows.clear();
+    };
+    schedule(0, act.rows);
+
+    while (!waiting.empty()) {
+        std::pop_heap(waiting.begin(), waiting.end(), std::greater<uint32_t>());
+        uint32_t pc = waiting.back();
+        waiting.pop_back();
+        sel.clear();
+        sel.swap(pending[pc]);
+
+        while (!sel.empty()) {
+            const VMInstr& vi = f.code[pc];
+#define COL(x) (frame + static_cast<size_t>(vi.x) * N)
+#define KERNEL(expr) \
+    { \
+        VMSlot* A = COL(a); \
+        const VMSlot* B = COL(b); \
+        const VMSlot* C = COL(c); \
+        (void)C; \
+        forRows(sel, chunkRows, [&](size_t r) { expr; }); \
+        ++pc; \
+        break; \
+    }
+#define BRANCH(cond) \
+    { \
+        const VMSlot* B = COL(b); \
+        const VMSlot* C = COL(c); \
+        (void)B; \
+        (void)C; \
+        taken.clear(); \
+        split(sel, taken, [&](uint32_t r) { return static_cast<bool>(cond); }); \
+        schedule(vi.a, taken); \
+        schedule(pc + 1, sel); \
+        break; \
+    }
+            switch (vi.op) {
+                // Registers are copied as their integer bits, which moves
+                // floats unchanged and, unlike a union copy, vectorizes.
+                case VMOp::Mov: KERNEL(A[r].i = B[r].i)
+                case VMOp::AddI: KERNEL(A[r].i = static_cast<int64_t>(static_cast<uint64_t>(B[r].i) + static_cast<uint64_t>(C[r].i)))
+                case VMOp::SubI: KERNEL(A[r].i = static_cast<int64_t>(static_cast<uint64_t>(B[r].i) - static_cast<uint64_t>(C[r].i)))
+                case VMOp::MulI: KERNEL(A[r].i = static_cast<int64_t>(static_cast<uint64_t>(B[r].i) * static_cast<uint64_t>(C[r].i)))
+                case VMOp::DivI:
+                case VMOp::ModI: {
+                    const VMSlot* dividend = COL(b);
+                    const VMSlot* divisor = COL(c);
+                    taken.clear();
+                    split(sel, taken, [&](uint32_t r) { return divisionError(dividend[r].i, divisor[r].i); });
+                    for (uint32_t r : taken) fail(failed, r, "Integer division error in " + f.name);
+                    if (vi.op == VMOp::DivI) KERNEL(A[r].i = B[r].i / C[r].i)
+                    KERNEL(A[r].i = B[r].i % C[r].i)
+                }
+                case VMOp::AddF: KERNEL(A[r].f = B[r].f + C[r].f)
+                case VMOp::SubF: KERNEL(A[r].f = B[r].f - C[r].f)
+                case VMOp::MulF: KERNEL(A[r].f = B[r].f * C[r].f)
+                case VMOp::DivF: KERNEL(A[r].f = B[r].f / C[r].f)
+                case VMOp::EqI: KERNEL(A[r].i = B[r].i == C[r].i)
+                case VMOp::NeI: KERNEL(A[r].i = B[r].i != C[r].i)
+                case VMOp::LtI: KERNEL(A[r].i = B[r].i < C[r].i)
+                case VMOp::LeI: KERNEL(A[r].i = B[r].i <= C[r].i)
+                case VMOp::EqF: KERNEL(A[r].i = B[r].f == C[r].f)
+                case VMOp::NeF: KERNEL(A[r].i = B[r].f != C[r].f)
+                case VMOp::LtF: KERNEL(A[r].i = B[r].f < C[r].f)
+                case VMOp::LeF: KERNEL(A[r].i = B[r].f <= C[r].f)
+                // Both operands are already evaluated, so no short circuit.
+                case VMOp::And: KERNEL(A[r].i = (B[r].i != 0) & (C[r].i != 0))
+                case VMOp::Or: KERNEL(A[r].i = (B[r].i != 0) | (C[r].i != 0))
+                case VMOp::Not: KERNEL(A[r].i = B[r].i == 0)
+                case VMOp::NegI: KERNEL(A[r].i = static_cast<int64_t>(0 - static_cast<uint64_t>(B[r].i)))
+                case VMOp::NegF: KERNEL(A[r].f = -B[r].f)
+                case VMOp::IntToFloat: KERNEL(A[r].f = static_cast<double>(B[r].i))
+                case VMOp::FloatToInt: KERNEL(A[r].i = floatToInt(B[r].f))
+                case VMOp::Jump:
+                    schedule(vi.a, sel);
+                    break;
+                case VMOp::JumpIfTrue: BRANCH(B[r].i)
+                case VMOp::JumpIfFalse: BRANCH(!B[r].i)
+                case VMOp::JumpEqI: BRANCH(B[r].i == C[r].i)
+                case VMOp::JumpNeI: BRANCH(B[r].i != C[r].i)
+                case VMOp::JumpLtI: BRANCH(B[r].i < C[r].i)
+                case VMOp::JumpLeI: BRANCH(B[r].i <= C[r].i)
+                case VMOp::JumpEqF: BRANCH(B[r].f == C[r].f)
+                case VMOp::JumpNeF: BRANCH(B[r].f != C[r].f)
+                case VMOp::JumpLtF: BRANCH(B[r].f < C[r].f)
+                case VMOp::JumpLeF: BRANCH(B[r].f <= C[r].f)
+                case VMOp::Call:
+                case VMOp::CallNative: {
+                    const BytecodeFunction& callee = vm.function(vi.b);
+                    VMSlot* A = COL(a);
+                    if (depth >= MAX_BATCH_DEPTH) {
+                        // Deep recursion finishes row by row in the VM.
+                        std::vector<Value> args(callee.paramTypes.size());
+                        for (uint32_t r : sel) {
+                            for (size_t p = 0; p < args.size(); ++p)
+                                args[p] = fromSlot(frame[(vi.c + p) * N + r], callee.paramTypes[p]);
+                            try {
+                                Value v = vm.call(vi.b, args);
+                                if (callee.returnType != T_VOID) A[r] = toSlot(v, callee.returnType);
+                                else A[r].i = 0;
+                            } catch (const VMException& e) {
+                                fail(failed, r, e.what());
+                            }
+                        }
+                    } else {
+                        Activation& inner = activations[depth + 1];
+                        size_t frameSlots = static_cast<size_t>(callee.frameSize) * N;
+                        if (inner.frame.size() < frameSlots) inner.frame.resize(frameSlots);
+                        inner.returned.resize(N);
+                        for (size_t p = 0; p < callee.paramTypes.size(); ++p) {
+                            const VMSlot* from = frame + (vi.c + p) * N;
+                            VMSlot* to = inner.frame.data() + p * N;
+                            forRows(sel, chunkRows, [&](size_t r) { to[r] = from[r]; });
+                        }
+                        inner.rows = sel;
+                        const VMSlot* returned = inner.returned.data();
+                        execute(vi.b, depth + 1, chunkRows, inner.returned.data(), failed);
+                        forRows(sel, chunkRows, [&](size_t r) { A[r] = returned[r]; });
+                    }
+                    taken.clear();
+                    split(sel, taken, [&](uint32_t r) { return failed[r] != 0; });
+                    ++pc;
+                    break;
+                }
+                case VMOp::Return: {
+                    const VMSlot* A = COL(a);
+                    forRows(sel, chunkRows, [&](size_t r) { result[r] = A[r]; });
+                    sel.clear();
+                    break;
+                }
+                case VMOp::ReturnVoid:
+                    forRows(sel, chunkRows, [&](size_t r) { result[r].i = 0; });
+                    sel.clear();
+                    break;
+                case VMOp::Unlowered:
+                    for (uint32_t r : sel) fail(failed, r, f.loweringError);
+                    sel.clear();
+                    break;
+            }
+#undef COL
+#undef KERNEL
+#undef BRANCH
+        }
+    }
+}
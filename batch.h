@@ -0,0 +1,66 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "bytecode_vm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One contiguous column of row values: int64_t for ints, double for
+// floats and bool for bools.
+struct BatchColumn {
+    BasicType type;
+    void* data;
+};
+
+// Vectorized execution of one lowered function over many rows. Rows go
+// through in chunks; every register becomes a column of CHUNK_ROWS values
+// and each instruction runs as a loop over the chunk. Rows that are all at
+// the same instruction share a selection vector: a conditional branch
+// splits it into taken and not-taken rows, and rows meet again where
+// paths join, since the lowest pending instruction always runs next. While
+// a selection covers a whole chunk the loops run densely over CHUNK_ROWS
+// rows. At -O2 GCC then vectorizes the moves and the int add, subtract and
+// negate and float arithmetic kernels for baseline x86-64; from x86-64-v2
+// on, the comparison and logic kernels too. Division and the int/float
+// conversions stay scalar, and partial selections go row by row.
+//
+// Calls run the callee as a batch over the calling rows (recursion past
+// MAX_BATCH_DEPTH falls back to the scalar VM). A row that raises an
+// integer division error or overflows the stack stops there; it is flagged
+// in `errors` when that is given and otherwise fails the run.
+class BatchExecutor {
+public:
+    static const size_t CHUNK_ROWS = 1024;
+    static const unsigned MAX_BATCH_DEPTH = 64;
+
+    explicit BatchExecutor(BytecodeVM& vm) : vm(vm), activations(MAX_BATCH_DEPTH + 1) {}
+
+    // inputs[i] holds param i; the output column has the return type and is
+    // left alone for void functions. Returns the number of failed rows.
+    size_t run(size_t fn, const std::vector<BatchColumn>& inputs, BatchColumn output, size_t rows,
+               uint8_t* errors = nullptr);
+
+    const std::string& firstError() const { return errorMessage; }
+
+private:
+    // Buffers for one call depth, kept across calls so a recursive batch
+    // costs in proportion to its rows rather than the chunk size.
+    struct Activation {
+        std::vector<VMSlot> frame;
+        std::vector<VMSlot> returned;
+        std::vector<uint32_t> rows;
+        std::vector<std::vector<uint32_t>> pending;  // rows waiting at each pc
+        std::vector<uint32_t> waiting;               // min-heap of those pcs
+        std::vector<uint32_t> sel, taken;
+    };
+
+    BytecodeVM& vm;
+    std::string errorMessage;
+    std::vector<Activation> activations;
+
+    void execute(size_t fn, unsigned depth, size_t chunkRows, VMSlot* result, uint8_t* failed);
+    void fail(uint8_t* failed, uint32_t row, const std::string& message);
+};
+
+#endif
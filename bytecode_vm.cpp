@@ -0,0 +1,773 @@
+#include "bytecode_vm.h"
+#include "ir_generator.h"
+#include "memo_cache.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+const char* vmOpName(VMOp op) {
+    static const char* const names[] = {
+        "mov",
+        "addi", "subi", "muli", "divi", "modi",
+        "addf", "subf", "mulf", "divf",
+        "eqi", "nei", "lti", "lei",
+        "eqf", "nef", "ltf", "lef",
+        "and", "or", "not", "negi", "negf",
+        "i2f", "f2i",
+        "jmp",
+        "jt", "jf",
+        "jeqi", "jnei", "jlti", "jlei",
+        "jeqf", "jnef", "jltf", "jlef",
+        "call",
+        "calln",
+        "ret",
+        "retv",
+        "unlowered"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(VMOp::Unlowered) + 1,
+                  "vmOpName out of step with VMOp");
+    return names[static_cast<size_t>(op)];
+}
+
+namespace {
+
+// Register types: everything that is not a float is held as an int.
+bool isFloat(BasicType t) { return t == T_FLOAT; }
+
+class FunctionLowering {
+public:
+    FunctionLowering(const IRModule& module, size_t fn, const std::unordered_map<uint32_t, size_t>& index,
+                     const std::vector<BytecodeFunction>& functions)
+        : module(module), fn(fn), index(index), functions(functions), pool(module.symbols()) {}
+
+    void lower(BytecodeFunction& out);
+
+private:
+    const IRModule& module;
+    size_t fn;
+    const std::unordered_map<uint32_t, size_t>& index;
+    const std::vector<BytecodeFunction>& functions;
+    const IRSymbols& pool;
+
+    std::unordered_map<uint32_t, uint32_t> registers;       // operand bits -> register
+    std::vector<BasicType> registerTypes;
+    std::unordered_map<uint64_t, uint32_t> constantSlots;   // constant and type -> index
+    std::vector<VMSlot> constants;
+    std::vector<bool> constantIsFloat;
+    std::vector<VMInstr> code;
+    std::vector<size_t> argumentFixups;                     // Movs into the outgoing area
+    std::vector<size_t> callFixups;
+    std::vector<size_t> jumpFixups;
+    uint32_t scratch = 0;
+    uint32_t nextScratch = 0;
+    static const uint32_t SCRATCH_COUNT = 3;
+
+    [[noreturn]] void unsupported(const std::string& what) const {
+        throw VMException("Cannot lower " + module.functionName(fn) + " to bytecode: " + what);
+    }
+
+    uint32_t addRegister(Operand o, BasicType t) {
+        if (t == T_STRING) unsupported("string value " + pool.render(o));
+        auto inserted = registers.insert({o.bits, static_cast<uint32_t>(registerTypes.size())});
+        if (inserted.second) registerTypes.push_back(t);
+        return inserted.first->second;
+    }
+
+    BasicType typeOf(Operand o) const {
+        if (o.isConst()) {
+            BasicType t = pool.constant(o.index()).type;
+            if (t == T_STRING) unsupported("string constant " + pool.render(o));
+            return t;
+        }
+        return registerTypes[registers.at(o.bits)];
+    }
+
+    uint32_t takeScratch() {
+        uint32_t r = scratch + nextScratch;
+        nextScratch = (nextScratch + 1) % SCRATCH_COUNT;
+        return r;
+    }
+
+    void emit(VMOp op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) {
+        code.push_back(VMInstr{op, a, b, c});
+    }
+
+    // Constants live in registers too, already converted to the type the
+    // use wants. Their register numbers are fixed once the frame is laid out.
+    uint32_t constant(Operand o, bool wantFloat) {
+        uint64_t key = (static_cast<uint64_t>(o.index()) << 1) | (wantFloat ? 1 : 0);
+        auto it = constantSlots.find(key);
+        if (it != constantSlots.end()) return CONSTANT_TAG | it->second;
+        const Value& v = pool.constant(o.index());
+        VMSlot slot;
+        if (wantFloat) slot.f = v.type == T_FLOAT ? v.f : static_cast<double>(v.i);
+        else slot.i = v.type == T_FLOAT ? floatToInt(v.f) : v.i;
+        uint32_t k = static_cast<uint32_t>(constants.size());
+        constants.push_back(slot);
+        constantIsFloat.push_back(wantFloat);
+        constantSlots[key] = k;
+        return CONSTANT_TAG | k;
+    }
+
+    // Register holding `o` as a float or int, converting through scratch.
+    uint32_t source(Operand o, bool wantFloat) {
+        if (o.isConst()) {
+            typeOf(o);
+            return constant(o, wantFloat);
+        }
+        uint32_t r = registers.at(o.bits);
+        if (isFloat(registerTypes[r]) == wantFloat) return r;
+        uint32_t s = takeScratch();
+        emit(wantFloat ? VMOp::IntToFloat : VMOp::FloatToInt, s, r);
+        return s;
+    }
+
+    // Emits `op` producing a value of the given kind into `result`.
+    void define(Operand result, bool producesFloat, VMOp op, uint32_t b, uint32_t c = 0) {
+        uint32_t r = registers.at(result.bits);
+        if (isFloat(registerTypes[r]) == producesFloat) {
+            emit(op, r, b, c);
+            return;
+        }
+        uint32_t s = takeScratch();
+        emit(op, s, b, c);
+        emit(producesFloat ? VMOp::FloatToInt : VMOp::IntToFloat, r, s);
+    }
+
+    void comparison(Opcode cmp, bool asFloat, uint32_t& a, uint32_t& b, VMOp& op, bool jump);
+
+    static const uint32_t CONSTANT_TAG = 0x80000000u;
+    uint32_t resolve(uint32_t r, uint32_t constBase) const {
+        return (r & CONSTANT_TAG) ? constBase + (r & ~CONSTANT_TAG) : r;
+    }
+};
+
+// Picks the int or float form of a comparison, swapping operands so only
+// ==, !=, < and <= are needed.
+void FunctionLowering::comparison(Opcode cmp, bool asFloat, uint32_t& a, uint32_t& b, VMOp& op, bool jump) {
+    if (cmp == Opcode::Gt || cmp == Opcode::Ge) {
+        std::swap(a, b);
+        cmp = cmp == Opcode::Gt ? Opcode::Lt : Opcode::Le;
+    }
+    int k = cmp == Opcode::Eq ? 0 : cmp == Opcode::Ne ? 1 : cmp == Opcode::Lt ? 2 : 3;
+    VMOp base = jump ? (asFloat ? VMOp::JumpEqF : VMOp::JumpEqI) : (asFloat ? VMOp::EqF : VMOp::EqI);
+    op = static_cast<VMOp>(static_cast<uint8_t>(base) + k);
+}
+
+void FunctionLowering::lower(BytecodeFunction& out) {
+    const IRFunction& f = module.function(fn);
+    if (f.ssa) unsupported("function is in SSA form");
+    Span<const TACInstruction> body = module.code(fn);
+
+    out.name = module.functionName(fn);
+    out.returnType = f.returnType;
+    for (const IRParam& p : module.params(fn)) {
+        addRegister(Operand::var(p.name), p.type);
+        out.paramTypes.push_back(p.type);
+    }
+    for (const auto& instr : body) {
+        if (definesResult(instr)) addRegister(instr.result, instr.valueType());
+    }
+    for (const auto& instr : body) {
+        uint8_t uses = useMask(instr);
+        if ((uses & USE_RESULT) && isSymbol(instr.result)) addRegister(instr.result, T_INT);
+        if ((uses & USE_ARG1) && isSymbol(instr.arg1)) addRegister(instr.arg1, T_INT);
+        if ((uses & USE_ARG2) && isSymbol(instr.arg2)) addRegister(instr.arg2, T_INT);
+    }
+    scratch = static_cast<uint32_t>(registerTypes.size());
+
+    // Each param writes the slot its argument takes in the outgoing area;
+    // a call's frame starts at its first argument.
+    std::vector<uint32_t> argumentSlot(body.size(), 0);
+    std::vector<uint32_t> callSlot(body.size(), 0);
+    std::vector<size_t> pending;
+    uint32_t outgoing = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (body[i].op == Opcode::Param) {
+            argumentSlot[i] = static_cast<uint32_t>(pending.size());
+            pending.push_back(i);
+            outgoing = std::max(outgoing, static_cast<uint32_t>(pending.size()));
+        } else if (body[i].op == Opcode::Call) {
+            int64_t argc = pool.constant(body[i].arg2.index()).i;
+            if (argc < 0 || static_cast<size_t>(argc) > pending.size())
+                unsupported("call to " + pool.name(body[i].arg1.index()) + " without its params");
+            callSlot[i] = static_cast<uint32_t>(pending.size() - argc);
+            pending.resize(pending.size() - argc);
+        }
+    }
+
+    auto calleeOf = [&](const TACInstruction& call) -> size_t {
+        auto it = index.find(call.arg1.index());
+        if (it == index.end()) unsupported("call to undefined function " + pool.name(call.arg1.index()));
+        return it->second;
+    };
+    // Param types of each pending call, found by matching params to calls.
+    std::vector<BasicType> argumentType(body.size(), T_INT);
+    pending.clear();
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (body[i].op == Opcode::Param) {
+            pending.push_back(i);
+        } else if (body[i].op == Opcode::Call) {
+            size_t callee = calleeOf(body[i]);
+            size_t argc = static_cast<size_t>(pool.constant(body[i].arg2.index()).i);
+            if (argc != functions[callee].paramTypes.size())
+                unsupported("call to " + functions[callee].name + " with " + std::to_string(argc) + " arguments");
+            for (size_t j = 0; j < argc; ++j)
+                argumentType[pending[pending.size() - argc + j]] = functions[callee].paramTypes[j];
+            pending.resize(pending.size() - argc);
+        }
+    }
+
+    std::vector<uint32_t> labelPos(f.labelCount, UINT32_MAX);
+    std::vector<uint32_t> tacStart(body.size() + 1);
+    for (size_t i = 0; i < body.size(); ++i) {
+        const TACInstruction& instr = body[i];
+        Opcode op = instr.op;
+        tacStart[i] = static_cast<uint32_t>(code.size());
+        switch (op) {
+            case Opcode::Label:
+                labelPos[instr.result.index()] = static_cast<uint32_t>(code.size());
+                break;
+            case Opcode::Goto:
+                jumpFixups.push_back(code.size());
+                emit(VMOp::Jump, instr.result.index());
+                break;
+            case Opcode::If:
+            case Opcode::IfFalse:
+                jumpFixups.push_back(code.size());
+                emit(op == Opcode::If ? VMOp::JumpIfTrue : VMOp::JumpIfFalse, instr.result.index(),
+                     source(instr.arg1, false));
+                break;
+            case Opcode::Param:
+                argumentFixups.push_back(code.size());
+                emit(VMOp::Mov, argumentSlot[i], source(instr.result, isFloat(argumentType[i])));
+                break;
+            case Opcode::Call: {
+                const BytecodeFunction& callee = functions[calleeOf(instr)];
+                uint32_t target = scratch;
+                bool convert = false;
+                if (!instr.result.empty()) {
+                    target = registers.at(instr.result.bits);
+                    convert = isFloat(registerTypes[target]) != isFloat(callee.returnType);
+                    if (convert) target = takeScratch();
+                }
+                callFixups.push_back(code.size());
+                emit(VMOp::Call, target, static_cast<uint32_t>(calleeOf(instr)), callSlot[i]);
+                if (convert) {
+                    emit(isFloat(callee.returnType) ? VMOp::FloatToInt : VMOp::IntToFloat,
+                         registers.at(instr.result.bits), target);
+                }
+                break;
+            }
+            case Opcode::Return:
+                if (instr.result.empty() || f.returnType == T_VOID) emit(VMOp::ReturnVoid);
+                else emit(VMOp::Return, source(instr.result, isFloat(f.returnType)));
+                break;
+            case Opcode::Copy:
+            case Opcode::Pos: {
+                bool wantFloat = isFloat(typeOf(instr.result));
+                emit(VMOp::Mov, registers.at(instr.result.bits), source(instr.arg1, wantFloat));
+                break;
+            }
+            case Opcode::Neg: {
+                bool fl = isFloat(typeOf(instr.arg1));
+                define(instr.result, fl, fl ? VMOp::NegF : VMOp::NegI, source(instr.arg1, fl));
+                break;
+            }
+            case Opcode::Not:
+                define(instr.result, false, VMOp::Not, source(instr.arg1, false));
+                break;
+            case Opcode::And:
+            case Opcode::Or:
+                define(instr.result, false, op == Opcode::And ? VMOp::And : VMOp::Or,
+                       source(instr.arg1, false), source(instr.arg2, false));
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Mod: {
+                bool fl = isFloat(typeOf(instr.arg1)) || isFloat(typeOf(instr.arg2));
+                if (fl && op == Opcode::Mod) unsupported("float %");
+                int k = static_cast<int>(op) - static_cast<int>(Opcode::Add);
+                VMOp vop = static_cast<VMOp>(static_cast<uint8_t>(fl ? VMOp::AddF : VMOp::AddI) + k);
+                uint32_t a = source(instr.arg1, fl);
+                uint32_t b = source(instr.arg2, fl);
+                define(instr.result, fl, vop, a, b);
+                break;
+            }
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Gt:
+            case Opcode::Le:
+            case Opcode::Ge: {
+                bool fl = isFloat(typeOf(instr.arg1)) || isFloat(typeOf(instr.arg2));
+                uint32_t a = source(instr.arg1, fl);
+                uint32_t b = source(instr.arg2, fl);
+                VMOp vop;
+                comparison(op, fl, a, b, vop, false);
+                define(instr.result, false, vop, a, b);
+                break;
+            }
+            case Opcode::IfEq:
+            case Opcode::IfNe:
+            case Opcode::IfLt:
+            case Opcode::IfGt:
+            case Opcode::IfLe:
+            case Opcode::IfGe: {
+                bool fl = isFloat(typeOf(instr.arg1)) || isFloat(typeOf(instr.arg2));
+                uint32_t a = source(instr.arg1, fl);
+                uint32_t b = source(instr.arg2, fl);
+                Opcode cmp = comparisonOf(op);
+                VMOp vop;
+                if (!(instr.flags & BRANCH_IF_FALSE)) {
+                    comparison(cmp, fl, a, b, vop, true);
+                    jumpFixups.push_back(code.size());
+                    emit(vop, instr.result.index(), a, b);
+                } else if (!fl) {
+                    // !(a < b) is a >= b for ints; NaN rules this out for floats.
+                    static const Opcode inverse[] = {Opcode::Ne, Opcode::Eq, Opcode::Ge, Opcode::Le,
+                                                     Opcode::Gt, Opcode::Lt};
+                    comparison(inverse[static_cast<int>(cmp) - static_cast<int>(Opcode::Eq)], fl, a, b, vop, true);
+                    jumpFixups.push_back(code.size());
+                    emit(vop, instr.result.index(), a, b);
+                } else {
+                    comparison(cmp, fl, a, b, vop, false);
+                    uint32_t s = takeScratch();
+                    emit(vop, s, a, b);
+                    jumpFixups.push_back(code.size());
+                    emit(VMOp::JumpIfFalse, instr.result.index(), s);
+                }
+                break;
+            }
+            case Opcode::Load:
+            case Opcode::Store:
+                unsupported("arrays");
+            case Opcode::Phi:
+                unsupported("phi");
+        }
+    }
+    tacStart[body.size()] = static_cast<uint32_t>(code.size());
+    if (code.empty() || (code.back().op != VMOp::Return && code.back().op != VMOp::ReturnVoid &&
+                         code.back().op != VMOp::Jump) ||
+        std::count(labelPos.begin(), labelPos.end(), static_cast<uint32_t>(code.size()))) {
+        emit(VMOp::ReturnVoid);
+    }
+
+    // Lay out the frame and patch constant, argument and jump operands.
+    uint32_t constBase = scratch + SCRATCH_COUNT;
+    uint32_t outBase = constBase + static_cast<uint32_t>(constants.size());
+    for (VMInstr& vi : code) {
+        switch (vi.op) {
+            case VMOp::Jump: case VMOp::Call: case VMOp::ReturnVoid:
+                break;
+            case VMOp::JumpIfTrue: case VMOp::JumpIfFalse:
+                vi.b = resolve(vi.b, constBase);
+                break;
+            default:
+                vi.a = resolve(vi.a, constBase);
+                vi.b = resolve(vi.b, constBase);
+                vi.c = resolve(vi.c, constBase);
+                break;
+        }
+    }
+    for (size_t at : argumentFixups) code[at].a += outBase;
+    for (size_t at : callFixups) code[at].c += outBase;
+    for (size_t at : jumpFixups) {
+        uint32_t target = labelPos[code[at].a];
+        if (target == UINT32_MAX) unsupported("jump to undefined label L" + std::to_string(code[at].a));
+        code[at].a = target;
+    }
+
+    out.code = std::move(code);
+    out.constBase = constBase;
+    out.constants = std::move(constants);
+    out.constantIsFloat = std::move(constantIsFloat);
+    out.frameSize = outBase + outgoing;
+    out.tacStart = std::move(tacStart);
+}
+
+// Stands in for a function that cannot be lowered, keeping the signature
+// its callers were lowered against.
+BytecodeFunction unlowered(const BytecodeFunction& signature, size_t tacSize, const std::string& error) {
+    BytecodeFunction f;
+    f.name = signature.name;
+    f.paramTypes = signature.paramTypes;
+    f.returnType = signature.returnType;
+    f.code.push_back(VMInstr{VMOp::Unlowered, 0, 0, 0});
+    f.constBase = static_cast<uint32_t>(f.paramTypes.size());
+    f.frameSize = f.constBase;
+    f.tacStart.assign(tacSize + 1, 0);
+    f.loweringError = error;
+    return f;
+}
+
+}
+
+void BytecodeVM::load(const IRModule& module) {
+    functions.clear();
+    functions.resize(module.functionCount());
+    std::unordered_map<uint32_t, size_t> index;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        index[module.function(fn).name] = fn;
+        functions[fn].name = module.functionName(fn);
+        functions[fn].returnType = module.function(fn).returnType;
+        for (const IRParam& p : module.params(fn)) functions[fn].paramTypes.push_back(p.type);
+    }
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        BytecodeFunction lowered;
+        try {
+            FunctionLowering(module, fn, index, functions).lower(lowered);
+        } catch (const VMException& e) {
+            lowered = unlowered(functions[fn], module.code(fn).size(), e.what());
+        }
+        functions[fn] = std::move(lowered);
+    }
+    calls.assign(functions.size(), 0);
+    backEdges.assign(functions.size(), 0);
+    reportedHot.assign(functions.size(), 0);
+    memo = nullptr;
+    memoized.assign(functions.size(), 0);
+    jumpsTaken.clear();
+    for (const auto& f : functions) jumpsTaken.emplace_back(f.code.size(), 0);
+}
+
+void BytecodeVM::setProfiling(bool on) {
+    profiling = on;
+    if (!on) return;
+    std::fill(calls.begin(), calls.end(), 0);
+    std::fill(backEdges.begin(), backEdges.end(), 0);
+    for (auto& counts : jumpsTaken) std::fill(counts.begin(), counts.end(), 0);
+}
+
+void BytecodeVM::setTierListener(VMTierListener* listener, uint64_t threshold) {
+    tier = listener;
+    tierThreshold = threshold;
+    std::fill(reportedHot.begin(), reportedHot.end(), 0);
+    if (listener) return;
+    for (auto& f : functions) {
+        for (VMInstr& vi : f.code) {
+            if (vi.op == VMOp::CallNative) vi.op = VMOp::Call;
+        }
+    }
+}
+
+void BytecodeVM::setMemoCache(MemoCache* cache, const std::vector<bool>& pure) {
+    memo = cache;
+    memoized.assign(functions.size(), 0);
+    for (size_t fn = 0; cache && fn < functions.size() && fn < pure.size(); ++fn) memoized[fn] = pure[fn];
+}
+
+bool BytecodeVM::findFunction(const std::string& name, size_t& fn) const {
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].name == name) {
+            fn = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t BytecodeVM::instructionCount() const {
+    size_t n = 0;
+    for (const auto& f : functions) n += f.code.size();
+    return n;
+}
+
+Value BytecodeVM::call(const std::string& name, const std::vector<Value>& args) {
+    size_t fn;
+    if (!findFunction(name, fn)) throw VMException("No function named " + name);
+    return call(fn, args);
+}
+
+Value BytecodeVM::call(size_t fn, const std::vector<Value>& args) {
+    const BytecodeFunction& f = functions[fn];
+    if (args.size() != f.paramTypes.size()) {
+        throw VMException(f.name + " takes " + std::to_string(f.paramTypes.size()) + " arguments, got " +
+                          std::to_string(args.size()));
+    }
+    if (f.frameSize > stack.size()) throw VMException("Stack overflow calling " + f.name);
+    VMSlot* base = stack.data();
+    for (size_t i = 0; i < args.size(); ++i) base[i] = toSlot(args[i], f.paramTypes[i]);
+    // The key is the arguments as the callee sees them, as for inner calls.
+    std::vector<Value> key;
+    if (memo && memoized[fn] && !profiling) {
+        for (size_t i = 0; i < args.size(); ++i) key.push_back(fromSlot(base[i], f.paramTypes[i]));
+        Value result;
+        if (memo->lookup(f.name, key, result)) return result;
+    }
+    if (tier) countCall(fn);
+    else if (profiling) ++calls[fn];
+    Value result = fromSlot(execute(fn, base), f.returnType);
+    if (memo && memoized[fn] && !profiling) memo->insert(f.name, key, result);
+    return result;
+}
+
+VMSlot toSlot(const Value& v, BasicType type) {
+    if (v.type == T_STRING) throw VMException("String arguments are not supported");
+    VMSlot slot;
+    if (isFloat(type)) slot.f = v.type == T_FLOAT ? v.f : static_cast<double>(v.i);
+    else slot.i = v.type == T_FLOAT ? floatToInt(v.f) : v.i;
+    return slot;
+}
+
+Value fromSlot(VMSlot slot, BasicType type) {
+    switch (type) {
+        case T_FLOAT: return Value::makeFloat(slot.f);
+        case T_BOOL: return Value::makeBool(slot.i != 0);
+        case T_VOID: return Value();
+        default: return Value::makeInt(slot.i);
+    }
+}
+
+namespace {
+
+struct VMFrame {
+    const VMInstr* resume;
+    VMSlot* base;
+    const BytecodeFunction* function;
+    uint32_t result;
+};
+
+// A memoized call under way; its result is stored when the frame at
+// `depth` returns.
+struct PendingMemo {
+    size_t depth;
+    std::vector<Value> args;
+};
+
+// Answers a call from the cache, or queues its key for the result to be
+// stored under when the callee's frame at `depth` returns. Kept out of the
+// interpreter loop, whose computed gotos would skip the key's destructor.
+bool memoLookup(MemoCache& memo, const BytecodeFunction& callee, const VMSlot* args, size_t depth,
+                std::vector<PendingMemo>& pending, VMSlot& result) {
+    std::vector<Value> key(callee.paramTypes.size());
+    for (size_t i = 0; i < key.size(); ++i) key[i] = fromSlot(args[i], callee.paramTypes[i]);
+    Value cached;
+    if (memo.lookup(callee.name, key, cached)) {
+        result = toSlot(cached, callee.returnType);
+        return true;
+    }
+    pending.push_back(PendingMemo{depth, std::move(key)});
+    return false;
+}
+
+// Copies in the constants and clears locals, so unassigned names read 0.
+inline void enterFrame(const BytecodeFunction& f, VMSlot* base) {
+    std::fill(base + f.paramTypes.size(), base + f.constBase, VMSlot{0});
+    std::copy(f.constants.begin(), f.constants.end(), base + f.constBase);
+}
+
+}
+
+VMSlot BytecodeVM::execute(size_t fn, VMSlot* base) {
+    if (profiling) return run<false, true, false>(fn, base);
+    if (tier) return memo ? run<true, false, true>(fn, base) : run<true, false, false>(fn, base);
+    return memo ? run<false, false, true>(fn, base) : run<false, false, false>(fn, base);
+}
+
+// The interpreter loop. The tiered instantiation also counts calls and
+// backward jumps, and patches call sites once their callee is native; the
+// profiled one counts calls and taken jumps; the memoized one answers
+// pure calls from the cache when it can.
+template <bool Tiered, bool Profiled, bool Memoized>
+VMSlot BytecodeVM::run(size_t fn, VMSlot* base) {
+    const BytecodeFunction* f = &functions[fn];
+    const VMInstr* pc = f->code.data();
+    uint64_t* takenHere = Profiled ? jumpsTaken[fn].data() : nullptr;
+    VMSlot* const stackEnd = stack.data() + stack.size();
+    std::vector<VMFrame> frames;
+    std::vector<PendingMemo> pending;
+    VMSlot value = {0};
+    enterFrame(*f, base);
+
+#define R(x) base[pc->x]
+// Taken branches to an earlier instruction are loop back edges.
+#define VM_BRANCH(taken) \
+    { \
+        bool jump = (taken); \
+        const VMInstr* next = jump ? f->code.data() + pc->a : pc + 1; \
+        if (Tiered && next <= pc) countBackEdge(static_cast<size_t>(f - functions.data())); \
+        if (Profiled && jump) ++takenHere[pc - f->code.data()]; \
+        pc = next; \
+    } \
+    VM_NEXT()
+#ifdef VM_COMPUTED_GOTO
+    static void* const labels[] = {
+        &&op_Mov,
+        &&op_AddI, &&op_SubI, &&op_MulI, &&op_DivI, &&op_ModI,
+        &&op_AddF, &&op_SubF, &&op_MulF, &&op_DivF,
+        &&op_EqI, &&op_NeI, &&op_LtI, &&op_LeI,
+        &&op_EqF, &&op_NeF, &&op_LtF, &&op_LeF,
+        &&op_And, &&op_Or, &&op_Not, &&op_NegI, &&op_NegF,
+        &&op_IntToFloat, &&op_FloatToInt,
+        &&op_Jump,
+        &&op_JumpIfTrue, &&op_JumpIfFalse,
+        &&op_JumpEqI, &&op_JumpNeI, &&op_JumpLtI, &&op_JumpLeI,
+        &&op_JumpEqF, &&op_JumpNeF, &&op_JumpLtF, &&op_JumpLeF,
+        &&op_Call, &&op_CallNative,
+        &&op_Return,
+        &&op_ReturnVoid,
+        &&op_Unlowered
+    };
+    static_assert(sizeof(labels) / sizeof(labels[0]) == static_cast<size_t>(VMOp::Unlowered) + 1,
+                  "dispatch table out of step with VMOp");
+#define VM_OP(name) op_##name:
+#define VM_NEXT() goto *labels[static_cast<size_t>(pc->op)]
+    VM_NEXT();
+#else
+#define VM_OP(name) case VMOp::name:
+#define VM_NEXT() goto dispatch
+dispatch:
+    switch (pc->op) {
+#endif
+
+    VM_OP(Mov) R(a) = R(b); ++pc; VM_NEXT();
+
+    // Integer arithmetic wraps, as in constant folding.
+    VM_OP(AddI) R(a).i = static_cast<int64_t>(static_cast<uint64_t>(R(b).i) + static_cast<uint64_t>(R(c).i)); ++pc; VM_NEXT();
+    VM_OP(SubI) R(a).i = static_cast<int64_t>(static_cast<uint64_t>(R(b).i) - static_cast<uint64_t>(R(c).i)); ++pc; VM_NEXT();
+    VM_OP(MulI) R(a).i = static_cast<int64_t>(static_cast<uint64_t>(R(b).i) * static_cast<uint64_t>(R(c).i)); ++pc; VM_NEXT();
+    VM_OP(DivI)
+        if (R(c).i == 0 || (R(b).i == LLONG_MIN && R(c).i == -1))
+            throw VMException("Integer division error in " + f->name);
+        R(a).i = R(b).i / R(c).i; ++pc; VM_NEXT();
+    VM_OP(ModI)
+        if (R(c).i == 0 || (R(b).i == LLONG_MIN && R(c).i == -1))
+            throw VMException("Integer division error in " + f->name);
+        R(a).i = R(b).i % R(c).i; ++pc; VM_NEXT();
+    VM_OP(AddF) R(a).f = R(b).f + R(c).f; ++pc; VM_NEXT();
+    VM_OP(SubF) R(a).f = R(b).f - R(c).f; ++pc; VM_NEXT();
+    VM_OP(MulF) R(a).f = R(b).f * R(c).f; ++pc; VM_NEXT();
+    VM_OP(DivF) R(a).f = R(b).f / R(c).f; ++pc; VM_NEXT();
+
+    VM_OP(EqI) R(a).i = R(b).i == R(c).i; ++pc; VM_NEXT();
+    VM_OP(NeI) R(a).i = R(b).i != R(c).i; ++pc; VM_NEXT();
+    VM_OP(LtI) R(a).i = R(b).i < R(c).i; ++pc; VM_NEXT();
+    VM_OP(LeI) R(a).i = R(b).i <= R(c).i; ++pc; VM_NEXT();
+    VM_OP(EqF) R(a).i = R(b).f == R(c).f; ++pc; VM_NEXT();
+    VM_OP(NeF) R(a).i = R(b).f != R(c).f; ++pc; VM_NEXT();
+    VM_OP(LtF) R(a).i = R(b).f < R(c).f; ++pc; VM_NEXT();
+    VM_OP(LeF) R(a).i = R(b).f <= R(c).f; ++pc; VM_NEXT();
+
+    VM_OP(And) R(a).i = R(b).i && R(c).i; ++pc; VM_NEXT();
+    VM_OP(Or) R(a).i = R(b).i || R(c).i; ++pc; VM_NEXT();
+    VM_OP(Not) R(a).i = !R(b).i; ++pc; VM_NEXT();
+    VM_OP(NegI) R(a).i = static_cast<int64_t>(0 - static_cast<uint64_t>(R(b).i)); ++pc; VM_NEXT();
+    VM_OP(NegF) R(a).f = -R(b).f; ++pc; VM_NEXT();
+    VM_OP(IntToFloat) R(a).f = static_cast<double>(R(b).i); ++pc; VM_NEXT();
+    VM_OP(FloatToInt) R(a).i = floatToInt(R(b).f); ++pc; VM_NEXT();
+
+    VM_OP(Jump) VM_BRANCH(true);
+    VM_OP(JumpIfTrue) VM_BRANCH(R(b).i);
+    VM_OP(JumpIfFalse) VM_BRANCH(!R(b).i);
+    VM_OP(JumpEqI) VM_BRANCH(R(b).i == R(c).i);
+    VM_OP(JumpNeI) VM_BRANCH(R(b).i != R(c).i);
+    VM_OP(JumpLtI) VM_BRANCH(R(b).i < R(c).i);
+    VM_OP(JumpLeI) VM_BRANCH(R(b).i <= R(c).i);
+    VM_OP(JumpEqF) VM_BRANCH(R(b).f == R(c).f);
+    VM_OP(JumpNeF) VM_BRANCH(R(b).f != R(c).f);
+    VM_OP(JumpLtF) VM_BRANCH(R(b).f < R(c).f);
+    VM_OP(JumpLeF) VM_BRANCH(R(b).f <= R(c).f);
+
+    VM_OP(Call) {
+        if (Tiered) {
+            if (tier->hasNative(pc->b)) {
+                const_cast<VMInstr*>(pc)->op = VMOp::CallNative;
+                VM_NEXT();
+            }
+            countCall(pc->b);
+        }
+        if (Profiled) {
+            ++calls[pc->b];
+            takenHere = jumpsTaken[pc->b].data();
+        }
+        const BytecodeFunction* callee = &functions[pc->b];
+        VMSlot* calleeBase = base + pc->c;
+        if (Memoized && memoized[pc->b] &&
+            memoLookup(*memo, *callee, calleeBase, frames.size() + 1, pending, R(a))) {
+            ++pc;
+            VM_NEXT();
+        }
+        if (calleeBase + callee->frameSize > stackEnd) throw VMException("Stack overflow calling " + callee->name);
+        frames.push_back(VMFrame{pc + 1, base, f, pc->a});
+        enterFrame(*callee, calleeBase);
+        base = calleeBase;
+        f = callee;
+        pc = f->code.data();
+        VM_NEXT();
+    }
+
+    VM_OP(CallNative) R(a) = tier->callNative(pc->b, base + pc->c); ++pc; VM_NEXT();
+
+    VM_OP(Return) value = R(a); goto leave;
+    VM_OP(ReturnVoid) value.i = 0; goto leave;
+    VM_OP(Unlowered) throw VMException(f->loweringError);
+
+#ifndef VM_COMPUTED_GOTO
+    }
+#endif
+#undef VM_OP
+#undef VM_NEXT
+#undef VM_BRANCH
+#undef R
+
+leave:
+    if (Memoized && !pending.empty() && pending.back().depth == frames.size()) {
+        memo->insert(f->name, pending.back().args, fromSlot(value, f->returnType));
+        pending.pop_back();
+    }
+    if (frames.empty()) return value;
+    {
+        const VMFrame& caller = frames.back();
+        pc = caller.resume;
+        base = caller.base;
+        f = caller.function;
+        base[caller.result] = value;
+        if (Profiled) takenHere = jumpsTaken[f - functions.data()].data();
+        frames.pop_back();
+    }
+#ifdef VM_COMPUTED_GOTO
+    goto *labels[static_cast<size_t>(pc->op)];
+#else
+    goto dispatch;
+#endif
+}
+
+void BytecodeVM::print(std::ostream& out) const {
+    for (const auto& f : functions) {
+        out << f.name << ": " << f.paramTypes.size() << " params, frame " << f.frameSize << ", constants at r"
+            << f.constBase << std::endl;
+        for (size_t k = 0; k < f.constants.size(); ++k) {
+            out << "    r" << f.constBase + k << " = ";
+            if (f.constantIsFloat[k]) out << Value::makeFloat(f.constants[k].f).toString() << std::endl;
+            else out << f.constants[k].i << std::endl;
+        }
+        for (size_t i = 0; i < f.code.size(); ++i) {
+            const VMInstr& vi = f.code[i];
+            out << "  " << i << ": " << vmOpName(vi.op);
+            switch (vi.op) {
+                case VMOp::Jump: out << " @" << vi.a; break;
+                case VMOp::JumpIfTrue: case VMOp::JumpIfFalse: out << " r" << vi.b << ", @" << vi.a; break;
+                case VMOp::Call: case VMOp::CallNative: out << " r" << vi.a << ", " << functions[vi.b].name << ", frame r" << vi.c; break;
+                case VMOp::Return: out << " r" << vi.a; break;
+                case VMOp::ReturnVoid: break;
+                case VMOp::Unlowered: out << " (" << f.loweringError << ")"; break;
+                case VMOp::Mov: case VMOp::Not: case VMOp::NegI: case VMOp::NegF:
+                case VMOp::IntToFloat: case VMOp::FloatToInt:
+                    out << " r" << vi.a << ", r" << vi.b;
+                    break;
+                default:
+                    if (vi.op >= VMOp::JumpEqI) out << " r" << vi.b << ", r" << vi.c << ", @" << vi.a;
+                    else out << " r" << vi.a << ", r" << vi.b << ", r" << vi.c;
+                    break;
+            }
+            out << std::endl;
+        }
+    }
+}
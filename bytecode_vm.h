@@ -0,0 +1,167 @@
+#ifndef BYTECODE_VM_H
+#define BYTECODE_VM_H
+
+#include "ir_module.h"
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class MemoCache;
+
+class VMException : public std::exception
+{
+    std::string message;
+public:
+    explicit VMException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// One register. Ints and bools use `i` (bools as 0/1), floats use `f`.
+union VMSlot {
+    int64_t i;
+    double f;
+};
+
+// Typed register instructions. Operands a, b, c are frame registers unless
+// noted; jump targets are instruction indices. GT/GE are lowered to LT/LE
+// with swapped operands.
+enum class VMOp : uint8_t {
+    Mov,                                // a = b
+    AddI, SubI, MulI, DivI, ModI,       // a = b op c
+    AddF, SubF, MulF, DivF,
+    EqI, NeI, LtI, LeI,                 // a = b cmp c, as 0/1
+    EqF, NeF, LtF, LeF,
+    And, Or, Not, NegI, NegF,
+    IntToFloat, FloatToInt,             // a = convert(b)
+    Jump,                               // goto a
+    JumpIfTrue, JumpIfFalse,            // if b goto a
+    JumpEqI, JumpNeI, JumpLtI, JumpLeI, // if b cmp c goto a
+    JumpEqF, JumpNeF, JumpLtF, JumpLeF,
+    Call,                               // a = call function b, frame at c
+    CallNative,                         // Call patched to b's native code
+    Return,                             // return a
+    ReturnVoid,
+    Unlowered                           // raise the function's loweringError
+};
+
+struct VMInstr {
+    VMOp op;
+    uint32_t a, b, c;
+};
+
+// A lowered function. Registers are laid out as params, then vars, temps
+// and scratch, then the constants (copied in on every call), then the
+// outgoing-argument area, which becomes the bottom of a callee's frame.
+struct BytecodeFunction {
+    std::string name;
+    std::vector<VMInstr> code;
+    std::vector<BasicType> paramTypes;
+    BasicType returnType;
+    uint32_t constBase;
+    uint32_t frameSize;
+    std::vector<VMSlot> constants;
+    std::vector<bool> constantIsFloat;
+    // First instruction lowered from each TAC instruction, then the end of
+    // the lowered body; maps profile counts back to the IR.
+    std::vector<uint32_t> tacStart;
+    // Why the function could not be lowered; its body is then a single
+    // Unlowered instruction, so only calls to it fail.
+    std::string loweringError;
+};
+
+// Receives hotness events from an interpreter running in tiered mode.
+class VMTierListener {
+public:
+    virtual ~VMTierListener() {}
+
+    // fn's calls plus loop back edges reached the threshold. Heard once
+    // per function for each listener installed.
+    virtual void hot(size_t fn) = 0;
+    // Whether fn has native code. Call sites that see it do are patched
+    // to CallNative and ask no more.
+    virtual bool hasNative(size_t fn) = 0;
+    virtual VMSlot callNative(size_t fn, const VMSlot* args) = 0;
+};
+
+// Register-based bytecode interpreter for an IR module. load() lowers every
+// function: `param`/`call` become direct writes into the callee's frame,
+// jumps are resolved to instruction indices, int/float conversions are made
+// explicit, and untyped values are treated as ints. A function using
+// strings, arrays or SSA form is kept unlowered and raises a VMException
+// when called, as do integer division by zero and stack overflow.
+class BytecodeVM {
+public:
+    static const size_t DEFAULT_STACK_SLOTS = 1 << 20;
+
+    explicit BytecodeVM(size_t stackSlots = DEFAULT_STACK_SLOTS) : stack(stackSlots) {}
+
+    void load(const IRModule& module);
+    bool findFunction(const std::string& name, size_t& fn) const;
+    const BytecodeFunction& function(size_t fn) const { return functions[fn]; }
+    size_t functionCount() const { return functions.size(); }
+    size_t instructionCount() const;
+
+    Value call(size_t fn, const std::vector<Value>& args);
+    Value call(const std::string& name, const std::vector<Value>& args);
+
+    void print(std::ostream& out) const;
+
+    // Tiered mode: calls and backward jumps are counted per function and
+    // the listener hears of each function whose total reaches `threshold`,
+    // including totals already past it when the listener is installed.
+    // A null listener turns counting off and unpatches native call sites.
+    void setTierListener(VMTierListener* listener, uint64_t threshold);
+    uint64_t callCount(size_t fn) const { return calls[fn]; }
+    uint64_t backEdgeCount(size_t fn) const { return backEdges[fn]; }
+
+    // Profiling mode: calls are counted as above, and so is every jump
+    // taken; ExecutionProfile derives the remaining counts from these.
+    // Turning it on clears the counters.
+    void setProfiling(bool on);
+    uint64_t takenCount(size_t fn, size_t pc) const { return jumpsTaken[fn][pc]; }
+
+    // Memoized mode: a call to a function flagged in `pure` (as found by
+    // EffectAnalyzer) first looks its argument values up in `cache`, and a
+    // call that returns stores its result there. Calls that fail store
+    // nothing, call sites patched to native code bypass the cache, and
+    // profiling mode ignores it. A null cache turns it off.
+    void setMemoCache(MemoCache* cache, const std::vector<bool>& pure);
+
+private:
+    std::vector<BytecodeFunction> functions;
+    std::vector<VMSlot> stack;
+    VMTierListener* tier = nullptr;
+    uint64_t tierThreshold = 0;
+    std::vector<uint64_t> calls;
+    std::vector<uint64_t> backEdges;
+    std::vector<char> reportedHot;
+    bool profiling = false;
+    std::vector<std::vector<uint64_t>> jumpsTaken;
+    MemoCache* memo = nullptr;
+    std::vector<char> memoized;
+
+    VMSlot execute(size_t fn, VMSlot* base);
+    template <bool Tiered, bool Profiled, bool Memoized>
+    VMSlot run(size_t fn, VMSlot* base);
+    void countCall(size_t fn) {
+        if (++calls[fn] + backEdges[fn] >= tierThreshold) reportHot(fn);
+    }
+    void countBackEdge(size_t fn) {
+        if (calls[fn] + ++backEdges[fn] >= tierThreshold) reportHot(fn);
+    }
+    void reportHot(size_t fn) {
+        if (reportedHot[fn]) return;
+        reportedHot[fn] = 1;
+        tier->hot(fn);
+    }
+};
+
+const char* vmOpName(VMOp op);
+
+// Conversions between Values and registers of a given declared type.
+VMSlot toSlot(const Value& v, BasicType type);
+Value fromSlot(VMSlot slot, BasicType type);
+
+#endif
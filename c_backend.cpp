@@ -0,0 +1,645 @@
+#include "c_backend.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_map>
+#include <dlfcn.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const RUNTIME = R"RUNTIME(/* Runtime support for C generated from TAC. */
+#ifndef TAC_RUNTIME_H
+#define TAC_RUNTIME_H
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int64_t tac_int;
+typedef double tac_float;
+typedef _Bool tac_bool;
+typedef const char* tac_string;
+
+typedef union {
+    int64_t i;
+    double f;
+    const char* s;
+} tac_slot;
+
+/* Type codes 'i', 'f', 'b', 's' and 'v' for each function's signature. */
+typedef struct {
+    const char* name;
+    const char* params;
+    char result;
+} tac_function_info;
+
+enum { TAC_OK, TAC_DIVISION_ERROR, TAC_STACK_OVERFLOW };
+
+int tac_invoke(int fn, const tac_slot* args, tac_slot* result);
+
+#ifndef TAC_MAX_DEPTH
+#define TAC_MAX_DEPTH 100000
+#endif
+
+static jmp_buf* tac_trap_target;
+static long tac_depth;
+
+static inline void tac_fail(int kind) {
+    if (tac_trap_target) longjmp(*tac_trap_target, kind);
+    fputs(kind == TAC_DIVISION_ERROR ? "integer division error\n" : "stack overflow\n", stderr);
+    exit(1);
+}
+
+/* Call depth is only tracked in checked builds. */
+#ifdef TAC_CHECKED
+#define TAC_ENTER() do { if (++tac_depth > TAC_MAX_DEPTH) tac_fail(TAC_STACK_OVERFLOW); } while (0)
+#define TAC_LEAVE() ((void)--tac_depth)
+#else
+#define TAC_ENTER() ((void)0)
+#define TAC_LEAVE() ((void)0)
+#endif
+
+/* Integer arithmetic wraps; division by zero and INT64_MIN / -1 trap. */
+static inline tac_int tac_add(tac_int a, tac_int b) { return (tac_int)((uint64_t)a + (uint64_t)b); }
+static inline tac_int tac_sub(tac_int a, tac_int b) { return (tac_int)((uint64_t)a - (uint64_t)b); }
+static inline tac_int tac_mul(tac_int a, tac_int b) { return (tac_int)((uint64_t)a * (uint64_t)b); }
+static inline tac_int tac_neg(tac_int a) { return (tac_int)(0 - (uint64_t)a); }
+
+static inline tac_int tac_div(tac_int a, tac_int b) {
+    if (b == 0 || (a == INT64_MIN && b == -1)) tac_fail(TAC_DIVISION_ERROR);
+    return a / b;
+}
+
+static inline tac_int tac_mod(tac_int a, tac_int b) {
+    if (b == 0 || (a == INT64_MIN && b == -1)) tac_fail(TAC_DIVISION_ERROR);
+    return a % b;
+}
+
+/* NaN and out-of-range floats convert to INT64_MIN, as on x86-64. */
+static inline tac_int tac_f2i(tac_float x) {
+    if (!(x >= -9223372036854775808.0 && x < 9223372036854775808.0)) return INT64_MIN;
+    return (tac_int)x;
+}
+
+/* Concatenated strings are never freed. */
+static inline tac_string tac_concat(tac_string a, tac_string b) {
+    size_t n = strlen(a), m = strlen(b);
+    char* s = (char*)malloc(n + m + 1);
+    if (!s) abort();
+    memcpy(s, a, n);
+    memcpy(s + n, b, m + 1);
+    return s;
+}
+
+static inline int tac_strcmp(tac_string a, tac_string b) { return strcmp(a, b); }
+
+static inline void tac_parse(char type, const char* text, tac_slot* slot) {
+    switch (type) {
+        case 'f': slot->f = strtod(text, NULL); break;
+        case 'b': slot->i = strcmp(text, "true") == 0 || strcmp(text, "1") == 0; break;
+        case 's': slot->s = text; break;
+        default: slot->i = strtoll(text, NULL, 10); break;
+    }
+}
+
+/* Prints like the compiler's --run. */
+static inline void tac_print(char type, tac_slot value) {
+    char buf[40];
+    switch (type) {
+        case 'f':
+            snprintf(buf, sizeof buf, "%.15g", value.f);
+            if (strtod(buf, NULL) != value.f) snprintf(buf, sizeof buf, "%.17g", value.f);
+            printf("%s%s\n", buf, strpbrk(buf, ".eni") ? "" : ".0");
+            break;
+        case 'b': puts(value.i ? "true" : "false"); break;
+        case 's': puts(value.s); break;
+        case 'v': puts("void"); break;
+        default: printf("%lld\n", (long long)value.i); break;
+    }
+}
+
+/* main(): <function> <args...>. */
+static inline int tac_main(int argc, char** argv, const tac_function_info* functions, int count) {
+    tac_slot args[64], result;
+    for (int fn = 0; argc > 1 && fn < count; ++fn) {
+        size_t n = strlen(functions[fn].params);
+        if (strcmp(argv[1], functions[fn].name) != 0 || (size_t)argc != n + 2 || n > 64) continue;
+        for (size_t k = 0; k < n; ++k) tac_parse(functions[fn].params[k], argv[k + 2], &args[k]);
+        switch (tac_invoke(fn, args, &result)) {
+            case TAC_OK: tac_print(functions[fn].result, result); return 0;
+            case TAC_DIVISION_ERROR: fprintf(stderr, "integer division error in %s\n", argv[1]); return 1;
+            default: fprintf(stderr, "stack overflow in %s\n", argv[1]); return 1;
+        }
+    }
+    fprintf(stderr, "usage: %s <function> <args...>\n", argv[0]);
+    for (int fn = 0; fn < count; ++fn) fprintf(stderr, "  %s(%s) -> %c\n", functions[fn].name, functions[fn].params, functions[fn].result);
+    return 2;
+}
+
+#endif
+)RUNTIME";
+
+// Names become C identifiers: '_' doubles and any other character outside
+// [A-Za-z0-9] becomes '_' and two hex digits, so distinct names stay distinct
+// (inlining and SSA add names such as `acc.2`).
+std::string mangle(const std::string& name) {
+    static const char* const hex = "0123456789abcdef";
+    std::string s;
+    for (unsigned char c : name) {
+        if (c == '_') {
+            s += "__";
+        } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            s += static_cast<char>(c);
+        } else {
+            s += '_';
+            s += hex[c >> 4];
+            s += hex[c & 15];
+        }
+    }
+    return s;
+}
+
+// User functions get a prefix of their own so none can collide with a
+// runtime helper such as tac_add or tac_main.
+std::string functionSymbol(const IRModule& module, size_t fn) {
+    return "tacfn_" + mangle(module.functionName(fn));
+}
+
+const char* cType(BasicType t) {
+    switch (t) {
+        case T_FLOAT: return "tac_float";
+        case T_BOOL: return "tac_bool";
+        case T_STRING: return "tac_string";
+        case T_VOID: return "void";
+        default: return "tac_int";
+    }
+}
+
+char typeCode(BasicType t) {
+    switch (t) {
+        case T_FLOAT: return 'f';
+        case T_BOOL: return 'b';
+        case T_STRING: return 's';
+        case T_VOID: return 'v';
+        default: return 'i';
+    }
+}
+
+const char* slotField(BasicType t) {
+    return t == T_FLOAT ? "f" : t == T_STRING ? "s" : "i";
+}
+
+std::string zero(BasicType t) {
+    return t == T_STRING ? "\"\"" : t == T_FLOAT ? "0.0" : "0";
+}
+
+std::string floatLiteral(double d) {
+    if (std::isnan(d)) return "NAN";
+    if (std::isinf(d)) return d < 0 ? "(-HUGE_VAL)" : "HUGE_VAL";
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "%.17g", d);
+    std::string s = buf;
+    if (s.find_first_of(".e") == std::string::npos) s += ".0";
+    return d < 0 || std::signbit(d) ? "(" + s + ")" : s;
+}
+
+std::string intLiteral(int64_t v) {
+    if (v == INT64_MIN) return "INT64_MIN";
+    return v < 0 ? "(" + std::to_string(v) + ")" : std::to_string(v);
+}
+
+std::string stringLiteral(const std::string& text) {
+    std::string s = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            s += '\\';
+            s += static_cast<char>(c);
+        } else if (c < 32 || c >= 127) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\%03o", c);
+            s += buf;
+        } else {
+            s += static_cast<char>(c);
+        }
+    }
+    return s + "\"";
+}
+
+class FunctionEmitter {
+public:
+    FunctionEmitter(const IRModule& module, size_t fn, const std::unordered_map<uint32_t, size_t>& index,
+                    std::ostream& out)
+        : module(module), fn(fn), index(index), out(out), pool(module.symbols()) {}
+
+    void emit();
+
+private:
+    const IRModule& module;
+    size_t fn;
+    const std::unordered_map<uint32_t, size_t>& index;
+    std::ostream& out;
+    const IRSymbols& pool;
+
+    std::unordered_map<uint32_t, BasicType> types;      // operand bits -> C type
+    std::vector<Operand> locals;
+
+    [[noreturn]] void unsupported(const std::string& what) const {
+        throw CBackendException("Cannot emit " + module.functionName(fn) + " as C: " + what);
+    }
+
+    void declare(Operand o, BasicType t, bool local) {
+        if (types.insert({o.bits, t == T_VOID ? T_INT : t}).second && local) locals.push_back(o);
+    }
+
+    std::string name(Operand o) const {
+        if (o.isVar()) return "v_" + mangle(pool.name(o.index()));
+        return "t" + std::to_string(o.index());
+    }
+
+    BasicType typeOf(Operand o) const {
+        if (o.isConst()) return pool.constant(o.index()).type;
+        return types.at(o.bits);
+    }
+
+    size_t calleeOf(const TACInstruction& call) const {
+        auto it = index.find(call.arg1.index());
+        if (it == index.end()) unsupported("call to undefined function " + pool.name(call.arg1.index()));
+        return it->second;
+    }
+
+    std::string convert(const std::string& expr, BasicType from, BasicType to) const;
+    std::string value(Operand o, BasicType want) const;
+    void assign(Operand result, const std::string& expr, BasicType produced);
+    std::string condition(Opcode cmp, Operand a, Operand b) const;
+    void statement(const std::string& text) { out << "    " << text << "\n"; }
+};
+
+// Conversions the VM makes between its int and float registers. Bools are
+// ints; strings never convert.
+std::string FunctionEmitter::convert(const std::string& expr, BasicType from, BasicType to) const {
+    bool fromFloat = from == T_FLOAT, toFloat = to == T_FLOAT;
+    if ((from == T_STRING) != (to == T_STRING)) unsupported("string used as " + basicTypeToStr(to));
+    if (fromFloat == toFloat) return expr;
+    return toFloat ? "(tac_float)(" + expr + ")" : "tac_f2i(" + expr + ")";
+}
+
+std::string FunctionEmitter::value(Operand o, BasicType want) const {
+    if (!o.isConst()) return convert(name(o), typeOf(o), want);
+    const Value& v = pool.constant(o.index());
+    if (v.type == T_STRING) {
+        if (want != T_STRING) unsupported("string constant used as " + basicTypeToStr(want));
+        return stringLiteral(v.s);
+    }
+    if (want == T_STRING) unsupported("constant " + pool.render(o) + " used as a string");
+    if (want == T_FLOAT) return floatLiteral(v.type == T_FLOAT ? v.f : static_cast<double>(v.i));
+    if (v.type != T_FLOAT) return intLiteral(v.i);
+    return intLiteral(floatToInt(v.f));
+}
+
+void FunctionEmitter::assign(Operand result, const std::string& expr, BasicType produced) {
+    statement(name(result) + " = " + convert(expr, produced, typeOf(result)) + ";");
+}
+
+// A comparison at the type the VM would use: float if either side is.
+std::string FunctionEmitter::condition(Opcode cmp, Operand a, Operand b) const {
+    BasicType ta = typeOf(a), tb = typeOf(b);
+    const char* symbol = opcodeSymbol(cmp);
+    if (ta == T_STRING || tb == T_STRING)
+        return "tac_strcmp(" + value(a, T_STRING) + ", " + value(b, T_STRING) + ") " + symbol + " 0";
+    BasicType t = ta == T_FLOAT || tb == T_FLOAT ? T_FLOAT : T_INT;
+    return value(a, t) + " " + symbol + " " + value(b, t);
+}
+
+void FunctionEmitter::emit() {
+    const IRFunction& f = module.function(fn);
+    if (f.ssa) unsupported("function is in SSA form");
+    Span<const TACInstruction> body = module.code(fn);
+
+    for (const IRParam& p : module.params(fn)) declare(Operand::var(p.name), p.type, false);
+    for (const auto& instr : body) {
+        if (definesResult(instr)) declare(instr.result, instr.valueType(), true);
+    }
+    for (const auto& instr : body) {
+        uint8_t uses = useMask(instr);
+        if ((uses & USE_RESULT) && isSymbol(instr.result)) declare(instr.result, T_INT, true);
+        if ((uses & USE_ARG1) && isSymbol(instr.arg1)) declare(instr.arg1, T_INT, true);
+        if ((uses & USE_ARG2) && isSymbol(instr.arg2)) declare(instr.arg2, T_INT, true);
+    }
+
+    // Params are copied into a local of the callee's param type where they
+    // appear, as the VM writes its outgoing area.
+    std::vector<BasicType> argumentType(body.size(), T_VOID);
+    std::vector<std::vector<size_t>> callArguments(body.size());
+    std::vector<size_t> pending;
+    std::vector<char> targeted(f.labelCount, 0);
+    for (size_t i = 0; i < body.size(); ++i) {
+        const TACInstruction& instr = body[i];
+        if (instr.op == Opcode::Param) {
+            pending.push_back(i);
+        } else if (instr.op == Opcode::Call) {
+            size_t callee = calleeOf(instr);
+            Span<const IRParam> params = module.params(callee);
+            int64_t argc = pool.constant(instr.arg2.index()).i;
+            if (argc < 0 || static_cast<size_t>(argc) > pending.size())
+                unsupported("call to " + module.functionName(callee) + " without its params");
+            if (static_cast<size_t>(argc) != params.size())
+                unsupported("call to " + module.functionName(callee) + " with " + std::to_string(argc) + " arguments");
+            for (size_t j = 0; j < params.size(); ++j) {
+                size_t at = pending[pending.size() - params.size() + j];
+                argumentType[at] = params[j].type;
+                callArguments[i].push_back(at);
+            }
+            pending.resize(pending.size() - params.size());
+        } else if (instr.op == Opcode::Goto || isConditionalBranch(instr.op)) {
+            targeted[instr.result.index()] = 1;
+        }
+    }
+
+    std::string signature = std::string("static ") + cType(f.returnType) + " " + functionSymbol(module, fn) + "(";
+    Span<const IRParam> params = module.params(fn);
+    for (size_t p = 0; p < params.size(); ++p) {
+        signature += (p ? ", " : "") + std::string(cType(params[p].type)) + " " + name(Operand::var(params[p].name));
+    }
+    signature += params.empty() ? "void)" : ")";
+    out << signature << "\n{\n";
+    for (Operand o : locals) statement(std::string(cType(typeOf(o))) + " " + name(o) + " = " + zero(typeOf(o)) + ";");
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (argumentType[i] != T_VOID)
+            statement(std::string(cType(argumentType[i])) + " p" + std::to_string(i) + ";");
+    }
+    for (const IRParam& p : params) statement("(void)" + name(Operand::var(p.name)) + ";");
+    statement("TAC_ENTER();");
+
+    for (size_t i = 0; i < body.size(); ++i) {
+        const TACInstruction& instr = body[i];
+        Opcode op = instr.op;
+        switch (op) {
+            case Opcode::Label:
+                if (targeted[instr.result.index()]) out << "L" << instr.result.index() << ":;\n";
+                break;
+            case Opcode::Goto:
+                statement("goto L" + std::to_string(instr.result.index()) + ";");
+                break;
+            case Opcode::If:
+            case Opcode::IfFalse:
+                statement(std::string("if (") + (op == Opcode::IfFalse ? "!" : "") + value(instr.arg1, T_INT) +
+                          ") goto L" + std::to_string(instr.result.index()) + ";");
+                break;
+            case Opcode::Param:
+                if (argumentType[i] == T_VOID) unsupported("param without a call");
+                statement("p" + std::to_string(i) + " = " + value(instr.result, argumentType[i]) + ";");
+                break;
+            case Opcode::Call: {
+                size_t callee = calleeOf(instr);
+                std::string call = functionSymbol(module, callee) + "(";
+                for (size_t j = 0; j < callArguments[i].size(); ++j)
+                    call += (j ? ", p" : "p") + std::to_string(callArguments[i][j]);
+                call += ")";
+                BasicType returns = module.function(callee).returnType;
+                if (instr.result.empty()) {
+                    statement(call + ";");
+                } else if (returns == T_VOID) {
+                    statement(call + ";");
+                    assign(instr.result, "0", T_INT);
+                } else {
+                    assign(instr.result, call, returns);
+                }
+                break;
+            }
+            case Opcode::Return:
+                statement("TAC_LEAVE();");
+                if (f.returnType == T_VOID) statement("return;");
+                else if (instr.result.empty()) statement("return " + zero(f.returnType) + ";");
+                else statement("return " + value(instr.result, f.returnType) + ";");
+                break;
+            case Opcode::Copy:
+            case Opcode::Pos:
+                statement(name(instr.result) + " = " + value(instr.arg1, typeOf(instr.result)) + ";");
+                break;
+            case Opcode::Neg:
+                if (typeOf(instr.arg1) == T_FLOAT) assign(instr.result, "-" + value(instr.arg1, T_FLOAT), T_FLOAT);
+                else assign(instr.result, "tac_neg(" + value(instr.arg1, T_INT) + ")", T_INT);
+                break;
+            case Opcode::Not:
+                assign(instr.result, "!" + value(instr.arg1, T_INT), T_BOOL);
+                break;
+            case Opcode::And:
+            case Opcode::Or:
+                assign(instr.result, value(instr.arg1, T_INT) + (op == Opcode::And ? " && " : " || ") +
+                       value(instr.arg2, T_INT), T_BOOL);
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Mod: {
+                BasicType ta = typeOf(instr.arg1), tb = typeOf(instr.arg2);
+                if (op == Opcode::Add && ta == T_STRING && tb == T_STRING) {
+                    assign(instr.result, "tac_concat(" + value(instr.arg1, T_STRING) + ", " +
+                           value(instr.arg2, T_STRING) + ")", T_STRING);
+                    break;
+                }
+                if (ta == T_FLOAT || tb == T_FLOAT) {
+                    if (op == Opcode::Mod) unsupported("float %");
+                    assign(instr.result, value(instr.arg1, T_FLOAT) + " " + opcodeSymbol(op) + " " +
+                           value(instr.arg2, T_FLOAT), T_FLOAT);
+                    break;
+                }
+                static const char* const helpers[] = {"tac_add", "tac_sub", "tac_mul", "tac_div", "tac_mod"};
+                assign(instr.result, std::string(helpers[static_cast<int>(op) - static_cast<int>(Opcode::Add)]) +
+                       "(" + value(instr.arg1, T_INT) + ", " + value(instr.arg2, T_INT) + ")", T_INT);
+                break;
+            }
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Gt:
+            case Opcode::Le:
+            case Opcode::Ge:
+                assign(instr.result, condition(op, instr.arg1, instr.arg2), T_BOOL);
+                break;
+            case Opcode::IfEq:
+            case Opcode::IfNe:
+            case Opcode::IfLt:
+            case Opcode::IfGt:
+            case Opcode::IfLe:
+            case Opcode::IfGe: {
+                std::string cond = condition(comparisonOf(op), instr.arg1, instr.arg2);
+                if (instr.flags & BRANCH_IF_FALSE) cond = "!(" + cond + ")";
+                statement("if (" + cond + ") goto L" + std::to_string(instr.result.index()) + ";");
+                break;
+            }
+            case Opcode::Load:
+            case Opcode::Store:
+                unsupported("arrays");
+            case Opcode::Phi:
+                unsupported("phi");
+        }
+    }
+    statement("TAC_LEAVE();");
+    if (f.returnType == T_VOID) statement("return;");
+    else statement("return " + zero(f.returnType) + ";");
+    out << "}\n\n";
+}
+
+}
+
+void CBackend::writeRuntime(std::ostream& out) {
+    out << RUNTIME;
+}
+
+void CBackend::emit(std::ostream& out) const {
+    std::unordered_map<uint32_t, size_t> index;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) index[module.function(fn).name] = fn;
+
+    out << "/* Generated from TAC. */\n#include \"tac_runtime.h\"\n\n";
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        out << "static " << cType(module.function(fn).returnType) << " " << functionSymbol(module, fn) << "(";
+        Span<const IRParam> params = module.params(fn);
+        for (size_t p = 0; p < params.size(); ++p) out << (p ? ", " : "") << cType(params[p].type);
+        out << (params.empty() ? "void);\n" : ");\n");
+    }
+    out << "\n";
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) FunctionEmitter(module, fn, index, out).emit();
+
+    out << "int tac_invoke(int fn, const tac_slot* args, tac_slot* result)\n{\n"
+        << "    jmp_buf trap;\n"
+        << "    int kind;\n"
+        << "    tac_trap_target = &trap;\n"
+        << "    tac_depth = 0;\n"
+        << "    if ((kind = setjmp(trap)) != TAC_OK) {\n"
+        << "        tac_trap_target = NULL;\n"
+        << "        return kind;\n"
+        << "    }\n"
+        << "    switch (fn) {\n";
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        BasicType returns = module.function(fn).returnType;
+        std::string call = functionSymbol(module, fn) + "(";
+        Span<const IRParam> params = module.params(fn);
+        for (size_t p = 0; p < params.size(); ++p) {
+            call += (p ? ", args[" : "args[") + std::to_string(p) + "]." + slotField(params[p].type);
+            if (params[p].type == T_BOOL) call += " != 0";
+        }
+        call += ")";
+        out << "        case " << fn << ": ";
+        if (returns == T_VOID) out << call << "; break;\n";
+        else out << "result->" << slotField(returns) << " = " << call << "; break;\n";
+    }
+    out << "    }\n"
+        << "    tac_trap_target = NULL;\n"
+        << "    return TAC_OK;\n"
+        << "}\n\n";
+
+    out << "#ifndef TAC_NO_MAIN\n"
+        << "static const tac_function_info tac_functions[] = {\n";
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        std::string codes;
+        for (const IRParam& p : module.params(fn)) codes += typeCode(p.type);
+        out << "    {" << stringLiteral(module.functionName(fn)) << ", \"" << codes << "\", '"
+            << typeCode(module.function(fn).returnType) << "'},\n";
+    }
+    if (module.functionCount() == 0) out << "    {\"\", \"\", 'v'}\n";
+    out << "};\n\n"
+        << "int main(int argc, char** argv)\n{\n"
+        << "    return tac_main(argc, argv, tac_functions, " << module.functionCount() << ");\n"
+        << "}\n"
+        << "#endif\n";
+}
+
+void CBackend::writeFiles(const std::string& path) const {
+    std::ofstream source(path);
+    if (!source) throw CBackendException("Cannot write C file: " + path);
+    emit(source);
+    size_t slash = path.find_last_of('/');
+    std::string runtimePath = (slash == std::string::npos ? "" : path.substr(0, slash + 1)) + "tac_runtime.h";
+    std::ofstream runtime(runtimePath);
+    if (!runtime) throw CBackendException("Cannot write C runtime header: " + runtimePath);
+    writeRuntime(runtime);
+}
+
+namespace {
+
+// Must match tac_slot in the runtime header.
+union NativeSlot {
+    int64_t i;
+    double f;
+    const char* s;
+};
+
+}
+
+CNativeModule::CNativeModule(const IRModule& module, const std::string& compiler) {
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        names.push_back(module.functionName(fn));
+        returnTypes.push_back(module.function(fn).returnType);
+        paramTypes.emplace_back();
+        for (const IRParam& p : module.params(fn)) paramTypes.back().push_back(p.type);
+    }
+
+    char pattern[] = "/tmp/tac-c.XXXXXX";
+    if (!mkdtemp(pattern)) throw CBackendException("Cannot create a build directory for C output");
+    directory = pattern;
+    try {
+        CBackend(module).writeFiles(directory + "/module.c");
+        std::string command = compiler + " -O2 -shared -fPIC -DTAC_CHECKED -DTAC_NO_MAIN -o " + directory +
+                              "/module.so " + directory + "/module.c";
+        if (std::system(command.c_str()) != 0) throw CBackendException("C compiler failed: " + command);
+        handle = dlopen((directory + "/module.so").c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) throw CBackendException(std::string("Cannot load compiled module: ") + dlerror());
+        invoke = reinterpret_cast<InvokeFn>(dlsym(handle, "tac_invoke"));
+        if (!invoke) throw CBackendException("Compiled module has no tac_invoke");
+    } catch (...) {
+        removeFiles();
+        throw;
+    }
+}
+
+CNativeModule::~CNativeModule() {
+    removeFiles();
+}
+
+void CNativeModule::removeFiles() {
+    if (handle) dlclose(handle);
+    handle = nullptr;
+    invoke = nullptr;
+    unlink((directory + "/module.so").c_str());
+    unlink((directory + "/module.c").c_str());
+    unlink((directory + "/tac_runtime.h").c_str());
+    rmdir(directory.c_str());
+}
+
+Value CNativeModule::call(size_t fn, const std::vector<Value>& args) {
+    const std::vector<BasicType>& types = paramTypes[fn];
+    if (args.size() != types.size()) {
+        throw CBackendException(names[fn] + " takes " + std::to_string(types.size()) + " arguments, got " +
+                                std::to_string(args.size()));
+    }
+    std::vector<NativeSlot> slots(std::max<size_t>(args.size(), 1));
+    for (size_t k = 0; k < args.size(); ++k) {
+        const Value& v = args[k];
+        if (types[k] == T_STRING) slots[k].s = v.s.c_str();
+        else if (types[k] == T_FLOAT) slots[k].f = v.type == T_FLOAT ? v.f : static_cast<double>(v.i);
+        else slots[k].i = v.type == T_FLOAT ? floatToInt(v.f) : v.i;
+    }
+
+    NativeSlot result;
+    result.i = 0;
+    int status = invoke(static_cast<int>(fn), slots.data(), &result);
+    if (status == 1) throw CBackendException("Integer division error in " + names[fn]);
+    if (status != 0) throw CBackendException("Stack overflow calling " + names[fn]);
+
+    switch (returnTypes[fn]) {
+        case T_FLOAT: return Value::makeFloat(result.f);
+        case T_BOOL: return Value::makeBool(result.i != 0);
+        case T_STRING: return Value::makeString(result.s);
+        case T_VOID: return Value();
+        default: return Value::makeInt(result.i);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef C_BACKEND_H
+#define C_BACKEND_H
+
+#include "ir_module.h"
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class CBackendException : public std::exception
+{
+    std::string message;
+public:
+    explicit CBackendException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// Emits an IR module as one C translation unit. Each function becomes a
+// static C function `tacfn_<name>` (the runtime keeps `tac_`), vars and temps become locals, labels and
+// gotos carry over one to one, and int/float/bool/string map to int64_t,
+// double, _Bool and const char*. Conversions, wrapping int arithmetic and
+// division errors follow the bytecode VM. Arrays and SSA form are rejected.
+//
+// The unit includes "tac_runtime.h" (written by writeRuntime) and ends with
+// `tac_invoke`, which calls a function by module index over tac_slot
+// arguments, and a `main` (left out under -DTAC_NO_MAIN) taking the
+// function name and its arguments on the command line:
+//     cc -O2 out.c -o prog && ./prog calculate 3 4
+class CBackend {
+public:
+    explicit CBackend(const IRModule& module) : module(module) {}
+
+    void emit(std::ostream& out) const;
+    static void writeRuntime(std::ostream& out);
+
+    // Writes `path` and tac_runtime.h next to it.
+    void writeFiles(const std::string& path) const;
+
+private:
+    const IRModule& module;
+};
+
+// Test harness: compiles a module with the system C compiler into a shared
+// object (runtime checks on, so division errors and runaway recursion come
+// back as exceptions rather than killing the process) and calls into it.
+// Function indices are the module's, matching the bytecode VM's.
+class CNativeModule {
+public:
+    explicit CNativeModule(const IRModule& module, const std::string& compiler = "cc");
+    ~CNativeModule();
+    CNativeModule(const CNativeModule&) = delete;
+    CNativeModule& operator=(const CNativeModule&) = delete;
+
+    Value call(size_t fn, const std::vector<Value>& args);
+
+private:
+    typedef int (*InvokeFn)(int fn, const void* args, void* result);
+
+    std::vector<std::string> names;
+    std::vector<std::vector<BasicType>> paramTypes;
+    std::vector<BasicType> returnTypes;
+    std::string directory;
+    void* handle = nullptr;
+    InvokeFn invoke = nullptr;
+
+    void removeFiles();
+};
+
+#endif
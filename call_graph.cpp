@@ -0,0 +1,22 @@
+#include "call_graph.h"
+
+void CallGraph::build(const IRModule& module) {
+    size_t n = module.functionCount();
+    calleeIndices.assign(n, {});
+    callerIndices.assign(n, {});
+    externals.assign(n, {});
+
+    for (size_t fn = 0; fn < n; ++fn) {
+        for (const auto& instr : module.code(fn)) {
+            if (instr.op != Opcode::Call) continue;
+            const std::string& name = module.symbols().name(instr.arg1.index());
+            size_t callee;
+            if (module.findFunction(name, callee)) {
+                calleeIndices[fn].push_back(callee);
+                callerIndices[callee].push_back(fn);
+            } else {
+                externals[fn].push_back(name);
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef CALL_GRAPH_H
+#define CALL_GRAPH_H
+
+#include "ir_module.h"
+#include <string>
+#include <vector>
+
+// Call graph of an IR module: one node per function, an edge for every
+// `call` instruction. Calls to functions the module does not define are
+// kept by name in externalCallees.
+class CallGraph {
+public:
+    void build(const IRModule& module);
+
+    size_t size() const { return calleeIndices.size(); }
+    const std::vector<size_t>& callees(size_t fn) const { return calleeIndices[fn]; }
+    const std::vector<size_t>& callers(size_t fn) const { return callerIndices[fn]; }
+    const std::vector<std::string>& externalCallees(size_t fn) const { return externals[fn]; }
+
+private:
+    std::vector<std::vector<size_t>> calleeIndices;
+    std::vector<std::vector<size_t>> callerIndices;
+    std::vector<std::vector<std::string>> externals;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "cfg.h"
+#include "ir_generator.h"
+
+const uint32_t CFG::NONE;
+
+void CFG::build(Span<const TACInstruction> code, uint32_t labelCount) {
+    blocks.clear();
+    labelBlock.assign(labelCount, NONE);
+    instrBlock.assign(code.size(), NONE);
+
+    // Leaders: the first instruction, every label, and every instruction
+    // that follows a branch or return.
+    bool startNew = true;
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op == Opcode::Label || startNew) {
+            if (!blocks.empty()) blocks.back().end = i;
+            if (blocks.empty() || blocks.back().begin != i) blocks.push_back(BasicBlock{i, i});
+        }
+        startNew = endsBlock(instr.op);
+        instrBlock[i] = static_cast<uint32_t>(blocks.size() - 1);
+        if (instr.op == Opcode::Label) {
+            if (instr.result.index() >= labelCount) throw IRException("Label out of range in CFG build");
+            labelBlock[instr.result.index()] = instrBlock[i];
+        }
+    }
+    if (!blocks.empty()) blocks.back().end = static_cast<uint32_t>(code.size());
+
+    computeEdges(code);
+    computeReversePostorder();
+    computeDominators();
+    computeDominatorTree();
+}
+
+Span<const uint32_t> CFG::successors(uint32_t b) const {
+    return Span<const uint32_t>(succList.data() + succOffsets[b], succOffsets[b + 1] - succOffsets[b]);
+}
+
+Span<const uint32_t> CFG::predecessors(uint32_t b) const {
+    return Span<const uint32_t>(predList.data() + predOffsets[b], predOffsets[b + 1] - predOffsets[b]);
+}
+
+Span<const uint32_t> CFG::domChildren(uint32_t b) const {
+    return Span<const uint32_t>(domList.data() + domOffsets[b], domOffsets[b + 1] - domOffsets[b]);
+}
+
+bool CFG::dominates(uint32_t a, uint32_t b) const {
+    if (!isReachable(a) || !isReachable(b)) return false;
+    return domPre[a] <= domPre[b] && domPost[b] <= domPost[a];
+}
+
+void CFG::computeEdges(Span<const TACInstruction> code) {
+    uint32_t n = static_cast<uint32_t>(blocks.size());
+    auto target = [&](Operand label) {
+        uint32_t b = labelBlock[label.index()];
+        if (b == NONE) throw IRException("Jump to undefined label L" + std::to_string(label.index()));
+        return b;
+    };
+
+    succOffsets.assign(n + 1, 0);
+    succList.clear();
+    succList.reserve(2 * n);
+    for (uint32_t b = 0; b < n; ++b) {
+        succOffsets[b] = static_cast<uint32_t>(succList.size());
+        const TACInstruction& last = code[blocks[b].end - 1];
+        bool hasNext = b + 1 < n;
+        if (last.op == Opcode::Goto) {
+            succList.push_back(target(last.result));
+        } else if (isConditionalBranch(last.op)) {
+            uint32_t taken = target(last.result);
+            if (hasNext) succList.push_back(b + 1);
+            if (!hasNext || taken != b + 1) succList.push_back(taken);
+        } else if (last.op != Opcode::Return && hasNext) {
+            succList.push_back(b + 1);
+        }
+    }
+    succOffsets[n] = static_cast<uint32_t>(succList.size());
+
+    predOffsets.assign(n + 1, 0);
+    for (uint32_t s : succList) ++predOffsets[s + 1];
+    for (uint32_t b = 0; b < n; ++b) predOffsets[b + 1] += predOffsets[b];
+    predList.assign(succList.size(), 0);
+    std::vector<uint32_t> fill(predOffsets.begin(), predOffsets.end() - 1);
+    for (uint32_t b = 0; b < n; ++b) {
+        for (uint32_t s : successors(b)) predList[fill[s]++] = b;
+    }
+}
+
+void CFG::computeReversePostorder() {
+    uint32_t n = static_cast<uint32_t>(blocks.size());
+    rpo.clear();
+    rpoIndex.assign(n, NONE);
+    if (n == 0) return;
+
+    // Iterative DFS; each stack entry remembers the next successor to visit.
+    std::vector<uint8_t> visited(n, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    std::vector<uint32_t> postorder;
+    postorder.reserve(n);
+    stack.push_back({0, 0});
+    visited[0] = 1;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        Span<const uint32_t> succs = successors(top.first);
+        if (top.second < succs.size()) {
+            uint32_t s = succs[top.second++];
+            if (!visited[s]) {
+                visited[s] = 1;
+                stack.push_back({s, 0});
+            }
+        } else {
+            postorder.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    rpo.assign(postorder.rbegin(), postorder.rend());
+    for (uint32_t i = 0; i < rpo.size(); ++i) rpoIndex[rpo[i]] = i;
+}
+
+void CFG::computeDominators() {
+    uint32_t n = static_cast<uint32_t>(blocks.size());
+    idoms.assign(n, NONE);
+    if (n == 0) return;
+    idoms[0] = 0;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (rpoIndex[a] > rpoIndex[b]) a = idoms[a];
+            while (rpoIndex[b] > rpoIndex[a]) b = idoms[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); ++i) {
+            uint32_t b = rpo[i];
+            uint32_t newIdom = NONE;
+            for (uint32_t p : predecessors(b)) {
+                if (idoms[p] == NONE) continue;
+                newIdom = newIdom == NONE ? p : intersect(p, newIdom);
+            }
+            if (newIdom != idoms[b]) {
+                idoms[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+}
+
+void CFG::computeDominatorTree() {
+    uint32_t n = static_cast<uint32_t>(blocks.size());
+    domOffsets.assign(n + 1, 0);
+    for (uint32_t b = 1; b < n; ++b) {
+        if (idoms[b] != NONE) ++domOffsets[idoms[b] + 1];
+    }
+    for (uint32_t b = 0; b < n; ++b) domOffsets[b + 1] += domOffsets[b];
+    domList.assign(domOffsets[n], 0);
+    std::vector<uint32_t> fill(domOffsets.begin(), domOffsets.end() - 1);
+    for (uint32_t b = 1; b < n; ++b) {
+        if (idoms[b] != NONE) domList[fill[idoms[b]]++] = b;
+    }
+
+    // Pre/post numbering of the dominator tree answers dominates() in O(1).
+    domPre.assign(n, NONE);
+    domPost.assign(n, NONE);
+    if (n == 0) return;
+    uint32_t pre = 0, post = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.push_back({0, 0});
+    domPre[0] = pre++;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        Span<const uint32_t> kids = domChildren(top.first);
+        if (top.second < kids.size()) {
+            uint32_t c = kids[top.second++];
+            domPre[c] = pre++;
+            stack.push_back({c, 0});
+        } else {
+            domPost[top.first] = post++;
+            stack.pop_back();
+        }
+    }
+}
+
+void CFG::print(std::ostream& out) const {
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        out << "  B" << b << " [" << blocks[b].begin << ", " << blocks[b].end << ")";
+        if (!isReachable(b)) {
+            out << " unreachable" << std::endl;
+            continue;
+        }
+        out << " idom=";
+        if (b == 0) out << "-";
+        else out << "B" << idoms[b];
+        out << " succs:";
+        for (uint32_t s : successors(b)) out << " B" << s;
+        out << " preds:";
+        for (uint32_t p : predecessors(b)) out << " B" << p;
+        out << std::endl;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "ir_module.h"
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+struct BasicBlock {
+    uint32_t begin;     // first instruction index in the function body
+    uint32_t end;       // one past the last instruction
+};
+
+// Control-flow graph of one function body. Edges are stored as
+// offset/target arrays; dominators follow Cooper, Harvey and Kennedy,
+// "A Simple, Fast Dominance Algorithm".
+class CFG {
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    void build(Span<const TACInstruction> code, uint32_t labelCount);
+
+    size_t size() const { return blocks.size(); }
+    const BasicBlock& block(uint32_t b) const { return blocks[b]; }
+    uint32_t blockOfLabel(uint32_t label) const { return labelBlock[label]; }
+    uint32_t blockOfInstruction(uint32_t instr) const { return instrBlock[instr]; }
+
+    Span<const uint32_t> successors(uint32_t b) const;
+    Span<const uint32_t> predecessors(uint32_t b) const;
+
+    const std::vector<uint32_t>& reversePostorder() const { return rpo; }
+    uint32_t rpoNumber(uint32_t b) const { return rpoIndex[b]; }
+    bool isReachable(uint32_t b) const { return rpoIndex[b] != NONE; }
+
+    uint32_t idom(uint32_t b) const { return idoms[b]; }
+    Span<const uint32_t> domChildren(uint32_t b) const;
+    bool dominates(uint32_t a, uint32_t b) const;
+
+    void print(std::ostream& out) const;
+
+private:
+    std::vector<BasicBlock> blocks;
+    std::vector<uint32_t> labelBlock;
+    std::vector<uint32_t> instrBlock;
+    std::vector<uint32_t> succOffsets, succList;
+    std::vector<uint32_t> predOffsets, predList;
+    std::vector<uint32_t> rpo, rpoIndex;
+    std::vector<uint32_t> idoms;
+    std::vector<uint32_t> domOffsets, domList;
+    std::vector<uint32_t> domPre, domPost;
+
+    void computeEdges(Span<const TACInstruction> code);
+    void computeReversePostorder();
+    void computeDominators();
+    void computeDominatorTree();
+};
+
+#endif
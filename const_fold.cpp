@@ -0,0 +1,290 @@
+#include "const_fold.h"
+#include "ssa.h"
+#include <climits>
+#include <unordered_map>
+
+bool foldBinary(Opcode op, const Value& a, const Value& b, Value& out) {
+    bool numeric = (a.type == T_INT || a.type == T_FLOAT) && (b.type == T_INT || b.type == T_FLOAT);
+    bool isFloat = a.type == T_FLOAT || b.type == T_FLOAT;
+    auto asFloat = [](const Value& v) { return v.type == T_FLOAT ? v.f : static_cast<double>(v.i); };
+
+    switch (op) {
+        case Opcode::And:
+        case Opcode::Or:
+            if (a.type != T_BOOL || b.type != T_BOOL) return false;
+            out = Value::makeBool(op == Opcode::And ? (a.i && b.i) : (a.i || b.i));
+            return true;
+        case Opcode::Eq:
+        case Opcode::Ne:
+            if (a.type != b.type) return false;
+            out = Value::makeBool((a == b) == (op == Opcode::Eq));
+            return true;
+        case Opcode::Lt:
+        case Opcode::Gt:
+        case Opcode::Le:
+        case Opcode::Ge: {
+            int cmp;
+            if (numeric && isFloat) {
+                double x = asFloat(a), y = asFloat(b);
+                if (x != x || y != y) {
+                    out = Value::makeBool(false);
+                    return true;
+                }
+                cmp = x < y ? -1 : (x > y ? 1 : 0);
+            } else if (numeric) {
+                cmp = a.i < b.i ? -1 : (a.i > b.i ? 1 : 0);
+            } else if (a.type == T_STRING && b.type == T_STRING) {
+                cmp = a.s.compare(b.s);
+            } else {
+                return false;
+            }
+            bool r = op == Opcode::Lt ? cmp < 0 : op == Opcode::Gt ? cmp > 0 : op == Opcode::Le ? cmp <= 0 : cmp >= 0;
+            out = Value::makeBool(r);
+            return true;
+        }
+        default:
+            break;
+    }
+
+    if (op == Opcode::Add && a.type == T_STRING && b.type == T_STRING) {
+        out = Value::makeString(a.s + b.s);
+        return true;
+    }
+    if (!numeric) return false;
+
+    if (isFloat) {
+        double x = asFloat(a), y = asFloat(b);
+        switch (op) {
+            case Opcode::Add: out = Value::makeFloat(x + y); return true;
+            case Opcode::Sub: out = Value::makeFloat(x - y); return true;
+            case Opcode::Mul: out = Value::makeFloat(x * y); return true;
+            case Opcode::Div:
+                if (y == 0.0) return false;
+                out = Value::makeFloat(x / y);
+                return true;
+            default: return false;
+        }
+    }
+
+    // Integer arithmetic wraps like the two's-complement hardware it runs on.
+    uint64_t x = static_cast<uint64_t>(a.i), y = static_cast<uint64_t>(b.i);
+    switch (op) {
+        case Opcode::Add: out = Value::makeInt(static_cast<int64_t>(x + y)); return true;
+        case Opcode::Sub: out = Value::makeInt(static_cast<int64_t>(x - y)); return true;
+        case Opcode::Mul: out = Value::makeInt(static_cast<int64_t>(x * y)); return true;
+        case Opcode::Div:
+        case Opcode::Mod:
+            if (b.i == 0 || (a.i == LLONG_MIN && b.i == -1)) return false;
+            out = Value::makeInt(op == Opcode::Div ? a.i / b.i : a.i % b.i);
+            return true;
+        default: return false;
+    }
+}
+
+bool foldUnary(Opcode op, const Value& a, Value& out) {
+    switch (op) {
+        case Opcode::Not:
+            if (a.type != T_BOOL) return false;
+            out = Value::makeBool(!a.i);
+            return true;
+        case Opcode::Neg:
+            if (a.type == T_INT) out = Value::makeInt(static_cast<int64_t>(0 - static_cast<uint64_t>(a.i)));
+            else if (a.type == T_FLOAT) out = Value::makeFloat(-a.f);
+            else return false;
+            return true;
+        case Opcode::Pos:
+            if (a.type != T_INT && a.type != T_FLOAT) return false;
+            out = a;
+            return true;
+        default:
+            return false;
+    }
+}
+
+Value convertValue(const Value& v, BasicType to) {
+    if (to == T_FLOAT && v.type == T_INT) return Value::makeFloat(static_cast<double>(v.i));
+    if (to == T_INT && v.type == T_FLOAT) return Value::makeInt(floatToInt(v.f));
+    return v;
+}
+
+bool ConstantFolder::run(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> view = module.code(fn);
+    std::vector<TACInstruction> code(view.begin(), view.end());
+    uint32_t labelCount = module.function(fn).labelCount;
+    const CFG& cfg = analyses.cfg(fn);
+    const LocalSymbols& syms = analyses.symbols(fn);
+    IRSymbols& pool = module.symbols();
+    const uint32_t NONE = LocalSymbols::NONE;
+    size_t ns = syms.size();
+
+    // A phi group (one Phi per incoming edge) counts as one definition.
+    std::vector<uint32_t> defCount(ns, 0);
+    for (const auto& p : module.params(fn)) defCount[syms.id(Operand::var(p.name))] = 2;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (!definesResult(instr)) continue;
+        if (instr.op == Opcode::Phi && i > 0 && code[i - 1].op == Opcode::Phi && code[i - 1].result == instr.result)
+            continue;
+        uint32_t s = syms.id(instr.result);
+        if (s != NONE) ++defCount[s];
+    }
+
+    std::vector<char> known(ns, 0);
+    std::vector<Value> value(ns);
+    auto operandValue = [&](Operand o, Value& v) {
+        if (o.isConst()) {
+            v = pool.constant(o.index());
+            return true;
+        }
+        uint32_t s = syms.id(o);
+        if (s == NONE || !known[s]) return false;
+        v = value[s];
+        return true;
+    };
+    auto evaluate = [&](const TACInstruction& instr, Value& out) {
+        Value a, b;
+        if (instr.op == Opcode::Copy) {
+            if (!operandValue(instr.arg1, a)) return false;
+            out = convertValue(a, instr.valueType());
+            return true;
+        }
+        if (isUnaryOpcode(instr.op))
+            return operandValue(instr.arg1, a) && foldUnary(instr.op, a, out);
+        if (!isBinaryOpcode(instr.op)) return false;
+        bool haveA = operandValue(instr.arg1, a);
+        bool haveB = operandValue(instr.arg2, b);
+        if (haveA && haveB) return foldBinary(instr.op, a, b, out);
+        // `x || true` and `x && false` are constant whatever x is.
+        if (instr.op == Opcode::And || instr.op == Opcode::Or) {
+            const Value* k = haveA ? &a : haveB ? &b : nullptr;
+            if (k && k->type == T_BOOL && (k->i != 0) == (instr.op == Opcode::Or)) {
+                out = *k;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Sparse propagation over singly defined names, revisiting in reverse
+    // postorder until loop-carried phis settle.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t b : cfg.reversePostorder()) {
+            const BasicBlock& bb = cfg.block(b);
+            for (uint32_t i = bb.begin; i < bb.end; ++i) {
+                const TACInstruction& instr = code[i];
+                if (!definesResult(instr)) continue;
+                uint32_t s = syms.id(instr.result);
+                if (s == NONE || defCount[s] != 1 || known[s]) continue;
+                Value v;
+                if (instr.op == Opcode::Phi) {
+                    // The group is evaluated as a whole at its first phi.
+                    if (i > bb.begin && code[i - 1].op == Opcode::Phi && code[i - 1].result == instr.result)
+                        continue;
+                    bool constant = true, any = false;
+                    for (uint32_t j = i; j < bb.end && code[j].op == Opcode::Phi && code[j].result == instr.result; ++j) {
+                        if (code[j].arg1 == instr.result) continue;
+                        Value in;
+                        if (!operandValue(code[j].arg1, in) || (any && in != v)) {
+                            constant = false;
+                            break;
+                        }
+                        v = in;
+                        any = true;
+                    }
+                    if (!constant || !any) continue;
+                    v = convertValue(v, instr.valueType());
+                } else if (!evaluate(instr, v)) {
+                    continue;
+                }
+                known[s] = 1;
+                value[s] = v;
+                changed = true;
+            }
+        }
+    }
+
+    auto constantOperand = [&](const Value& v) { return Operand::constant(pool.internConstant(v)); };
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    std::unordered_map<uint32_t, Value> local;
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        local.clear();
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction instr = code[i];
+            auto substitute = [&](Operand& o, bool blockLocal) {
+                uint32_t s = syms.id(o);
+                if (s == NONE) return;
+                if (defCount[s] == 1 && known[s]) {
+                    o = constantOperand(value[s]);
+                } else if (blockLocal) {
+                    auto it = local.find(s);
+                    if (it != local.end()) o = constantOperand(it->second);
+                }
+            };
+            uint8_t mask = useMask(instr);
+            bool blockLocal = instr.op != Opcode::Phi;
+            if ((mask & USE_RESULT) && instr.op != Opcode::Store) substitute(instr.result, blockLocal);
+            if (mask & USE_ARG1) substitute(instr.arg1, blockLocal);
+            if (mask & USE_ARG2) substitute(instr.arg2, blockLocal);
+
+            if ((instr.op == Opcode::If || instr.op == Opcode::IfFalse) && instr.arg1.isConst()) {
+                bool cond = pool.constant(instr.arg1.index()).i != 0;
+                ++foldCount;
+                if (cond == (instr.op == Opcode::If)) out.emplace_back(Opcode::Goto, instr.result);
+                continue;
+            }
+            Value cmp;
+            if (isFusedBranch(instr.op) && instr.arg1.isConst() && instr.arg2.isConst() &&
+                foldBinary(comparisonOf(instr.op), pool.constant(instr.arg1.index()),
+                           pool.constant(instr.arg2.index()), cmp)) {
+                bool jumpOn = !(instr.flags & BRANCH_IF_FALSE);
+                ++foldCount;
+                if ((cmp.i != 0) == jumpOn) out.emplace_back(Opcode::Goto, instr.result);
+                continue;
+            }
+
+            if (definesResult(instr)) {
+                uint32_t s = syms.id(instr.result);
+                if (s != NONE && defCount[s] == 1 && known[s]) {
+                    // Every use now reads the constant, so the definition is dead.
+                    if (instr.op != Opcode::Copy && instr.op != Opcode::Phi) ++foldCount;
+                    continue;
+                }
+                Value v;
+                bool constant = instr.op != Opcode::Phi && evaluate(instr, v);
+                if (constant && instr.op != Opcode::Copy) {
+                    instr = TACInstruction(Opcode::Copy, instr.result, constantOperand(v), Operand(), instr.valueType());
+                    ++foldCount;
+                } else if (instr.op == Opcode::And || instr.op == Opcode::Or) {
+                    // `x && true` and `x || false` are just x.
+                    bool constA = instr.arg1.isConst(), constB = instr.arg2.isConst();
+                    if (constA != constB) {
+                        Operand other = constA ? instr.arg2 : instr.arg1;
+                        instr = TACInstruction(Opcode::Copy, instr.result, other, Operand(), instr.valueType());
+                        ++foldCount;
+                    }
+                }
+                if (s != NONE) {
+                    if (constant) local[s] = v;
+                    else local.erase(s);
+                }
+            }
+            out.push_back(instr);
+        }
+    }
+
+    removeStalePhiInputs(out, labelCount);
+    size_t removedHere = code.size() - out.size();
+    removeCount += removedHere;
+    bool modified = removedHere != 0 || out.size() != code.size();
+    for (size_t i = 0; !modified && i < out.size(); ++i) {
+        modified = out[i].op != code[i].op || out[i].result != code[i].result ||
+                   out[i].arg1 != code[i].arg1 || out[i].arg2 != code[i].arg2;
+    }
+    if (modified) module.replaceCode(fn, out);
+    return modified;
+}
@@ -0,0 +1,35 @@
+#ifndef CONST_FOLD_H
+#define CONST_FOLD_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+
+// Evaluation of operators on constants, using TypeChecker::unifyBinaryOp's
+// promotion rules: int op float is float, comparisons and logic give bool,
+// string + string concatenates. Returns false when the result is not a
+// compile-time constant (mismatched types, division by zero).
+bool foldBinary(Opcode op, const Value& a, const Value& b, Value& out);
+bool foldUnary(Opcode op, const Value& a, Value& out);
+Value convertValue(const Value& v, BasicType to);
+
+// Constant folding and propagation over one function. Values of singly
+// defined names are propagated sparsely (which covers everything in SSA
+// form); names assigned more than once are only propagated within a
+// block. Branches on constants become gotos or disappear.
+class ConstantFolder {
+public:
+    bool run(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool run(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        return run(module, fn, analyses);
+    }
+
+    size_t folded() const { return foldCount; }
+    size_t removed() const { return removeCount; }
+
+private:
+    size_t foldCount = 0;
+    size_t removeCount = 0;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "dce.h"
+#include "ssa.h"
+
+bool DeadCodeEliminator::run(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    bool changedAny = false;
+    for (;;) {
+        Span<const TACInstruction> current = module.code(fn);
+        std::vector<TACInstruction> code(current.begin(), current.end());
+        uint32_t labels = module.function(fn).labelCount;
+
+        bool changed = removeUnreachable(code, analyses.cfg(fn));
+        changed |= removeRedundantJumpsAndLabels(code, labels);
+        if (changed) {
+            removeStalePhiInputs(code, labels);
+            module.replaceCode(fn, code);
+        }
+        changed |= removeDeadAssignments(module, fn, analyses);
+        if (!changed) break;
+        changedAny = true;
+    }
+    return changedAny;
+}
+
+bool DeadCodeEliminator::removeUnreachable(std::vector<TACInstruction>& code, const CFG& cfg) {
+    std::vector<TACInstruction> kept;
+    kept.reserve(code.size());
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        if (cfg.isReachable(b)) kept.insert(kept.end(), code.begin() + bb.begin, code.begin() + bb.end);
+        else unreachableCount += bb.end - bb.begin;
+    }
+    if (kept.size() == code.size()) return false;
+    code.swap(kept);
+    return true;
+}
+
+bool DeadCodeEliminator::removeRedundantJumpsAndLabels(std::vector<TACInstruction>& code, uint32_t labels) {
+    bool changed = false;
+
+    // A goto or branch to the label that directly follows it (possibly
+    // after other labels); branch operands have no side effects.
+    std::vector<TACInstruction> kept;
+    kept.reserve(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op == Opcode::Goto || isConditionalBranch(instr.op)) {
+            bool fallsThrough = false;
+            for (size_t j = i + 1; j < code.size() && code[j].op == Opcode::Label; ++j) {
+                if (code[j].result == instr.result) fallsThrough = fallsThroughTo(code.data(), code.size(), i, j);
+            }
+            if (fallsThrough) {
+                ++unreachableCount;
+                changed = true;
+                continue;
+            }
+        }
+        kept.push_back(instr);
+    }
+    code.swap(kept);
+
+    // A label nobody branches to (and no phi names) only splits a block,
+    // unless phis follow it, which must stay at the top of their block.
+    std::vector<char> referenced(labels, 0);
+    for (const auto& instr : code) {
+        if (instr.op == Opcode::Goto || isConditionalBranch(instr.op)) referenced[instr.result.index()] = 1;
+        if (instr.op == Opcode::Phi) referenced[instr.arg2.index()] = 1;
+    }
+    kept.clear();
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op == Opcode::Label && !referenced[instr.result.index()] &&
+            !(i + 1 < code.size() && code[i + 1].op == Opcode::Phi)) {
+            ++labelCount;
+            changed = true;
+            continue;
+        }
+        kept.push_back(instr);
+    }
+    code.swap(kept);
+    return changed;
+}
+
+bool DeadCodeEliminator::removeDeadAssignments(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> current = module.code(fn);
+    const CFG& cfg = analyses.cfg(fn);
+    const LocalSymbols& all = analyses.symbols(fn);
+    const LocalSymbols& globals = analyses.globalSymbols(fn);
+    const Liveness& live = analyses.liveness(fn);
+    const uint32_t NONE = LocalSymbols::NONE;
+
+    // Walk each block backwards from its live-out set. Names that are not
+    // global cannot be live across blocks, so a flat flag array suffices.
+    std::vector<char> isLive(all.size(), 0);
+    std::vector<char> keep(current.size(), 1);
+    std::vector<char> dropResult(current.size(), 0);
+    bool changed = false;
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        std::fill(isLive.begin(), isLive.end(), 0);
+        live.liveOut(b).forEach([&](size_t g) { isLive[all.id(globals.operand(g))] = 1; });
+
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.end; i-- > bb.begin;) {
+            const TACInstruction& instr = current[i];
+            if (definesResult(instr)) {
+                uint32_t s = all.id(instr.result);
+                if (s != NONE && !isLive[s] && !mayTrap(instr, module.symbols())) {
+                    // A call stays for its side effects; only the result goes.
+                    changed = true;
+                    if (instr.op == Opcode::Call) {
+                        dropResult[i] = 1;
+                    } else {
+                        keep[i] = 0;
+                        ++deadCount;
+                        continue;
+                    }
+                }
+                // Phi inputs for one name share its result, so a phi only
+                // tests liveness; the name stays live for its siblings.
+                if (s != NONE && instr.op != Opcode::Phi) isLive[s] = 0;
+            }
+            if (instr.op == Opcode::Phi) continue;
+            uint8_t mask = useMask(instr);
+            Operand uses[3] = {instr.result, instr.arg1, instr.arg2};
+            for (int k = 0; k < 3; ++k) {
+                if (!(mask & (1 << k))) continue;
+                uint32_t s = all.id(uses[k]);
+                if (s != NONE) isLive[s] = 1;
+            }
+        }
+    }
+
+    std::vector<TACInstruction> code;
+    code.reserve(current.size());
+    for (uint32_t i = 0; i < current.size(); ++i) {
+        if (!keep[i]) continue;
+        code.push_back(current[i]);
+        if (dropResult[i]) {
+            code.back().result = Operand();
+            code.back().type = T_VOID;
+        }
+    }
+
+    if (changed) module.replaceCode(fn, code);
+    return changed;
+}
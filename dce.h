@@ -0,0 +1,33 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+
+// Removes unreachable blocks, jumps to the very next label, labels that
+// nothing jumps to, and assignments whose result is never read. Calls are
+// kept for their side effects; only an unused result is dropped from them.
+// Repeats until nothing changes, since each kind of removal exposes more.
+class DeadCodeEliminator {
+public:
+    bool run(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool run(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        return run(module, fn, analyses);
+    }
+
+    size_t unreachableRemoved() const { return unreachableCount; }
+    size_t labelsRemoved() const { return labelCount; }
+    size_t deadAssignmentsRemoved() const { return deadCount; }
+
+private:
+    size_t unreachableCount = 0;
+    size_t labelCount = 0;
+    size_t deadCount = 0;
+
+    bool removeUnreachable(std::vector<TACInstruction>& code, const CFG& cfg);
+    bool removeRedundantJumpsAndLabels(std::vector<TACInstruction>& code, uint32_t labels);
+    bool removeDeadAssignments(IRModule& module, size_t fn, AnalysisManager& analyses);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "differential.h"
+#include <cstring>
+
+namespace {
+
+std::vector<Value> edgeValues(BasicType type) {
+    std::vector<Value> values;
+    if (type == T_FLOAT) {
+        for (double d : {0.0, 1.5, -2.25, 3.0, 100.5, -0.5}) values.push_back(Value::makeFloat(d));
+    } else if (type == T_BOOL) {
+        values.push_back(Value::makeBool(false));
+        values.push_back(Value::makeBool(true));
+    } else {
+        for (int64_t i : {0, 1, -1, 2, 3, 5, -7, 10, 42}) values.push_back(Value::makeInt(i));
+    }
+    return values;
+}
+
+bool sameResult(const Value& a, const Value& b) {
+    if (a.type != b.type) return false;
+    if (a.type == T_FLOAT) return (a.f != a.f && b.f != b.f) || std::memcmp(&a.f, &b.f, sizeof(double)) == 0;
+    return a == b;
+}
+
+std::string describe(const std::string& name, const std::vector<Value>& args) {
+    std::string s = name + "(";
+    for (size_t i = 0; i < args.size(); ++i) s += (i ? ", " : "") + args[i].toString();
+    return s + ")";
+}
+
+}
+
+std::vector<std::vector<Value>> DifferentialTester::argumentSets(const BytecodeFunction& f) const {
+    std::vector<std::vector<Value>> pools;
+    size_t total = 1;
+    for (BasicType t : f.paramTypes) {
+        pools.push_back(edgeValues(t));
+        total = total > maxCases ? total : total * pools.back().size();
+    }
+
+    std::vector<std::vector<Value>> sets;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    size_t count = total < maxCases ? total : maxCases;
+    for (size_t n = 0; n < count; ++n) {
+        // Enumerate the product in order when it fits, otherwise sample it.
+        uint64_t pick = n;
+        if (total > maxCases) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            pick = state >> 11;
+        }
+        std::vector<Value> args;
+        for (const auto& pool : pools) {
+            args.push_back(pool[pick % pool.size()]);
+            pick /= pool.size();
+        }
+        sets.push_back(args);
+    }
+    return sets;
+}
+
+size_t DifferentialTester::run(const std::string& label, const Executor& candidate, std::ostream& report) {
+    size_t mismatches = 0;
+    for (size_t fn = 0; fn < reference.functionCount(); ++fn) {
+        const BytecodeFunction& f = reference.function(fn);
+        if (!f.loweringError.empty()) continue;     // no reference to compare with
+        for (const auto& args : argumentSets(f)) {
+            ++caseCount;
+            Value expected, actual;
+            std::string expectedError, actualError;
+            try {
+                expected = reference.call(fn, args);
+            } catch (const VMException& e) {
+                expectedError = e.what();
+            }
+            try {
+                actual = candidate(fn, args);
+            } catch (const std::exception& e) {
+                actualError = e.what();
+            }
+
+            bool ok = expectedError.empty() ? actualError.empty() && sameResult(expected, actual)
+                                            : !actualError.empty();
+            if (ok) continue;
+            ++mismatches;
+            report << label << " mismatch: " << describe(f.name, args) << " = "
+                   << (actualError.empty() ? actual.toString() : "error: " + actualError) << ", VM gives "
+                   << (expectedError.empty() ? expected.toString() : "error: " + expectedError) << std::endl;
+        }
+    }
+    return mismatches;
+}
@@ -0,0 +1,36 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include "bytecode_vm.h"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Differential testing of an execution backend against the bytecode VM.
+// Every function is run over a fixed set of argument vectors built from
+// small edge values of each param type (capped per function, sampled
+// deterministically when the full product is larger). Results must match
+// exactly, floats bit for bit or both NaN; when the VM raises an error the
+// candidate must raise one too. Functions the VM could not lower are skipped.
+class DifferentialTester {
+public:
+    typedef std::function<Value(size_t fn, const std::vector<Value>& args)> Executor;
+
+    explicit DifferentialTester(BytecodeVM& reference, size_t maxCases = 256)
+        : reference(reference), maxCases(maxCases) {}
+
+    // Returns the number of mismatches and writes a line for each.
+    size_t run(const std::string& label, const Executor& candidate, std::ostream& report);
+
+    size_t casesRun() const { return caseCount; }
+
+private:
+    BytecodeVM& reference;
+    size_t maxCases;
+    size_t caseCount = 0;
+
+    std::vector<std::vector<Value>> argumentSets(const BytecodeFunction& f) const;
+};
+
+#endif
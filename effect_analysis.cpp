@@ -0,0 +1,59 @@
+#include "effect_analysis.h"
+#include <iostream>
+
+void EffectAnalyzer::analyze(const IRModule& mod) {
+    module = &mod;
+    graph.build(mod);
+    size_t n = mod.functionCount();
+    pure.assign(n, true);
+    reasons.assign(n, "");
+
+    // Local effects: stores through array parameters and calls that leave
+    // the module make a function impure on their own.
+    for (size_t fn = 0; fn < n; ++fn) {
+        if (!graph.externalCallees(fn).empty()) {
+            pure[fn] = false;
+            reasons[fn] = "calls external function " + graph.externalCallees(fn).front();
+            continue;
+        }
+        for (const auto& instr : mod.code(fn)) {
+            if (instr.op == Opcode::Store) {
+                pure[fn] = false;
+                reasons[fn] = "stores into array " + mod.symbols().render(instr.result);
+                break;
+            }
+        }
+    }
+
+    // Propagate impurity to callers over the reversed call graph.
+    std::vector<size_t> worklist;
+    for (size_t fn = 0; fn < n; ++fn) {
+        if (!pure[fn]) worklist.push_back(fn);
+    }
+    while (!worklist.empty()) {
+        size_t fn = worklist.back();
+        worklist.pop_back();
+        for (size_t caller : graph.callers(fn)) {
+            if (pure[caller]) {
+                pure[caller] = false;
+                reasons[caller] = "calls impure function " + mod.functionName(fn);
+                worklist.push_back(caller);
+            }
+        }
+    }
+}
+
+bool EffectAnalyzer::isPure(const std::string& function) const {
+    size_t fn;
+    if (!module || !module->findFunction(function, fn)) return false;
+    return pure[fn];
+}
+
+void EffectAnalyzer::printSummary() const {
+    for (size_t fn = 0; fn < pure.size(); ++fn) {
+        std::cout << "  " << module->functionName(fn) << ": ";
+        if (pure[fn]) std::cout << "pure";
+        else std::cout << "impure (" << reasons[fn] << ")";
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef EFFECT_ANALYSIS_H
+#define EFFECT_ANALYSIS_H
+
+#include "call_graph.h"
+#include <string>
+#include <vector>
+
+// Interprocedural purity analysis. A function is pure when its only writes
+// are to its own locals and temps and every function it calls is pure;
+// calls to functions outside the module are assumed to have effects.
+class EffectAnalyzer {
+public:
+    void analyze(const IRModule& module);
+    bool isPure(size_t fn) const { return pure[fn]; }
+    bool isPure(const std::string& function) const;
+    const CallGraph& callGraph() const { return graph; }
+    void printSummary() const;
+
+private:
+    const IRModule* module = nullptr;
+    CallGraph graph;
+    std::vector<bool> pure;
+    std::vector<std::string> reasons;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "function_merge.h"
+#include <unordered_map>
+
+namespace {
+
+uint64_t fnv1a(const std::vector<uint32_t>& words) {
+    uint64_t h = 14695981039346656037ULL;
+    for (uint32_t w : words) {
+        for (int byte = 0; byte < 4; ++byte) {
+            h ^= (w >> (8 * byte)) & 0xff;
+            h *= 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+}
+
+void FunctionMerger::normalize(const IRModule& module, size_t fn, std::vector<uint32_t>& out) {
+    const IRFunction& f = module.function(fn);
+    out.clear();
+    out.push_back(f.returnType);
+    out.push_back(f.paramCount);
+    out.push_back(f.ssa);
+
+    // Temps, labels and vars are numbered per kind by first appearance;
+    // a call to the function itself is marked as such rather than by name.
+    std::unordered_map<uint32_t, uint32_t> renumber;
+    uint32_t next[8] = {0};
+    auto local = [&](Operand o) {
+        auto it = renumber.find(o.bits);
+        if (it != renumber.end()) return it->second;
+        uint32_t n = next[static_cast<uint32_t>(o.kind())]++;
+        renumber[o.bits] = n;
+        return n;
+    };
+    for (const auto& p : module.params(fn)) {
+        out.push_back(p.type);
+        local(Operand::var(p.name));
+    }
+    auto word = [&](Operand o) -> uint32_t {
+        switch (o.kind()) {
+            case OperandKind::Temp:
+            case OperandKind::Label:
+            case OperandKind::Var: return Operand(o.kind(), local(o)).bits;
+            case OperandKind::Func: return o.index() == f.name ? Operand(OperandKind::Func, Operand::INDEX_MASK).bits : o.bits;
+            default: return o.bits;
+        }
+    };
+    for (const auto& instr : module.code(fn)) {
+        out.push_back(static_cast<uint32_t>(instr.op) | (uint32_t(instr.type) << 8) | (uint32_t(instr.flags) << 16));
+        out.push_back(word(instr.result));
+        out.push_back(word(instr.arg1));
+        out.push_back(word(instr.arg2));
+    }
+}
+
+void FunctionMerger::makeThunk(IRModule& module, size_t fn, size_t callee) {
+    const IRFunction& f = module.function(fn);
+    IRSymbols& pool = module.symbols();
+    std::vector<TACInstruction> code;
+    for (const auto& p : module.params(fn)) {
+        code.push_back(TACInstruction(Opcode::Param, Operand::var(p.name), Operand(), Operand(), p.type));
+    }
+    Operand argc = Operand::constant(pool.internConstant(Value::makeInt(f.paramCount)));
+    Operand func = Operand::func(module.function(callee).name);
+    if (f.returnType == T_VOID) {
+        code.push_back(TACInstruction(Opcode::Call, Operand(), func, argc));
+        code.push_back(TACInstruction(Opcode::Return));
+    } else {
+        Operand result = module.newTemp(fn);
+        code.push_back(TACInstruction(Opcode::Call, result, func, argc, f.returnType));
+        code.push_back(TACInstruction(Opcode::Return, result, Operand(), Operand(), f.returnType));
+    }
+    module.replaceCode(fn, code);
+    module.setSSA(fn, false);
+}
+
+bool FunctionMerger::run(IRModule& module) {
+    size_t n = module.functionCount();
+    target.resize(n);
+    for (size_t fn = 0; fn < n; ++fn) target[fn] = fn;
+
+    bool changedAny = false;
+    std::vector<std::vector<uint32_t>> bodies(n);
+    std::vector<size_t> thunkTarget(n, SIZE_MAX);
+    for (;;) {
+        // Classes of equal bodies among the functions not yet merged.
+        std::unordered_map<uint64_t, std::vector<size_t>> classes;
+        bool merged = false;
+        for (size_t fn = 0; fn < n; ++fn) {
+            if (target[fn] != fn) continue;
+            normalize(module, fn, bodies[fn]);
+            std::vector<size_t>& candidates = classes[fnv1a(bodies[fn])];
+            for (size_t c : candidates) {
+                if (bodies[c] != bodies[fn]) continue;
+                target[fn] = c;
+                ++mergeCount;
+                merged = true;
+                break;
+            }
+            if (target[fn] == fn) candidates.push_back(fn);
+        }
+        if (!merged) break;
+        changedAny = true;
+
+        // A function that was canonical in an earlier round may have been
+        // merged in this one; thunks and calls follow it to its new target.
+        for (size_t fn = 0; fn < n; ++fn) target[fn] = target[target[fn]];
+
+        for (size_t fn = 0; fn < n; ++fn) {
+            if (target[fn] != fn) {
+                if (thunkTarget[fn] != target[fn]) makeThunk(module, fn, target[fn]);
+                thunkTarget[fn] = target[fn];
+                continue;
+            }
+            Span<const TACInstruction> code = module.code(fn);
+            for (size_t i = 0; i < code.size(); ++i) {
+                if (code[i].op != Opcode::Call) continue;
+                size_t callee;
+                if (!module.findFunction(module.symbols().name(code[i].arg1.index()), callee)) continue;
+                if (target[callee] == callee) continue;
+                module.mutableCode(fn)[i].arg1 = Operand::func(module.function(target[callee]).name);
+                ++redirectCount;
+            }
+        }
+    }
+    return changedAny;
+}
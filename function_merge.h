@@ -0,0 +1,37 @@
+#ifndef FUNCTION_MERGE_H
+#define FUNCTION_MERGE_H
+
+#include "ir_module.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Merges functions whose bodies are identical up to the names of their
+// temps, labels and locals. Each body is renumbered in order of first
+// appearance (params first, by position) and hashed; functions with equal
+// hashes are compared word by word before merging, so a collision can
+// never merge different code. The first function of each class stays
+// canonical. Every call to a duplicate is sent to it, and the duplicate's
+// body becomes a thunk that forwards its params, so callers outside the
+// module still link. Repeats until nothing changes, since redirected calls
+// can make more bodies equal.
+class FunctionMerger {
+public:
+    bool run(IRModule& module);
+
+    size_t merged() const { return mergeCount; }
+    size_t callsRedirected() const { return redirectCount; }
+
+    // Canonical function for fn after run(): itself unless it was merged.
+    size_t canonical(size_t fn) const { return fn < target.size() ? target[fn] : fn; }
+
+private:
+    size_t mergeCount = 0;
+    size_t redirectCount = 0;
+    std::vector<size_t> target;
+
+    static void normalize(const IRModule& module, size_t fn, std::vector<uint32_t>& out);
+    static void makeThunk(IRModule& module, size_t fn, size_t callee);
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "inliner.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Tarjan's algorithm. Components come out callees-first.
+struct ComponentFinder {
+    const CallGraph& graph;
+    std::vector<uint32_t> index, low;
+    std::vector<bool> onStack;
+    std::vector<size_t> stack;
+    std::vector<std::vector<size_t>> result;
+    uint32_t counter = 0;
+
+    explicit ComponentFinder(const CallGraph& g)
+        : graph(g), index(g.size(), UINT32_MAX), low(g.size(), 0), onStack(g.size(), false) {}
+
+    void visit(size_t fn) {
+        index[fn] = low[fn] = counter++;
+        stack.push_back(fn);
+        onStack[fn] = true;
+        for (size_t callee : graph.callees(fn)) {
+            if (index[callee] == UINT32_MAX) {
+                visit(callee);
+                low[fn] = std::min(low[fn], low[callee]);
+            } else if (onStack[callee]) {
+                low[fn] = std::min(low[fn], index[callee]);
+            }
+        }
+        if (low[fn] != index[fn]) return;
+        result.emplace_back();
+        size_t member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            onStack[member] = false;
+            result.back().push_back(member);
+        } while (member != fn);
+    }
+};
+
+size_t bodySize(Span<const TACInstruction> code) {
+    size_t n = 0;
+    for (const auto& instr : code) n += instr.op != Opcode::Label;
+    return n;
+}
+
+}
+
+std::vector<std::vector<size_t>> Inliner::components(const CallGraph& graph, std::vector<size_t>& componentOf) const {
+    ComponentFinder finder(graph);
+    for (size_t fn = 0; fn < graph.size(); ++fn) {
+        if (finder.index[fn] == UINT32_MAX) finder.visit(fn);
+    }
+    componentOf.assign(graph.size(), 0);
+    for (size_t c = 0; c < finder.result.size(); ++c) {
+        for (size_t fn : finder.result[c]) componentOf[fn] = c;
+    }
+    return finder.result;
+}
+
+bool Inliner::run(IRModule& module, AnalysisManager& analyses) {
+    CallGraph graph;
+    graph.build(module);
+    std::vector<size_t> componentOf;
+    std::vector<std::vector<size_t>> order = components(graph, componentOf);
+
+    // A component is recursive if it has several members or a self call.
+    std::vector<bool> recursive(order.size(), false);
+    for (size_t c = 0; c < order.size(); ++c) {
+        if (order[c].size() > 1) {
+            recursive[c] = true;
+            continue;
+        }
+        const auto& callees = graph.callees(order[c][0]);
+        recursive[c] = std::find(callees.begin(), callees.end(), order[c][0]) != callees.end();
+    }
+
+    bool changed = false;
+    for (const auto& component : order) {
+        for (size_t fn : component) changed |= inlineInto(module, fn, analyses, componentOf, recursive);
+    }
+    return changed;
+}
+
+bool Inliner::inlineInto(IRModule& module, size_t caller, AnalysisManager& analyses,
+                         const std::vector<size_t>& componentOf, const std::vector<bool>& recursive) {
+    if (module.function(caller).ssa) return false;
+
+    const CFG& cfg = analyses.cfg(caller);
+    const LoopInfo& loops = analyses.loops(caller);
+    std::vector<TACInstruction> code(module.code(caller).begin(), module.code(caller).end());
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    size_t size = bodySize(module.code(caller));
+    bool changed = false;
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        out.push_back(instr);
+        if (instr.op != Opcode::Call) continue;
+
+        size_t callee;
+        if (!module.findFunction(module.symbols().name(instr.arg1.index()), callee)) continue;
+        if (recursive[componentOf[callee]]) {
+            ++recursiveCount;
+            continue;
+        }
+        const IRFunction& f = module.function(callee);
+        if (f.ssa) continue;
+
+        // The arguments must be the params directly in front of the call.
+        size_t argc = f.paramCount;
+        if (i < argc) continue;
+        bool contiguous = true;
+        for (size_t k = i - argc; k < i; ++k) contiguous &= code[k].op == Opcode::Param;
+        if (!contiguous) continue;
+
+        size_t calleeSize = bodySize(module.code(callee));
+        size_t overhead = argc + 2;
+        size_t frequency = size_t(1) << (3 * std::min<uint32_t>(loops.depth(cfg.blockOfInstruction(i)), 4));
+        if ((calleeSize > overhead && calleeSize - overhead > threshold * frequency) ||
+            size + calleeSize > maxCallerSize) {
+            ++costlyCount;
+            continue;
+        }
+
+        out.erase(out.end() - argc - 1, out.end());
+        expand(module, caller, callee, instr, &code[i - argc], out);
+        size += calleeSize + argc;
+        ++inlineCount;
+        changed = true;
+    }
+
+    if (changed) module.replaceCode(caller, out);
+    return changed;
+}
+
+void Inliner::expand(IRModule& module, size_t caller, size_t callee, const TACInstruction& call,
+                     const TACInstruction* args, std::vector<TACInstruction>& out) {
+    // The callee's storage does not move before the caller's replaceCode,
+    // so its body is read in place.
+    Span<const TACInstruction> body = module.code(callee);
+    Span<const IRParam> params = module.params(callee);
+
+    // Every var in the callee is one of its locals; give each a fresh
+    // temp in the caller. Params the callee never assigns stand for the
+    // argument itself, which also keeps arrays passed by reference.
+    std::unordered_map<uint32_t, Operand> rename;
+    std::vector<bool> assigned(params.size(), false);
+    for (const auto& instr : body) {
+        if (!definesResult(instr) || !instr.result.isVar()) continue;
+        for (size_t p = 0; p < params.size(); ++p) assigned[p] = assigned[p] || instr.result.index() == params[p].name;
+    }
+    for (size_t p = 0; p < params.size(); ++p) {
+        Operand arg = args[p].result;
+        if (assigned[p]) {
+            Operand local = module.newTemp(caller);
+            out.push_back(TACInstruction(Opcode::Copy, local, arg, Operand(), args[p].valueType()));
+            arg = local;
+        }
+        rename[Operand::var(params[p].name).bits] = arg;
+    }
+
+    auto map = [&](Operand o) -> Operand {
+        if (!o.isTemp() && !o.isVar() && !o.isLabel()) return o;
+        auto it = rename.find(o.bits);
+        if (it != rename.end()) return it->second;
+        Operand fresh = o.isLabel() ? module.newLabel(caller) : module.newTemp(caller);
+        rename[o.bits] = fresh;
+        return fresh;
+    };
+
+    Operand end = module.newLabel(caller);
+    for (const auto& instr : body) {
+        if (instr.op == Opcode::Return) {
+            if (!call.result.empty() && !instr.result.empty())
+                out.push_back(TACInstruction(Opcode::Copy, call.result, map(instr.result), Operand(), instr.valueType()));
+            out.push_back(TACInstruction(Opcode::Goto, end));
+            continue;
+        }
+        TACInstruction copy = instr;
+        copy.result = map(instr.result);
+        copy.arg1 = map(instr.arg1);
+        copy.arg2 = map(instr.arg2);
+        out.push_back(copy);
+    }
+    out.push_back(TACInstruction(Opcode::Label, end));
+}
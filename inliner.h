@@ -0,0 +1,48 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "analysis_manager.h"
+#include "call_graph.h"
+#include <cstddef>
+#include <vector>
+
+// Splices callee bodies into their call sites. Functions are visited
+// bottom-up over the call graph's strongly connected components, so a
+// callee has already absorbed its own small helpers by the time it is
+// costed. A function in a recursive component is never inlined, not even
+// into a caller outside the cycle.
+//
+// Cost model: a call costs its params, the call and the return. A site is
+// inlined when the callee's size minus that overhead is at most
+// `threshold` times the site's estimated frequency, 8 per enclosing loop.
+// Callers stop growing at maxCallerSize instructions.
+class Inliner {
+public:
+    explicit Inliner(size_t threshold = 12, size_t maxCallerSize = 4000)
+        : threshold(threshold), maxCallerSize(maxCallerSize) {}
+
+    bool run(IRModule& module, AnalysisManager& analyses);
+    bool run(IRModule& module) {
+        AnalysisManager analyses(module);
+        return run(module, analyses);
+    }
+
+    size_t inlined() const { return inlineCount; }
+    size_t recursiveSkipped() const { return recursiveCount; }
+    size_t tooCostly() const { return costlyCount; }
+
+private:
+    size_t threshold;
+    size_t maxCallerSize;
+    size_t inlineCount = 0;
+    size_t recursiveCount = 0;
+    size_t costlyCount = 0;
+
+    std::vector<std::vector<size_t>> components(const CallGraph& graph, std::vector<size_t>& componentOf) const;
+    bool inlineInto(IRModule& module, size_t caller, AnalysisManager& analyses,
+                    const std::vector<size_t>& componentOf, const std::vector<bool>& recursive);
+    void expand(IRModule& module, size_t caller, size_t callee, const TACInstruction& call,
+                const TACInstruction* args, std::vector<TACInstruction>& out);
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "ir_file.h"
+#include "ir_generator.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char IR_MAGIC[4] = {'T', 'C', 'I', 'R'};
+static const uint16_t IR_VERSION = 1;
+
+// Section record sizes, fixed by the format.
+static const size_t HEADER_SIZE = 80;
+static const size_t FUNCTION_SIZE = 32;
+static const size_t PARAM_SIZE = 8;
+static const size_t NAME_SIZE = 8;
+static const size_t CONSTANT_SIZE = 24;
+static const size_t INSTRUCTION_SIZE = 16;
+
+enum Section { FUNCTIONS, PARAMS, NAMES, CONSTANTS, CODE, BLOB, SECTION_COUNT };
+
+namespace {
+
+class Writer {
+public:
+    std::vector<uint8_t> bytes;
+
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void u16(uint16_t v) { u8(v & 0xff); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xffff); u16(v >> 16); }
+    void u64(uint64_t v) { u32(static_cast<uint32_t>(v)); u32(static_cast<uint32_t>(v >> 32)); }
+    void align() { while (bytes.size() % 8) u8(0); }
+    void patch64(size_t at, uint64_t v) {
+        for (int i = 0; i < 8; ++i) bytes[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+};
+
+uint16_t getU16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t getU32(const uint8_t* p) { return getU16(p) | (static_cast<uint32_t>(getU16(p + 2)) << 16); }
+uint64_t getU64(const uint8_t* p) { return getU32(p) | (static_cast<uint64_t>(getU32(p + 4)) << 32); }
+
+bool littleEndianHost() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// Read-only mapping released on scope exit.
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw IRException("Cannot open IR file: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = static_cast<size_t>(st.st_size);
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) data = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+        if (!data && size > 0) throw IRException("Cannot map IR file: " + path);
+    }
+    ~MappedFile() {
+        if (data) ::munmap(const_cast<uint8_t*>(data), size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+}
+
+void writeIRFile(const IRModule& module, const std::string& path) {
+    const IRSymbols& syms = module.symbols();
+    Writer w;
+    std::vector<uint8_t> blob;
+    auto addBlob = [&](const std::string& s) {
+        uint32_t offset = static_cast<uint32_t>(blob.size());
+        blob.insert(blob.end(), s.begin(), s.end());
+        return offset;
+    };
+
+    size_t paramTotal = 0;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) paramTotal += module.function(fn).paramCount;
+
+    w.bytes.insert(w.bytes.end(), IR_MAGIC, IR_MAGIC + 4);
+    w.u16(IR_VERSION);
+    w.u16(0);
+    w.u32(static_cast<uint32_t>(module.functionCount()));
+    w.u32(static_cast<uint32_t>(paramTotal));
+    w.u32(static_cast<uint32_t>(syms.nameCount()));
+    w.u32(static_cast<uint32_t>(syms.constantCount()));
+    w.u32(static_cast<uint32_t>(module.instructionCount()));
+    w.u32(0);                                   // blob size, patched below
+    size_t offsets = w.bytes.size();
+    for (int s = 0; s < SECTION_COUNT; ++s) w.u64(0);
+
+    // Code is written function by function, so the image is always compact.
+    w.patch64(offsets + 8 * FUNCTIONS, w.bytes.size());
+    uint32_t paramBegin = 0, codeBegin = 0;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        const IRFunction& f = module.function(fn);
+        w.u32(f.name);
+        w.u8(static_cast<uint8_t>(f.returnType));
+        w.u8(f.ssa ? 1 : 0);
+        w.u16(0);
+        w.u32(paramBegin);
+        w.u32(f.paramCount);
+        w.u32(codeBegin);
+        w.u32(f.codeSize);
+        w.u32(f.tempCount);
+        w.u32(f.labelCount);
+        paramBegin += f.paramCount;
+        codeBegin += f.codeSize;
+    }
+    w.align();
+
+    w.patch64(offsets + 8 * PARAMS, w.bytes.size());
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        for (const IRParam& p : module.params(fn)) {
+            w.u32(p.name);
+            w.u8(static_cast<uint8_t>(p.type));
+            w.u8(0);
+            w.u16(0);
+        }
+    }
+    w.align();
+
+    w.patch64(offsets + 8 * NAMES, w.bytes.size());
+    for (uint32_t i = 0; i < syms.nameCount(); ++i) {
+        w.u32(addBlob(syms.name(i)));
+        w.u32(static_cast<uint32_t>(syms.name(i).size()));
+    }
+    w.align();
+
+    w.patch64(offsets + 8 * CONSTANTS, w.bytes.size());
+    for (uint32_t i = 0; i < syms.constantCount(); ++i) {
+        const Value& v = syms.constant(i);
+        w.u8(static_cast<uint8_t>(v.type));
+        w.u8(0);
+        w.u16(0);
+        w.u32(addBlob(syms.constantText(i)));
+        w.u32(static_cast<uint32_t>(syms.constantText(i).size()));
+        w.u32(0);
+        uint64_t payload = 0;
+        if (v.type == T_FLOAT) {
+            std::memcpy(&payload, &v.f, sizeof(payload));
+        } else if (v.type == T_STRING) {
+            payload = addBlob(v.s) | (static_cast<uint64_t>(v.s.size()) << 32);
+        } else {
+            payload = static_cast<uint64_t>(v.i);
+        }
+        w.u64(payload);
+    }
+    w.align();
+
+    w.patch64(offsets + 8 * CODE, w.bytes.size());
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        for (const TACInstruction& instr : module.code(fn)) {
+            w.u8(static_cast<uint8_t>(instr.op));
+            w.u8(instr.type);
+            w.u16(instr.flags);
+            w.u32(instr.result.bits);
+            w.u32(instr.arg1.bits);
+            w.u32(instr.arg2.bits);
+        }
+    }
+
+    w.patch64(offsets + 8 * BLOB, w.bytes.size());
+    w.bytes.insert(w.bytes.end(), blob.begin(), blob.end());
+    uint32_t blobSize = static_cast<uint32_t>(blob.size());
+    for (int i = 0; i < 4; ++i) w.bytes[offsets - 4 + i] = static_cast<uint8_t>(blobSize >> (8 * i));
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw IRException("Cannot write IR file: " + path);
+    out.write(reinterpret_cast<const char*>(w.bytes.data()), w.bytes.size());
+    if (!out) throw IRException("Cannot write IR file: " + path);
+}
+
+bool isIRFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    return in.read(magic, sizeof(magic)) && std::equal(magic, magic + 4, IR_MAGIC);
+}
+
+IRModule readIRFile(const std::string& path) {
+    MappedFile file(path);
+    const uint8_t* base = file.data;
+    auto corrupt = [&](const std::string& what) { return IRException("Corrupt IR file " + path + ": " + what); };
+
+    if (file.size < HEADER_SIZE) throw IRException("Truncated IR file: " + path);
+    if (!std::equal(base, base + 4, IR_MAGIC)) throw IRException("Not an IR file: " + path);
+    if (getU16(base + 4) != IR_VERSION)
+        throw IRException("Unsupported IR file version " + std::to_string(getU16(base + 4)) + ": " + path);
+
+    const uint32_t functionCount = getU32(base + 8);
+    const uint32_t paramCount = getU32(base + 12);
+    const uint32_t nameCount = getU32(base + 16);
+    const uint32_t constantCount = getU32(base + 20);
+    const uint32_t instructionCount = getU32(base + 24);
+    const uint32_t blobSize = getU32(base + 28);
+
+    const uint64_t counts[SECTION_COUNT] = {functionCount, paramCount, nameCount, constantCount,
+                                            instructionCount, blobSize};
+    const size_t sizes[SECTION_COUNT] = {FUNCTION_SIZE, PARAM_SIZE, NAME_SIZE, CONSTANT_SIZE, INSTRUCTION_SIZE, 1};
+    const uint8_t* section[SECTION_COUNT];
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        uint64_t offset = getU64(base + 32 + 8 * s);
+        if (s != BLOB && offset % 8) throw corrupt("misaligned section");
+        if (offset < HEADER_SIZE || offset > file.size || counts[s] * sizes[s] > file.size - offset)
+            throw IRException("Truncated IR file: " + path);
+        section[s] = base + offset;
+    }
+    auto blobString = [&](uint32_t offset, uint32_t length) {
+        if (offset > blobSize || length > blobSize - offset) throw corrupt("string out of range");
+        return std::string(reinterpret_cast<const char*>(section[BLOB]) + offset, length);
+    };
+
+    // Pools are re-interned in file order, which reproduces their indices.
+    IRModule module;
+    IRSymbols& syms = module.symbols();
+    for (uint32_t i = 0; i < nameCount; ++i) {
+        const uint8_t* e = section[NAMES] + i * NAME_SIZE;
+        if (syms.internName(blobString(getU32(e), getU32(e + 4))) != i) throw corrupt("duplicate name");
+    }
+    for (uint32_t i = 0; i < constantCount; ++i) {
+        const uint8_t* e = section[CONSTANTS] + i * CONSTANT_SIZE;
+        uint64_t payload = getU64(e + 16);
+        Value v;
+        v.type = static_cast<BasicType>(e[0]);
+        switch (v.type) {
+            case T_INT: case T_BOOL: v.i = static_cast<int64_t>(payload); break;
+            case T_FLOAT: std::memcpy(&v.f, &payload, sizeof(v.f)); break;
+            case T_STRING: v.s = blobString(static_cast<uint32_t>(payload), static_cast<uint32_t>(payload >> 32)); break;
+            default: throw corrupt("bad constant type");
+        }
+        if (syms.internConstant(v, blobString(getU32(e + 4), getU32(e + 8))) != i) throw corrupt("duplicate constant");
+    }
+
+    auto checkOperand = [&](Operand o) {
+        switch (o.kind()) {
+            case OperandKind::None: case OperandKind::Temp: case OperandKind::Label: return;
+            case OperandKind::Var: case OperandKind::Func: if (o.index() < nameCount) return; break;
+            case OperandKind::Const: if (o.index() < constantCount) return; break;
+            default: break;
+        }
+        throw corrupt("bad operand");
+    };
+
+    const bool direct = littleEndianHost();
+    std::vector<TACInstruction> decoded;
+    for (uint32_t fn = 0; fn < functionCount; ++fn) {
+        const uint8_t* e = section[FUNCTIONS] + fn * FUNCTION_SIZE;
+        uint32_t name = getU32(e);
+        uint32_t paramBegin = getU32(e + 8), params = getU32(e + 12);
+        uint32_t codeBegin = getU32(e + 16), codeSize = getU32(e + 20);
+        if (name >= nameCount || paramBegin > paramCount || params > paramCount - paramBegin ||
+            codeBegin > instructionCount || codeSize > instructionCount - codeBegin)
+            throw corrupt("function table out of range");
+
+        std::vector<IRParam> paramList;
+        for (uint32_t p = 0; p < params; ++p) {
+            const uint8_t* pe = section[PARAMS] + (paramBegin + p) * PARAM_SIZE;
+            if (getU32(pe) >= nameCount) throw corrupt("param name out of range");
+            paramList.push_back(IRParam{getU32(pe), static_cast<BasicType>(pe[4])});
+        }
+        size_t index = module.addFunction(syms.name(name), static_cast<BasicType>(e[4]), paramList);
+
+        const uint8_t* code = section[CODE] + static_cast<size_t>(codeBegin) * INSTRUCTION_SIZE;
+        decoded.clear();
+        for (uint32_t i = 0; i < codeSize; ++i) {
+            const uint8_t* ie = code + i * INSTRUCTION_SIZE;
+            TACInstruction instr(Opcode::Label);
+            if (direct) {
+                std::memcpy(&instr, ie, INSTRUCTION_SIZE);
+            } else {
+                instr.op = static_cast<Opcode>(ie[0]);
+                instr.type = ie[1];
+                instr.flags = getU16(ie + 2);
+                instr.result.bits = getU32(ie + 4);
+                instr.arg1.bits = getU32(ie + 8);
+                instr.arg2.bits = getU32(ie + 12);
+            }
+            if (instr.op > Opcode::IfGe) throw corrupt("bad opcode");
+            checkOperand(instr.result);
+            checkOperand(instr.arg1);
+            checkOperand(instr.arg2);
+            decoded.push_back(instr);
+        }
+        module.append(decoded.data(), decoded.size());
+        module.setCounters(index, getU32(e + 24), getU32(e + 28));
+        module.setSSA(index, e[5] != 0);
+    }
+    return module;
+}
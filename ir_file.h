@@ -0,0 +1,17 @@
+#ifndef IR_FILE_H
+#define IR_FILE_H
+
+#include "ir_module.h"
+#include <string>
+
+// Binary IR files. A versioned little-endian image of an IRModule: a fixed
+// header, then 8-byte aligned sections for the function table, params, the
+// name table, constants, the instruction stream (16-byte records laid out
+// exactly like TACInstruction) and a blob holding name and string bytes.
+// Readers map the file and copy sections straight into the module, so
+// loading skips the frontend entirely. Errors are IRExceptions.
+void writeIRFile(const IRModule& module, const std::string& path);
+IRModule readIRFile(const std::string& path);
+bool isIRFile(const std::string& path);
+
+#endif
@@ -1,477 +1,575 @@
-#include "ir_generator.h"
-
-std::string IRGenerator::newTemp() {
-    return "t" + std::to_string(tempCounter++);
-}
-
-std::string IRGenerator::newLabel() {
-    return "L" + std::to_string(labelCounter++);
-}
-
-void IRGenerator::emit(const TACInstruction& instr) {
-    instructions.push_back(instr);
-}
-
-void IRGenerator::emit(const std::string& op, const std::string& result,
-                       const std::string& arg1, const std::string& arg2) {
-    instructions.emplace_back(op, result, arg1, arg2);
-}
-
-void IRGenerator::generate(const std::shared_ptr<ASTNode>& root) {
-    if (!root) {
-        throw IRException("Cannot generate IR from null AST");
-    }
-    
-    std::cout << "\n[IRGenerator] Starting IR generation\n";
-    generateNode(root);
-    std::cout << "[IRGenerator] IR generation completed successfully.\n";
-}
-
-void IRGenerator::printIR() const {
-    std::cout << "\n=== Three-Address Code (TAC) ===" << std::endl;
-    for (const auto& instr : instructions) {
-        std::cout << instr.toString() << std::endl;
-    }
-    std::cout << "================================\n" << std::endl;
-}
-
-void IRGenerator::generateNode(const std::shared_ptr<ASTNode>& node) {
-    if (!node) return;
-    
-    if (node->kind == "Program") {
-        for (auto& child : node->children) {
-            generateNode(child);
-        }
-    }
-    else if (node->kind == "FunctionDecl") {
-        generateFunction(node);
-    }
-    else if (node->kind == "Block" || node->kind == "CompoundStmt") {
-        generateBlock(node);
-    }
-    else if (node->kind == "VarDecl") {
-        generateVarDecl(node);
-    }
-    else if (node->kind == "Assign") {
-        generateAssignment(node);
-    }
-    else if (node->kind == "IfStmt" || node->kind == "If") {
-        generateIf(node);
-    }
-    else if (node->kind == "WhileStmt" || node->kind == "While") {
-        generateWhile(node);
-    }
-    else if (node->kind == "ForStmt" || node->kind == "For") {
-        generateFor(node);
-    }
-    else if (node->kind == "ReturnStmt" || node->kind == "Return") {
-        generateReturn(node);
-    }
-    else if (node->kind == "PostfixOp") {
-        generatePostfixOp(node);
-    }
-    else if (node->kind == "PrefixOp" || node->kind == "UnaryOp") {
-        generatePrefixOp(node);
-    }
-    else if (node->kind == "FunctionCall" || node->kind == "CallExpr") {
-        generateFunctionCall(node);
-    }
-    else if (node->kind == "ExprStmt") {
-        if (!node->children.empty()) {
-            generateExpr(node->children[0]);
-        }
-    }
-    else {
-        for (auto& child : node->children) {
-            generateNode(child);
-        }
-    }
-}
-
-void IRGenerator::generateFunction(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.size() < 3) {
-        throw IRException("Invalid function declaration structure");
-    }
-    
-    std::string funcName;
-    if (!node->val.empty()) {
-        funcName = node->val;
-    } else if (node->children.size() > 1 && node->children[1]->kind == "Name") {
-        funcName = node->children[1]->val;
-    } else {
-        throw IRException("Function declaration missing name");
-    }
-    
-    currentFunction = funcName;
-    
-    emit("label", "func_" + funcName);
-    
-    for (auto& child : node->children) {
-        if (child && child->kind == "Params") {
-            for (auto& param : child->children) {
-                if (param && param->kind == "Param") {
-                    std::string paramName = param->val;
-                    emit("param", paramName);
-                    
-                    if (!param->children.empty() && param->children[0]->kind == "Type") {
-                        varTypes[paramName] = param->children[0]->val;
-                    }
-                }
-            }
-        }
-    }
-    
-    for (auto& child : node->children) {
-        if (child && (child->kind == "Block" || child->kind == "CompoundStmt")) {
-            generateBlock(child);
-        }
-    }
-    
-    emit("return");
-    emit("label", "end_" + funcName);
-    
-    currentFunction = "";
-}
-
-void IRGenerator::generateBlock(const std::shared_ptr<ASTNode>& node) {
-    for (auto& stmt : node->children) {
-        generateNode(stmt);
-    }
-}
-
-void IRGenerator::generateVarDecl(const std::shared_ptr<ASTNode>& node) {
-    std::string varName = node->val;
-    
-    for (auto& child : node->children) {
-        if (child && child->kind == "Type") {
-            varTypes[varName] = child->val;
-        }
-    }
-    
-    for (auto& child : node->children) {
-        if (child && child->kind != "Type" && child->kind != "Identifier") {
-            std::string initValue = generateExpr(child);
-            emit("=", varName, initValue);
-        }
-    }
-}
-
-void IRGenerator::generateAssignment(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.size() < 2) {
-        throw IRException("Assignment node must have at least 2 children");
-    }
-    
-    auto lhs = node->children[0];
-    auto rhs = node->children[1];
-    
-    if (!lhs || !rhs) {
-        throw IRException("Assignment has null operands");
-    }
-    
-    if (lhs->kind == "ArrayAccess" || lhs->kind == "Subscript") {
-        std::string arrayName = lhs->children[0]->val;
-        std::string indexTemp = generateExpr(lhs->children[1]);
-        std::string valueTemp = generateExpr(rhs);
-        emit("[]=", arrayName, indexTemp, valueTemp);
-    }
-    else if (lhs->kind == "Identifier") {
-        std::string rhsTemp = generateExpr(rhs);
-        emit("=", lhs->val, rhsTemp);
-    }
-    else {
-        throw IRException("Invalid left-hand side of assignment");
-    }
-}
-
-void IRGenerator::generateIf(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        throw IRException("If statement missing condition");
-    }
-    
-    std::string condTemp = generateExpr(node->children[0]);
-    
-    std::string labelElse = newLabel();
-    std::string labelEnd = newLabel();
-    
-    emit("ifFalse", labelElse, condTemp);
-    
-    if (node->children.size() > 1) {
-        generateNode(node->children[1]);
-    }
-    
-    emit("goto", labelEnd);
-    
-    emit("label", labelElse);
-    
-    if (node->children.size() > 2) {
-        generateNode(node->children[2]);
-    }
-    
-    emit("label", labelEnd);
-}
-
-void IRGenerator::generateWhile(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        throw IRException("While statement missing condition");
-    }
-    
-    std::string labelStart = newLabel();
-    std::string labelEnd = newLabel();
-    
-    emit("label", labelStart);
-    
-    std::string condTemp = generateExpr(node->children[0]);
-    
-    emit("ifFalse", labelEnd, condTemp);
-    
-    if (node->children.size() > 1) {
-        generateNode(node->children[1]);
-    }
-    
-    emit("goto", labelStart);
-    
-    emit("label", labelEnd);
-}
-
-void IRGenerator::generateFor(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.size() < 4) {
-        throw IRException("For statement has insufficient children");
-    }
-    
-    if (node->children[0]) {
-        generateNode(node->children[0]);
-    }
-    
-    std::string labelStart = newLabel();
-    std::string labelUpdate = newLabel();
-    std::string labelEnd = newLabel();
-    
-    emit("label", labelStart);
-    
-    if (node->children[1]) {
-        std::string condTemp = generateExpr(node->children[1]);
-        emit("ifFalse", labelEnd, condTemp);
-    }
-    
-    if (node->children[3]) {
-        generateNode(node->children[3]);
-    }
-    
-    emit("label", labelUpdate);
-    
-    if (node->children[2]) {
-        generateNode(node->children[2]);
-    }
-    
-    emit("goto", labelStart);
-    
-    emit("label", labelEnd);
-}
-
-void IRGenerator::generateReturn(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        emit("return");
-    } else {
-        std::string retTemp = generateExpr(node->children[0]);
-        emit("return", retTemp);
-    }
-}
-
-std::string IRGenerator::generateExpr(const std::shared_ptr<ASTNode>& node) {
-    if (!node) {
-        throw IRException("Cannot generate expression from null node");
-    }
-    
-    if (node->kind == "Literal" || node->kind == "IntLiteral" || 
-        node->kind == "FloatLiteral" || node->kind == "StringLiteral" ||
-        node->kind == "BoolLiteral") {
-        return node->val;
-    }
-    else if (node->kind == "Identifier") {
-        return node->val;
-    }
-    else if (node->kind == "BinaryOp" || node->kind == "BinaryExpr") {
-        return generateBinaryOp(node);
-    }
-    else if (node->kind == "UnaryOp") {
-        return generateUnaryOp(node);
-    }
-    else if (node->kind == "PostfixOp") {
-        return generatePostfixOp(node);
-    }
-    else if (node->kind == "PrefixOp") {
-        return generatePrefixOp(node);
-    }
-    else if (node->kind == "FunctionCall" || node->kind == "CallExpr") {
-        return generateFunctionCall(node);
-    }
-    else if (node->kind == "ArrayAccess" || node->kind == "Subscript") {
-        if (node->children.size() < 2) {
-            throw IRException("Array access requires array and index");
-        }
-        std::string arrayName = node->children[0]->val;
-        std::string indexTemp = generateExpr(node->children[1]);
-        std::string resultTemp = newTemp();
-        emit("[]", resultTemp, arrayName, indexTemp);
-        return resultTemp;
-    }
-    else {
-        throw IRException("Unknown expression node kind: " + node->kind);
-    }
-}
-
-std::string IRGenerator::generateBinaryOp(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.size() < 2) {
-        throw IRException("Binary operation requires two operands");
-    }
-    
-    std::string left = generateExpr(node->children[0]);
-    std::string right = generateExpr(node->children[1]);
-    std::string resultTemp = newTemp();
-    
-    std::string op = node->val;
-    
-    if (op == "+") emit("+", resultTemp, left, right);
-    else if (op == "-") emit("-", resultTemp, left, right);
-    else if (op == "*") emit("*", resultTemp, left, right);
-    else if (op == "/") emit("/", resultTemp, left, right);
-    else if (op == "%") emit("%", resultTemp, left, right);
-    else if (op == "==") emit("==", resultTemp, left, right);
-    else if (op == "!=") emit("!=", resultTemp, left, right);
-    else if (op == "<") emit("<", resultTemp, left, right);
-    else if (op == ">") emit(">", resultTemp, left, right);
-    else if (op == "<=") emit("<=", resultTemp, left, right);
-    else if (op == ">=") emit(">=", resultTemp, left, right);
-    else if (op == "&&") emit("&&", resultTemp, left, right);
-    else if (op == "||") emit("||", resultTemp, left, right);
-    else {
-        throw IRException("Unknown binary operator: " + op);
-    }
-    
-    return resultTemp;
-}
-
-std::string IRGenerator::generateUnaryOp(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        throw IRException("Unary operation requires one operand");
-    }
-    
-    std::string operand = generateExpr(node->children[0]);
-    std::string resultTemp = newTemp();
-    
-    std::string op = node->val;
-    
-    if (op == "!") {
-        emit("!", resultTemp, operand);
-    }
-    else if (op == "-") {
-        emit("-_unary", resultTemp, operand);
-    }
-    else if (op == "+") {
-        emit("+_unary", resultTemp, operand);
-    }
-    else {
-        throw IRException("Unknown unary operator: " + op);
-    }
-    
-    return resultTemp;
-}
-
-std::string IRGenerator::generatePostfixOp(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        throw IRException("Postfix operation requires operand");
-    }
-    
-    auto operand = node->children[0];
-    if (!operand || operand->kind != "Identifier") {
-        throw IRException("Postfix operation requires identifier");
-    }
-    
-    std::string varName = operand->val;
-    std::string resultTemp = newTemp();
-    std::string op = node->val;
-    
-    if (op == "++") {
-        emit("=", resultTemp, varName);
-        std::string oneTemp = newTemp();
-        emit("=", oneTemp, "1");
-        emit("+", varName, varName, oneTemp);
-    }
-    else if (op == "--") {
-        emit("=", resultTemp, varName);
-        std::string oneTemp = newTemp();
-        emit("=", oneTemp, "1");
-        emit("-", varName, varName, oneTemp);
-    }
-    else {
-        throw IRException("Unknown postfix operator: " + op);
-    }
-    
-    return resultTemp;
-}
-
-std::string IRGenerator::generatePrefixOp(const std::shared_ptr<ASTNode>& node) {
-    if (node->children.empty()) {
-        throw IRException("Prefix operation requires operand");
-    }
-    
-    auto operand = node->children[0];
-    if (!operand || operand->kind != "Identifier") {
-        throw IRException("Prefix operation requires identifier");
-    }
-    
-    std::string varName = operand->val;
-    std::string op = node->val;
-    
-    if (op == "++") {
-        std::string oneTemp = newTemp();
-        emit("=", oneTemp, "1");
-        emit("+", varName, varName, oneTemp);
-        return varName;
-    }
-    else if (op == "--") {
-        std::string oneTemp = newTemp();
-        emit("=", oneTemp, "1");
-        emit("-", varName, varName, oneTemp);
-        return varName;
-    }
-    else {
-        throw IRException("Unknown prefix operator: " + op);
-    }
-}
-
-std::string IRGenerator::generateFunctionCall(const std::shared_ptr<ASTNode>& node) {
-    std::string funcName;
-    int argStartIndex = 0;
-    
-    if (!node->val.empty()) {
-        funcName = node->val;
-    } else if (!node->children.empty() && node->children[0]->kind == "Identifier") {
-        funcName = node->children[0]->val;
-        argStartIndex = 1;
-    } else {
-        throw IRException("Function call missing function name");
-    }
-    
-    std::vector<std::string> argTemps;
-    for (size_t i = argStartIndex; i < node->children.size(); ++i) {
-        if (node->children[i]->kind == "ArgumentList" || node->children[i]->kind == "Args") {
-            for (auto& arg : node->children[i]->children) {
-                std::string argTemp = generateExpr(arg);
-                argTemps.push_back(argTemp);
-            }
-        } else {
-            std::string argTemp = generateExpr(node->children[i]);
-            argTemps.push_back(argTemp);
-        }
-    }
-    
-    for (const auto& arg : argTemps) {
-        emit("param", arg);
-    }
-    
-    std::string resultTemp = newTemp();
-    emit("call", resultTemp, funcName, std::to_string(argTemps.size()));
-    
-    return resultTemp;
+#include "ir_generator.h"
+
+Operand IRGenerator::newTemp(BasicType type) {
+    tempTypes.push_back(type);
+    return module.newTemp(currentFn);
+}
+
+Operand IRGenerator::newLabel() {
+    return module.newLabel(currentFn);
+}
+
+Operand IRGenerator::var(const std::string& name) {
+    return Operand::var(module.symbols().internName(name));
+}
+
+Operand IRGenerator::literal(const std::string& text) {
+    BasicType type = literalType(text);
+    std::string spelling = type == T_STRING ? "\"" + text + "\"" : text;
+    return Operand::constant(module.symbols().internConstant(literalValue(text, type), spelling));
+}
+
+BasicType IRGenerator::typeOf(Operand operand) const {
+    switch (operand.kind()) {
+        case OperandKind::Temp: return tempTypes[operand.index()];
+        case OperandKind::Const: return module.symbols().constant(operand.index()).type;
+        case OperandKind::Var: {
+            auto it = varTypes.find(operand.index());
+            return it == varTypes.end() ? T_UNKNOWN : it->second;
+        }
+        default: return T_UNKNOWN;
+    }
+}
+
+void IRGenerator::emit(const TACInstruction& instr) {
+    module.append(instr);
+}
+
+void IRGenerator::emit(Opcode op, Operand result, Operand arg1, Operand arg2, BasicType type) {
+    module.append(TACInstruction(op, result, arg1, arg2, type));
+}
+
+void IRGenerator::generate(const std::shared_ptr<ASTNode>& root) {
+    if (!root) {
+        throw IRException("Cannot generate IR from null AST");
+    }
+    
+    std::cout << "\n[IRGenerator] Starting IR generation\n";
+    for (auto& child : root->children) {
+        if (child && child->kind == "FunctionDecl" && !child->children.empty())
+            functionTypes[child->val] = parseBasicType(child->children[0]->val);
+    }
+    generateNode(root);
+    std::cout << "[IRGenerator] IR generation completed successfully.\n";
+}
+
+void IRGenerator::printIR() const {
+    std::cout << "\n=== Three-Address Code (TAC) ===" << std::endl;
+    module.print(std::cout);
+    std::cout << "================================\n" << std::endl;
+}
+
+void IRGenerator::generateNode(const std::shared_ptr<ASTNode>& node) {
+    if (!node) return;
+    
+    if (node->kind == "Program") {
+        for (auto& child : node->children) {
+            generateNode(child);
+        }
+    }
+    else if (node->kind == "FunctionDecl") {
+        generateFunction(node);
+    }
+    else if (node->kind == "Block" || node->kind == "CompoundStmt") {
+        generateBlock(node);
+    }
+    else if (node->kind == "VarDecl") {
+        generateVarDecl(node);
+    }
+    else if (node->kind == "Assign") {
+        generateAssignment(node);
+    }
+    else if (node->kind == "IfStmt" || node->kind == "If") {
+        generateIf(node);
+    }
+    else if (node->kind == "WhileStmt" || node->kind == "While") {
+        generateWhile(node);
+    }
+    else if (node->kind == "ForStmt" || node->kind == "For") {
+        generateFor(node);
+    }
+    else if (node->kind == "ReturnStmt" || node->kind == "Return") {
+        generateReturn(node);
+    }
+    else if (node->kind == "PostfixOp") {
+        generatePostfixOp(node);
+    }
+    else if (node->kind == "PrefixOp" || node->kind == "UnaryOp") {
+        generatePrefixOp(node);
+    }
+    else if (node->kind == "FunctionCall" || node->kind == "CallExpr") {
+        generateFunctionCall(node);
+    }
+    else if (node->kind == "ExprStmt") {
+        if (!node->children.empty()) {
+            generateExpr(node->children[0]);
+        }
+    }
+    else {
+        for (auto& child : node->children) {
+            generateNode(child);
+        }
+    }
+}
+
+void IRGenerator::generateFunction(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.size() < 3) {
+        throw IRException("Invalid function declaration structure");
+    }
+    
+    std::string funcName;
+    if (!node->val.empty()) {
+        funcName = node->val;
+    } else if (node->children.size() > 1 && node->children[1]->kind == "Name") {
+        funcName = node->children[1]->val;
+    } else {
+        throw IRException("Function declaration missing name");
+    }
+    
+    currentFunction = funcName;
+    BasicType retType = functionTypes.count(funcName) ? functionTypes[funcName] : T_UNKNOWN;
+    
+    varTypes.clear();
+    std::vector<IRParam> params;
+    for (auto& child : node->children) {
+        if (child && child->kind == "Params") {
+            for (auto& param : child->children) {
+                if (param && param->kind == "Param") {
+                    Operand paramVar = var(param->val);
+                    if (!param->children.empty() && param->children[0]->kind == "Type") {
+                        varTypes[paramVar.index()] = parseBasicType(param->children[0]->val);
+                    }
+                    params.push_back(IRParam{paramVar.index(), typeOf(paramVar)});
+                }
+            }
+        }
+    }
+    
+    currentFn = module.addFunction(funcName, retType, params);
+    tempTypes.clear();
+    
+    for (auto& child : node->children) {
+        if (child && (child->kind == "Block" || child->kind == "CompoundStmt")) {
+            generateBlock(child);
+        }
+    }
+    
+    emit(Opcode::Return);
+    
+    currentFunction = "";
+}
+
+void IRGenerator::generateBlock(const std::shared_ptr<ASTNode>& node) {
+    for (auto& stmt : node->children) {
+        generateNode(stmt);
+    }
+}
+
+void IRGenerator::generateVarDecl(const std::shared_ptr<ASTNode>& node) {
+    Operand varOp = var(node->val);
+    
+    for (auto& child : node->children) {
+        if (child && child->kind == "Type") {
+            varTypes[varOp.index()] = parseBasicType(child->val);
+        }
+    }
+    
+    // Children are the type, the declared name and an optional initializer.
+    if (node->children.size() > 2 && node->children[2]) {
+        Operand initValue = generateExpr(node->children[2]);
+        emit(Opcode::Copy, varOp, initValue, Operand(), typeOf(varOp));
+    }
+}
+
+void IRGenerator::generateAssignment(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.size() < 2) {
+        throw IRException("Assignment node must have at least 2 children");
+    }
+    
+    auto lhs = node->children[0];
+    auto rhs = node->children[1];
+    
+    if (!lhs || !rhs) {
+        throw IRException("Assignment has null operands");
+    }
+    
+    if (lhs->kind == "ArrayAccess" || lhs->kind == "Subscript") {
+        Operand arrayVar = var(lhs->children[0]->val);
+        Operand indexTemp = generateExpr(lhs->children[1]);
+        Operand valueTemp = generateExpr(rhs);
+        emit(Opcode::Store, arrayVar, indexTemp, valueTemp);
+    }
+    else if (lhs->kind == "Identifier") {
+        Operand rhsTemp = generateExpr(rhs);
+        Operand lhsVar = var(lhs->val);
+        emit(Opcode::Copy, lhsVar, rhsTemp, Operand(), typeOf(lhsVar));
+    }
+    else {
+        throw IRException("Invalid left-hand side of assignment");
+    }
+}
+
+void IRGenerator::generateIf(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        throw IRException("If statement missing condition");
+    }
+    
+    Operand labelElse = newLabel();
+    Operand labelEnd = newLabel();
+    
+    generateCondition(node->children[0], Operand(), labelElse);
+    
+    if (node->children.size() > 1) {
+        generateNode(node->children[1]);
+    }
+    
+    emit(Opcode::Goto, labelEnd);
+    
+    emit(Opcode::Label, labelElse);
+    
+    if (node->children.size() > 2) {
+        generateNode(node->children[2]);
+    }
+    
+    emit(Opcode::Label, labelEnd);
+}
+
+void IRGenerator::generateWhile(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        throw IRException("While statement missing condition");
+    }
+    
+    Operand labelStart = newLabel();
+    Operand labelEnd = newLabel();
+    
+    emit(Opcode::Label, labelStart);
+    
+    generateCondition(node->children[0], Operand(), labelEnd);
+    
+    if (node->children.size() > 1) {
+        generateNode(node->children[1]);
+    }
+    
+    emit(Opcode::Goto, labelStart);
+    
+    emit(Opcode::Label, labelEnd);
+}
+
+void IRGenerator::generateFor(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.size() < 4) {
+        throw IRException("For statement has insufficient children");
+    }
+    
+    if (node->children[0]) {
+        generateNode(node->children[0]);
+    }
+    
+    Operand labelStart = newLabel();
+    Operand labelUpdate = newLabel();
+    Operand labelEnd = newLabel();
+    
+    emit(Opcode::Label, labelStart);
+    
+    if (node->children[1]) {
+        generateCondition(node->children[1], Operand(), labelEnd);
+    }
+    
+    if (node->children[3]) {
+        generateNode(node->children[3]);
+    }
+    
+    emit(Opcode::Label, labelUpdate);
+    
+    if (node->children[2]) {
+        generateNode(node->children[2]);
+    }
+    
+    emit(Opcode::Goto, labelStart);
+    
+    emit(Opcode::Label, labelEnd);
+}
+
+void IRGenerator::generateReturn(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        emit(Opcode::Return);
+    } else {
+        Operand retTemp = generateExpr(node->children[0]);
+        emit(Opcode::Return, retTemp, Operand(), Operand(), typeOf(retTemp));
+    }
+}
+
+Operand IRGenerator::generateExpr(const std::shared_ptr<ASTNode>& node) {
+    if (!node) {
+        throw IRException("Cannot generate expression from null node");
+    }
+    
+    if (node->kind == "Literal" || node->kind == "IntLiteral" || 
+        node->kind == "FloatLiteral" || node->kind == "StringLiteral" ||
+        node->kind == "BoolLiteral") {
+        return literal(node->val);
+    }
+    else if (node->kind == "Identifier") {
+        return var(node->val);
+    }
+    else if (node->kind == "BinaryOp" || node->kind == "BinaryExpr") {
+        return generateBinaryOp(node);
+    }
+    else if (node->kind == "UnaryOp") {
+        return generateUnaryOp(node);
+    }
+    else if (node->kind == "PostfixOp") {
+        return generatePostfixOp(node);
+    }
+    else if (node->kind == "PrefixOp") {
+        return generatePrefixOp(node);
+    }
+    else if (node->kind == "FunctionCall" || node->kind == "CallExpr") {
+        return generateFunctionCall(node);
+    }
+    else if (node->kind == "ArrayAccess" || node->kind == "Subscript") {
+        if (node->children.size() < 2) {
+            throw IRException("Array access requires array and index");
+        }
+        Operand arrayVar = var(node->children[0]->val);
+        Operand indexTemp = generateExpr(node->children[1]);
+        Operand resultTemp = newTemp(typeOf(arrayVar));
+        emit(Opcode::Load, resultTemp, arrayVar, indexTemp, typeOf(resultTemp));
+        return resultTemp;
+    }
+    else {
+        throw IRException("Unknown expression node kind: " + node->kind);
+    }
+}
+
+Operand IRGenerator::generateBinaryOp(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.size() < 2) {
+        throw IRException("Binary operation requires two operands");
+    }
+    
+    Opcode op = binaryOpcodeFor(node->val);
+    if (op == Opcode::And || op == Opcode::Or) {
+        return generateShortCircuit(node);
+    }
+    
+    Operand left = generateExpr(node->children[0]);
+    Operand right = generateExpr(node->children[1]);
+    
+    BasicType type = T_BOOL;
+    if (op >= Opcode::Add && op <= Opcode::Mod) {
+        BasicType lt = typeOf(left);
+        BasicType rt = typeOf(right);
+        if (lt == T_STRING && rt == T_STRING) type = T_STRING;
+        else if (lt == T_FLOAT || rt == T_FLOAT) type = T_FLOAT;
+        else if (lt == T_INT && rt == T_INT) type = T_INT;
+        else type = T_UNKNOWN;
+    }
+    
+    Operand resultTemp = newTemp(type);
+    emit(op, resultTemp, left, right, type);
+    return resultTemp;
+}
+
+// && and || used as values: the right side is only evaluated when the
+// left one does not decide the result.
+Operand IRGenerator::generateShortCircuit(const std::shared_ptr<ASTNode>& node) {
+    Operand resultTemp = newTemp(T_BOOL);
+    Operand labelFalse = newLabel();
+    Operand labelEnd = newLabel();
+    
+    generateCondition(node, Operand(), labelFalse);
+    emit(Opcode::Copy, resultTemp, literal("true"), Operand(), T_BOOL);
+    emit(Opcode::Goto, labelEnd);
+    emit(Opcode::Label, labelFalse);
+    emit(Opcode::Copy, resultTemp, literal("false"), Operand(), T_BOOL);
+    emit(Opcode::Label, labelEnd);
+    return resultTemp;
+}
+
+// Jumping code for a condition: control goes to trueLabel or falseLabel,
+// and an empty label means "fall through". && and || short-circuit,
+// comparisons branch directly and no boolean is materialized for them.
+void IRGenerator::generateCondition(const std::shared_ptr<ASTNode>& node, Operand trueLabel, Operand falseLabel) {
+    if ((node->kind == "BinaryOp" || node->kind == "BinaryExpr") && node->children.size() >= 2) {
+        Opcode op = binaryOpcodeFor(node->val);
+        if (op == Opcode::And) {
+            Operand labelSkip = falseLabel.empty() ? newLabel() : falseLabel;
+            generateCondition(node->children[0], Operand(), labelSkip);
+            generateCondition(node->children[1], trueLabel, falseLabel);
+            if (falseLabel.empty()) emit(Opcode::Label, labelSkip);
+            return;
+        }
+        if (op == Opcode::Or) {
+            Operand labelSkip = trueLabel.empty() ? newLabel() : trueLabel;
+            generateCondition(node->children[0], labelSkip, Operand());
+            generateCondition(node->children[1], trueLabel, falseLabel);
+            if (trueLabel.empty()) emit(Opcode::Label, labelSkip);
+            return;
+        }
+        if (op >= Opcode::Eq && op <= Opcode::Ge) {
+            Operand left = generateExpr(node->children[0]);
+            Operand right = generateExpr(node->children[1]);
+            if (!trueLabel.empty()) {
+                emit(fusedBranchFor(op), trueLabel, left, right);
+                if (!falseLabel.empty()) emit(Opcode::Goto, falseLabel);
+            } else if (!falseLabel.empty()) {
+                // ifFalse keeps NaN comparisons exact; == and != simply swap.
+                if (op == Opcode::Eq || op == Opcode::Ne) {
+                    emit(fusedBranchFor(op == Opcode::Eq ? Opcode::Ne : Opcode::Eq), falseLabel, left, right);
+                } else {
+                    TACInstruction branch(fusedBranchFor(op), falseLabel, left, right);
+                    branch.flags |= BRANCH_IF_FALSE;
+                    emit(branch);
+                }
+            }
+            return;
+        }
+    }
+    if (node->kind == "UnaryOp" && node->val == "!" && !node->children.empty()) {
+        generateCondition(node->children[0], falseLabel, trueLabel);
+        return;
+    }
+    if (node->kind == "Literal" && (node->val == "true" || node->val == "false")) {
+        Operand target = node->val == "true" ? trueLabel : falseLabel;
+        if (!target.empty()) emit(Opcode::Goto, target);
+        return;
+    }
+    
+    Operand condTemp = generateExpr(node);
+    if (!trueLabel.empty()) {
+        emit(Opcode::If, trueLabel, condTemp);
+        if (!falseLabel.empty()) emit(Opcode::Goto, falseLabel);
+    } else if (!falseLabel.empty()) {
+        emit(Opcode::IfFalse, falseLabel, condTemp);
+    }
+}
+
+Operand IRGenerator::generateUnaryOp(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        throw IRException("Unary operation requires one operand");
+    }
+    
+    Operand operand = generateExpr(node->children[0]);
+    std::string op = node->val;
+    BasicType type = op == "!" ? T_BOOL : typeOf(operand);
+    Operand resultTemp = newTemp(type);
+    
+    if (op == "!") {
+        emit(Opcode::Not, resultTemp, operand, Operand(), type);
+    }
+    else if (op == "-") {
+        emit(Opcode::Neg, resultTemp, operand, Operand(), type);
+    }
+    else if (op == "+") {
+        emit(Opcode::Pos, resultTemp, operand, Operand(), type);
+    }
+    else {
+        throw IRException("Unknown unary operator: " + op);
+    }
+    
+    return resultTemp;
+}
+
+Operand IRGenerator::generatePostfixOp(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        throw IRException("Postfix operation requires operand");
+    }
+    
+    auto operand = node->children[0];
+    if (!operand || operand->kind != "Identifier") {
+        throw IRException("Postfix operation requires identifier");
+    }
+    
+    Operand varOp = var(operand->val);
+    BasicType type = typeOf(varOp);
+    Operand resultTemp = newTemp(type);
+    std::string op = node->val;
+    
+    if (op == "++") {
+        emit(Opcode::Copy, resultTemp, varOp, Operand(), type);
+        Operand oneTemp = newTemp(T_INT);
+        emit(Opcode::Copy, oneTemp, literal("1"), Operand(), T_INT);
+        emit(Opcode::Add, varOp, varOp, oneTemp, type);
+    }
+    else if (op == "--") {
+        emit(Opcode::Copy, resultTemp, varOp, Operand(), type);
+        Operand oneTemp = newTemp(T_INT);
+        emit(Opcode::Copy, oneTemp, literal("1"), Operand(), T_INT);
+        emit(Opcode::Sub, varOp, varOp, oneTemp, type);
+    }
+    else {
+        throw IRException("Unknown postfix operator: " + op);
+    }
+    
+    return resultTemp;
+}
+
+Operand IRGenerator::generatePrefixOp(const std::shared_ptr<ASTNode>& node) {
+    if (node->children.empty()) {
+        throw IRException("Prefix operation requires operand");
+    }
+    
+    auto operand = node->children[0];
+    if (!operand || operand->kind != "Identifier") {
+        throw IRException("Prefix operation requires identifier");
+    }
+    
+    Operand varOp = var(operand->val);
+    BasicType type = typeOf(varOp);
+    std::string op = node->val;
+    
+    if (op == "++") {
+        Operand oneTemp = newTemp(T_INT);
+        emit(Opcode::Copy, oneTemp, literal("1"), Operand(), T_INT);
+        emit(Opcode::Add, varOp, varOp, oneTemp, type);
+        return varOp;
+    }
+    else if (op == "--") {
+        Operand oneTemp = newTemp(T_INT);
+        emit(Opcode::Copy, oneTemp, literal("1"), Operand(), T_INT);
+        emit(Opcode::Sub, varOp, varOp, oneTemp, type);
+        return varOp;
+    }
+    else {
+        throw IRException("Unknown prefix operator: " + op);
+    }
+}
+
+Operand IRGenerator::generateFunctionCall(const std::shared_ptr<ASTNode>& node) {
+    std::string funcName;
+    int argStartIndex = 0;
+    
+    if (!node->val.empty()) {
+        funcName = node->val;
+    } else if (!node->children.empty() && node->children[0]->kind == "Identifier") {
+        funcName = node->children[0]->val;
+        argStartIndex = 1;
+    } else {
+        throw IRException("Function call missing function name");
+    }
+    
+    std::vector<Operand> argTemps;
+    for (size_t i = argStartIndex; i < node->children.size(); ++i) {
+        if (node->children[i]->kind == "ArgumentList" || node->children[i]->kind == "Args") {
+            for (auto& arg : node->children[i]->children) {
+                Operand argTemp = generateExpr(arg);
+                argTemps.push_back(argTemp);
+            }
+        } else {
+            Operand argTemp = generateExpr(node->children[i]);
+            argTemps.push_back(argTemp);
+        }
+    }
+    
+    for (const auto& arg : argTemps) {
+        emit(Opcode::Param, arg, Operand(), Operand(), typeOf(arg));
+    }
+    
+    auto retIt = functionTypes.find(funcName);
+    BasicType retType = retIt == functionTypes.end() ? T_UNKNOWN : retIt->second;
+    Operand resultTemp = newTemp(retType);
+    IRSymbols& symbols = module.symbols();
+    Operand argCount = Operand::constant(symbols.internConstant(Value::makeInt(argTemps.size())));
+    emit(Opcode::Call, resultTemp, Operand::func(symbols.internName(funcName)), argCount, retType);
+    
+    return resultTemp;
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "ir_module.h"
+#include "ir_generator.h"
+
+bool IRModule::findFunction(const std::string& name, size_t& fn) const {
+    uint32_t nameIdx;
+    if (!syms.findName(name, nameIdx)) return false;
+    auto it = functionIndex.find(nameIdx);
+    if (it == functionIndex.end()) return false;
+    fn = it->second;
+    return true;
+}
+
+Span<const TACInstruction> IRModule::code(size_t fn) const {
+    const IRFunction& f = functions[fn];
+    return Span<const TACInstruction>(instructions.data() + f.codeBegin, f.codeSize);
+}
+
+Span<TACInstruction> IRModule::mutableCode(size_t fn) {
+    IRFunction& f = functions[fn];
+    ++f.revision;
+    return Span<TACInstruction>(instructions.data() + f.codeBegin, f.codeSize);
+}
+
+Span<const IRParam> IRModule::params(size_t fn) const {
+    const IRFunction& f = functions[fn];
+    return Span<const IRParam>(paramStorage.data() + f.paramBegin, f.paramCount);
+}
+
+size_t IRModule::instructionCount() const {
+    return instructions.size() - garbage;
+}
+
+size_t IRModule::addFunction(const std::string& name, BasicType returnType, const std::vector<IRParam>& params) {
+    uint32_t nameIdx = syms.internName(name);
+    if (functionIndex.count(nameIdx)) throw IRException("Function redefinition in IR module: " + name);
+
+    if (!functions.empty()) {
+        const IRFunction& last = functions.back();
+        if (last.codeBegin + last.codeSize != instructions.size()) compact();
+    }
+
+    IRFunction f;
+    f.name = nameIdx;
+    f.returnType = returnType;
+    f.paramBegin = static_cast<uint32_t>(paramStorage.size());
+    f.paramCount = static_cast<uint32_t>(params.size());
+    f.codeBegin = static_cast<uint32_t>(instructions.size());
+    f.codeSize = 0;
+    f.tempCount = 0;
+    f.labelCount = 0;
+    f.revision = 0;
+    f.ssa = false;
+    paramStorage.insert(paramStorage.end(), params.begin(), params.end());
+
+    functionIndex[nameIdx] = functions.size();
+    functions.push_back(f);
+    return functions.size() - 1;
+}
+
+void IRModule::append(const TACInstruction& instr) {
+    if (functions.empty()) throw IRException("Instruction emitted outside of a function");
+    IRFunction& f = functions.back();
+    if (f.codeBegin + f.codeSize != instructions.size()) {
+        std::vector<TACInstruction> body(code(functions.size() - 1).begin(), code(functions.size() - 1).end());
+        body.push_back(instr);
+        replaceCode(functions.size() - 1, body);
+        return;
+    }
+    instructions.push_back(instr);
+    ++f.codeSize;
+    ++f.revision;
+}
+
+void IRModule::append(const TACInstruction* block, size_t count) {
+    if (functions.empty()) throw IRException("Instruction emitted outside of a function");
+    IRFunction& f = functions.back();
+    if (f.codeBegin + f.codeSize != instructions.size()) {
+        std::vector<TACInstruction> body(code(functions.size() - 1).begin(), code(functions.size() - 1).end());
+        body.insert(body.end(), block, block + count);
+        replaceCode(functions.size() - 1, body);
+        return;
+    }
+    instructions.insert(instructions.end(), block, block + count);
+    f.codeSize += static_cast<uint32_t>(count);
+    ++f.revision;
+}
+
+Operand IRModule::newTemp(size_t fn) {
+    ++functions[fn].revision;
+    return Operand::temp(functions[fn].tempCount++);
+}
+
+Operand IRModule::newLabel(size_t fn) {
+    ++functions[fn].revision;
+    return Operand::label(functions[fn].labelCount++);
+}
+
+void IRModule::replaceCode(size_t fn, const std::vector<TACInstruction>& code) {
+    IRFunction& f = functions[fn];
+    ++f.revision;
+    if (code.size() <= f.codeSize) {
+        std::copy(code.begin(), code.end(), instructions.begin() + f.codeBegin);
+        garbage += f.codeSize - code.size();
+        f.codeSize = static_cast<uint32_t>(code.size());
+    } else {
+        garbage += f.codeSize;
+        f.codeBegin = static_cast<uint32_t>(instructions.size());
+        f.codeSize = static_cast<uint32_t>(code.size());
+        instructions.insert(instructions.end(), code.begin(), code.end());
+    }
+    if (garbage > instructions.size() / 2) compact();
+}
+
+void IRModule::compact() {
+    if (garbage == 0) return;
+    std::vector<TACInstruction> packed;
+    packed.reserve(instructions.size() - garbage);
+    for (auto& f : functions) {
+        uint32_t begin = static_cast<uint32_t>(packed.size());
+        packed.insert(packed.end(), instructions.begin() + f.codeBegin,
+                      instructions.begin() + f.codeBegin + f.codeSize);
+        f.codeBegin = begin;
+    }
+    instructions.swap(packed);
+    garbage = 0;
+}
+
+void IRModule::printFunction(std::ostream& out, size_t fn) const {
+    out << "func_" << functionName(fn) << ":" << std::endl;
+    for (const auto& p : params(fn)) {
+        out << "    param " << syms.name(p.name) << std::endl;
+    }
+    for (const auto& instr : code(fn)) {
+        out << instr.toString(syms) << std::endl;
+    }
+    out << "end_" << functionName(fn) << ":" << std::endl;
+}
+
+void IRModule::print(std::ostream& out) const {
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        printFunction(out, fn);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef IR_MODULE_H
+#define IR_MODULE_H
+
+#include "tac.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Non-owning view over contiguous storage.
+template <typename T>
+class Span {
+public:
+    Span() : ptr(nullptr), len(0) {}
+    Span(T* data, size_t size) : ptr(data), len(size) {}
+
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + len; }
+    T* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    T* ptr;
+    size_t len;
+};
+
+struct IRParam {
+    uint32_t name;      // name pool index
+    BasicType type;
+};
+
+// Per-function record. Temps and labels are numbered from zero within each
+// function; code and params are ranges into the module's shared storage.
+struct IRFunction {
+    uint32_t name;
+    BasicType returnType;
+    uint32_t paramBegin;
+    uint32_t paramCount;
+    uint32_t codeBegin;
+    uint32_t codeSize;
+    uint32_t tempCount;
+    uint32_t labelCount;
+    uint32_t revision;      // bumped on every change; keys cached analyses
+    bool ssa;
+};
+
+class IRModule {
+public:
+    IRSymbols& symbols() { return syms; }
+    const IRSymbols& symbols() const { return syms; }
+
+    size_t functionCount() const { return functions.size(); }
+    const IRFunction& function(size_t fn) const { return functions[fn]; }
+    const std::string& functionName(size_t fn) const { return syms.name(functions[fn].name); }
+    bool findFunction(const std::string& name, size_t& fn) const;
+
+    Span<const TACInstruction> code(size_t fn) const;
+    Span<TACInstruction> mutableCode(size_t fn);
+    Span<const IRParam> params(size_t fn) const;
+    size_t instructionCount() const;
+
+    // Building: functions are opened one at a time and code is appended to
+    // the most recently added one.
+    size_t addFunction(const std::string& name, BasicType returnType, const std::vector<IRParam>& params);
+    void append(const TACInstruction& instr);
+    void append(const TACInstruction* block, size_t count);
+    Operand newTemp(size_t fn);
+    Operand newLabel(size_t fn);
+    // For readers that restore a function's numbering rather than build it.
+    void setCounters(size_t fn, uint32_t temps, uint32_t labels) {
+        functions[fn].tempCount = temps;
+        functions[fn].labelCount = labels;
+        ++functions[fn].revision;
+    }
+    void setSSA(size_t fn, bool ssa) {
+        functions[fn].ssa = ssa;
+        ++functions[fn].revision;
+    }
+
+    // Replaces a function body. Shorter bodies are written in place; longer
+    // ones move to the end of storage and the hole is reclaimed by compact().
+    void replaceCode(size_t fn, const std::vector<TACInstruction>& code);
+    void compact();
+
+    void print(std::ostream& out) const;
+    void printFunction(std::ostream& out, size_t fn) const;
+
+private:
+    IRSymbols syms;
+    std::vector<TACInstruction> instructions;
+    std::vector<IRParam> paramStorage;
+    std::vector<IRFunction> functions;
+    std::unordered_map<uint32_t, size_t> functionIndex;
+    size_t garbage = 0;
+};
+
+#endif
@@ -0,0 +1,510 @@
+#include "jit.h"
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+enum Reg : uint8_t { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7, R8 = 8, R9 = 9 };
+const Reg INT_ARGS[] = {RDI, RSI, RDX, RCX, R8, R9};
+const size_t INT_ARG_COUNT = 6;
+const size_t FLOAT_ARG_COUNT = 8;
+
+enum Trap { TRAP_DIVISION = 1, TRAP_STACK = 2 };
+
+thread_local std::jmp_buf* activeTrap = nullptr;
+thread_local int trapKind = 0;
+thread_local int trapFunction = 0;
+
+[[noreturn]] void jitTrap(int kind, int fn) {
+    if (activeTrap) {
+        trapKind = kind;
+        trapFunction = fn;
+        std::longjmp(*activeTrap, 1);
+    }
+    std::fprintf(stderr, "JIT trap %d in function %d\n", kind, fn);
+    std::abort();
+}
+
+// A frame slot below rbp, or an entry of the function's constant pool.
+struct Mem {
+    bool pool;
+    int32_t disp;
+    uint32_t index;
+};
+
+class Assembler {
+public:
+    std::vector<uint8_t> bytes;
+
+    size_t here() const { return bytes.size(); }
+    void byte(uint8_t b) { bytes.push_back(b); }
+    void bytes2(uint8_t a, uint8_t b) { byte(a); byte(b); }
+    void bytes3(uint8_t a, uint8_t b, uint8_t c) { byte(a); byte(b); byte(c); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(v >> (8 * i))); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(v >> (8 * i))); }
+    void patch32(size_t at, int64_t v) {
+        for (int i = 0; i < 4; ++i) bytes[at + i] = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (8 * i));
+    }
+    void align(size_t n) { while (bytes.size() % n) byte(0xCC); }
+};
+
+struct Fixup {
+    size_t at;          // rel32 field
+    size_t target;
+};
+
+class FunctionEmitter {
+public:
+    FunctionEmitter(Assembler& as, const BytecodeVM& vm, size_t fn, const std::vector<void*>& compiled,
+                    std::vector<Fixup>& calls, const uintptr_t* stackLimit)
+        : as(as), vm(vm), fn(fn), f(vm.function(fn)), compiled(compiled), calls(calls), stackLimit(stackLimit) {}
+
+    void emit();
+
+private:
+    Assembler& as;
+    const BytecodeVM& vm;
+    size_t fn;
+    const BytecodeFunction& f;
+    const std::vector<void*>& compiled;
+    std::vector<Fixup>& calls;
+    const uintptr_t* stackLimit;
+
+    std::vector<Fixup> pool;            // target is the constant index
+    std::vector<Fixup> branches;        // target is the bytecode index
+    std::vector<Fixup> traps;           // target is the Trap kind
+
+    Mem slot(uint32_t s) const { return Mem{false, -8 * static_cast<int32_t>(s + 1), 0}; }
+    Mem mem(uint32_t r) const {
+        uint32_t constants = static_cast<uint32_t>(f.constants.size());
+        if (r < f.constBase) return slot(r);
+        if (r < f.constBase + constants) return Mem{true, 0, r - f.constBase};
+        return slot(r - constants);
+    }
+
+    void modrm(uint8_t reg, const Mem& m) {
+        if (m.pool) {
+            as.byte(static_cast<uint8_t>(0x05 | ((reg & 7) << 3)));
+            pool.push_back(Fixup{as.here(), m.index});
+            as.u32(0);
+        } else {
+            as.byte(static_cast<uint8_t>(0x85 | ((reg & 7) << 3)));
+            as.u32(static_cast<uint32_t>(m.disp));
+        }
+    }
+    void rexW(uint8_t reg) { as.byte(static_cast<uint8_t>(0x48 | (reg >= 8 ? 4 : 0))); }
+    void load(uint8_t reg, const Mem& m) { rexW(reg); as.byte(0x8B); modrm(reg, m); }
+    void store(const Mem& m, uint8_t reg) { rexW(reg); as.byte(0x89); modrm(reg, m); }
+    void alu(uint8_t opcode, uint8_t reg, const Mem& m) { rexW(reg); as.byte(opcode); modrm(reg, m); }
+    void sse(uint8_t prefix, uint8_t opcode, uint8_t xmm, const Mem& m, bool wide = false) {
+        as.byte(prefix);
+        if (wide) as.byte(0x48);
+        as.bytes2(0x0F, opcode);
+        modrm(xmm, m);
+    }
+    void loadF(uint8_t xmm, const Mem& m) { sse(0xF2, 0x10, xmm, m); }
+    void storeF(const Mem& m, uint8_t xmm) { sse(0xF2, 0x11, xmm, m); }
+
+    void jump(uint8_t cc, size_t target, std::vector<Fixup>& list) {
+        if (cc == 0xFF) as.byte(0xE9);
+        else as.bytes2(0x0F, static_cast<uint8_t>(0x80 | cc));
+        list.push_back(Fixup{as.here(), target});
+        as.u32(0);
+    }
+    void setcc(uint8_t cc, uint8_t reg8) { as.bytes3(0x0F, static_cast<uint8_t>(0x90 | cc), static_cast<uint8_t>(0xC0 | reg8)); }
+    void zeroExtendAL() { as.bytes3(0x0F, 0xB6, 0xC0); }
+    void movImm64(uint8_t reg, uint64_t v) { as.bytes2(0x48, static_cast<uint8_t>(0xB8 | reg)); as.u64(v); }
+    void leaveRet() { as.bytes2(0xC9, 0xC3); }
+
+    void prologue();
+    void instruction(const VMInstr& vi);
+    void divide(const VMInstr& vi);
+};
+
+// Condition codes.
+enum : uint8_t { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_P = 0xA, CC_NP = 0xB,
+                 CC_L = 0xC, CC_LE = 0xE, CC_ALWAYS = 0xFF };
+
+void FunctionEmitter::prologue() {
+    uint32_t slots = f.frameSize - static_cast<uint32_t>(f.constants.size());
+    uint32_t frameBytes = (8 * slots + 15) & ~15u;
+    as.byte(0x55);                                  // push rbp
+    as.bytes3(0x48, 0x89, 0xE5);                    // mov rbp, rsp
+    as.bytes3(0x48, 0x81, 0xEC);                    // sub rsp, frame
+    as.u32(frameBytes);
+    movImm64(RAX, reinterpret_cast<uint64_t>(stackLimit));
+    as.bytes3(0x48, 0x3B, 0x20);                    // cmp rsp, [rax]
+    jump(CC_B, TRAP_STACK, traps);
+
+    size_t ints = 0, floats = 0;
+    for (size_t p = 0; p < f.paramTypes.size(); ++p) {
+        if (f.paramTypes[p] == T_FLOAT) storeF(slot(static_cast<uint32_t>(p)), static_cast<uint8_t>(floats++));
+        else store(slot(static_cast<uint32_t>(p)), INT_ARGS[ints++]);
+    }
+    // Locals start at zero, as in the VM.
+    if (f.paramTypes.size() < f.constBase) as.bytes2(0x31, 0xC0);     // xor eax, eax
+    for (uint32_t s = static_cast<uint32_t>(f.paramTypes.size()); s < f.constBase; ++s) store(slot(s), RAX);
+}
+
+void FunctionEmitter::divide(const VMInstr& vi) {
+    load(RAX, mem(vi.b));
+    load(RCX, mem(vi.c));
+    as.bytes3(0x48, 0x85, 0xC9);                    // test rcx, rcx
+    jump(CC_E, TRAP_DIVISION, traps);
+    as.bytes2(0x48, 0x83); as.bytes2(0xF9, 0xFF);   // cmp rcx, -1
+    as.bytes2(0x75, 19);                            // jne over the overflow check
+    movImm64(RDX, 0x8000000000000000ull);
+    as.bytes3(0x48, 0x39, 0xD0);                    // cmp rax, rdx
+    jump(CC_E, TRAP_DIVISION, traps);
+    as.bytes2(0x48, 0x99);                          // cqo
+    as.bytes3(0x48, 0xF7, 0xF9);                    // idiv rcx
+    store(mem(vi.a), vi.op == VMOp::DivI ? RAX : RDX);
+}
+
+void FunctionEmitter::instruction(const VMInstr& vi) {
+    switch (vi.op) {
+        case VMOp::Mov:
+            load(RAX, mem(vi.b));
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::AddI:
+        case VMOp::SubI:
+            load(RAX, mem(vi.b));
+            alu(vi.op == VMOp::AddI ? 0x03 : 0x2B, RAX, mem(vi.c));
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::MulI:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0x0F, 0xAF);            // imul rax, m64
+            modrm(RAX, mem(vi.c));
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::DivI:
+        case VMOp::ModI:
+            divide(vi);
+            break;
+        case VMOp::AddF:
+        case VMOp::SubF:
+        case VMOp::MulF:
+        case VMOp::DivF: {
+            static const uint8_t ops[] = {0x58, 0x5C, 0x59, 0x5E};
+            loadF(0, mem(vi.b));
+            sse(0xF2, ops[static_cast<int>(vi.op) - static_cast<int>(VMOp::AddF)], 0, mem(vi.c));
+            storeF(mem(vi.a), 0);
+            break;
+        }
+        case VMOp::EqI:
+        case VMOp::NeI:
+        case VMOp::LtI:
+        case VMOp::LeI: {
+            static const uint8_t cc[] = {CC_E, CC_NE, CC_L, CC_LE};
+            load(RAX, mem(vi.b));
+            alu(0x3B, RAX, mem(vi.c));
+            setcc(cc[static_cast<int>(vi.op) - static_cast<int>(VMOp::EqI)], 0);
+            zeroExtendAL();
+            store(mem(vi.a), RAX);
+            break;
+        }
+        // ucomisd reports unordered as ZF=PF=CF=1, so NaN operands make
+        // every comparison but != false.
+        case VMOp::EqF:
+        case VMOp::NeF:
+            loadF(0, mem(vi.b));
+            sse(0x66, 0x2E, 0, mem(vi.c));
+            if (vi.op == VMOp::EqF) {
+                setcc(CC_E, 0);
+                setcc(CC_NP, 1);
+                as.bytes2(0x20, 0xC8);              // and al, cl
+            } else {
+                setcc(CC_NE, 0);
+                setcc(CC_P, 1);
+                as.bytes2(0x08, 0xC8);              // or al, cl
+            }
+            zeroExtendAL();
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::LtF:
+        case VMOp::LeF:
+            loadF(0, mem(vi.c));                    // b < c as c > b
+            sse(0x66, 0x2E, 0, mem(vi.b));
+            setcc(vi.op == VMOp::LtF ? CC_A : CC_AE, 0);
+            zeroExtendAL();
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::And:
+        case VMOp::Or:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0x85, 0xC0);            // test rax, rax
+            setcc(CC_NE, 0);
+            load(RCX, mem(vi.c));
+            as.bytes3(0x48, 0x85, 0xC9);            // test rcx, rcx
+            setcc(CC_NE, 1);
+            as.bytes2(vi.op == VMOp::And ? 0x20 : 0x08, 0xC8);
+            zeroExtendAL();
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::Not:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0x85, 0xC0);
+            setcc(CC_E, 0);
+            zeroExtendAL();
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::NegI:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0xF7, 0xD8);            // neg rax
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::NegF:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0x0F, 0xBA); as.bytes2(0xF8, 63);   // btc rax, 63
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::IntToFloat:
+            as.bytes3(0x0F, 0x57, 0xC0);            // xorps xmm0, xmm0
+            sse(0xF2, 0x2A, 0, mem(vi.b), true);    // cvtsi2sd xmm0, m64
+            storeF(mem(vi.a), 0);
+            break;
+        case VMOp::FloatToInt:
+            sse(0xF2, 0x2C, RAX, mem(vi.b), true);  // cvttsd2si rax, m64
+            store(mem(vi.a), RAX);
+            break;
+        case VMOp::Jump:
+            jump(CC_ALWAYS, vi.a, branches);
+            break;
+        case VMOp::JumpIfTrue:
+        case VMOp::JumpIfFalse:
+            load(RAX, mem(vi.b));
+            as.bytes3(0x48, 0x85, 0xC0);
+            jump(vi.op == VMOp::JumpIfTrue ? CC_NE : CC_E, vi.a, branches);
+            break;
+        case VMOp::JumpEqI:
+        case VMOp::JumpNeI:
+        case VMOp::JumpLtI:
+        case VMOp::JumpLeI: {
+            static const uint8_t cc[] = {CC_E, CC_NE, CC_L, CC_LE};
+            load(RAX, mem(vi.b));
+            alu(0x3B, RAX, mem(vi.c));
+            jump(cc[static_cast<int>(vi.op) - static_cast<int>(VMOp::JumpEqI)], vi.a, branches);
+            break;
+        }
+        case VMOp::JumpEqF:
+            loadF(0, mem(vi.b));
+            sse(0x66, 0x2E, 0, mem(vi.c));
+            as.bytes2(0x7A, 6);                     // jp over the je
+            jump(CC_E, vi.a, branches);
+            break;
+        case VMOp::JumpNeF:
+            loadF(0, mem(vi.b));
+            sse(0x66, 0x2E, 0, mem(vi.c));
+            jump(CC_P, vi.a, branches);
+            jump(CC_NE, vi.a, branches);
+            break;
+        case VMOp::JumpLtF:
+        case VMOp::JumpLeF:
+            loadF(0, mem(vi.c));
+            sse(0x66, 0x2E, 0, mem(vi.b));
+            jump(vi.op == VMOp::JumpLtF ? CC_A : CC_AE, vi.a, branches);
+            break;
+        case VMOp::Call:
+        case VMOp::CallNative: {
+            const BytecodeFunction& callee = vm.function(vi.b);
+            size_t ints = 0, floats = 0;
+            for (size_t p = 0; p < callee.paramTypes.size(); ++p) {
+                Mem arg = mem(vi.c + static_cast<uint32_t>(p));
+                if (callee.paramTypes[p] == T_FLOAT) loadF(static_cast<uint8_t>(floats++), arg);
+                else load(INT_ARGS[ints++], arg);
+            }
+            if (compiled[vi.b]) {
+                movImm64(RAX, reinterpret_cast<uint64_t>(compiled[vi.b]));
+                as.bytes2(0xFF, 0xD0);              // call rax
+            } else {
+                as.byte(0xE8);
+                calls.push_back(Fixup{as.here(), vi.b});
+                as.u32(0);
+            }
+            if (callee.returnType == T_FLOAT) storeF(mem(vi.a), 0);
+            else store(mem(vi.a), RAX);
+            break;
+        }
+        case VMOp::Return:
+            if (f.returnType == T_FLOAT) loadF(0, mem(vi.a));
+            else load(RAX, mem(vi.a));
+            leaveRet();
+            break;
+        case VMOp::ReturnVoid:
+            as.bytes2(0x31, 0xC0);
+            leaveRet();
+            break;
+        case VMOp::Unlowered:
+            throw JITException("Cannot compile " + f.name + ": " + f.loweringError);
+    }
+}
+
+void FunctionEmitter::emit() {
+    size_t ints = 0, floats = 0;
+    for (BasicType t : f.paramTypes) (t == T_FLOAT ? floats : ints)++;
+    if (ints > INT_ARG_COUNT || floats > FLOAT_ARG_COUNT)
+        throw JITException("Cannot compile " + f.name + ": too many params for registers");
+
+    prologue();
+    std::vector<size_t> offsets(f.code.size());
+    for (size_t i = 0; i < f.code.size(); ++i) {
+        offsets[i] = as.here();
+        instruction(f.code[i]);
+    }
+    for (const Fixup& b : branches) as.patch32(b.at, static_cast<int64_t>(offsets[b.target]) - (b.at + 4));
+
+    size_t stubs[3] = {0, 0, 0};
+    for (int kind : {TRAP_DIVISION, TRAP_STACK}) {
+        stubs[kind] = as.here();
+        as.byte(0xBF); as.u32(static_cast<uint32_t>(kind));             // mov edi, kind
+        as.byte(0xBE); as.u32(static_cast<uint32_t>(fn));               // mov esi, fn
+        movImm64(RAX, reinterpret_cast<uint64_t>(&jitTrap));
+        as.bytes2(0xFF, 0xD0);
+    }
+    for (const Fixup& t : traps) as.patch32(t.at, static_cast<int64_t>(stubs[t.target]) - (t.at + 4));
+
+    as.align(8);
+    size_t poolStart = as.here();
+    for (const VMSlot& k : f.constants) as.u64(static_cast<uint64_t>(k.i));
+    for (const Fixup& p : pool) as.patch32(p.at, static_cast<int64_t>(poolStart + 8 * p.target) - (p.at + 4));
+}
+
+// int64_t trampoline(const VMSlot* args): loads the arguments into their
+// System V registers, calls the function and returns the result bits.
+void emitTrampoline(Assembler& as, const BytecodeFunction& f, size_t fn, std::vector<Fixup>& calls) {
+    as.byte(0x55);
+    as.bytes3(0x48, 0x89, 0xE5);
+    as.bytes3(0x49, 0x89, 0xFB);                    // mov r11, rdi
+    size_t ints = 0, floats = 0;
+    for (size_t p = 0; p < f.paramTypes.size(); ++p) {
+        uint8_t disp = static_cast<uint8_t>(8 * p);
+        if (f.paramTypes[p] == T_FLOAT) {
+            uint8_t xmm = static_cast<uint8_t>(floats++);
+            as.bytes2(0xF2, 0x41); as.bytes2(0x0F, 0x10);
+            as.bytes2(static_cast<uint8_t>(0x43 | (xmm << 3)), disp);   // movsd xmm, [r11+disp]
+        } else {
+            uint8_t reg = INT_ARGS[ints++];
+            as.bytes2(static_cast<uint8_t>(0x49 | (reg >= 8 ? 4 : 0)), 0x8B);
+            as.bytes2(static_cast<uint8_t>(0x43 | ((reg & 7) << 3)), disp); // mov reg, [r11+disp]
+        }
+    }
+    as.byte(0xE8);
+    calls.push_back(Fixup{as.here(), fn});
+    as.u32(0);
+    if (f.returnType == T_FLOAT) {
+        as.bytes3(0x66, 0x48, 0x0F); as.bytes2(0x7E, 0xC0);             // movq rax, xmm0
+    }
+    as.bytes2(0xC9, 0xC3);
+}
+
+}
+
+JIT::~JIT() {
+    for (const Buffer& b : buffers) ::munmap(b.base, b.size);
+}
+
+void JIT::compile(size_t fn) {
+    if (compiled(fn)) return;
+
+    std::vector<size_t> order;
+    std::vector<char> queued(vm.functionCount(), 0);
+    std::vector<size_t> worklist = {fn};
+    queued[fn] = 1;
+    while (!worklist.empty()) {
+        size_t next = worklist.back();
+        worklist.pop_back();
+        order.push_back(next);
+        for (const VMInstr& vi : vm.function(next).code) {
+            if ((vi.op == VMOp::Call || vi.op == VMOp::CallNative) && !compiled(vi.b) && !queued[vi.b]) {
+                queued[vi.b] = 1;
+                worklist.push_back(vi.b);
+            }
+        }
+    }
+
+    Assembler as;
+    std::vector<Fixup> calls;
+    std::vector<size_t> start(vm.functionCount(), 0), trampoline(vm.functionCount(), 0);
+    for (size_t f : order) {
+        as.align(16);
+        start[f] = as.here();
+        FunctionEmitter(as, vm, f, entries, calls, &stackLimit).emit();
+    }
+    std::vector<Fixup> trampolineCalls;
+    for (size_t f : order) {
+        as.align(16);
+        trampoline[f] = as.here();
+        emitTrampoline(as, vm.function(f), f, trampolineCalls);
+    }
+    calls.insert(calls.end(), trampolineCalls.begin(), trampolineCalls.end());
+    for (const Fixup& c : calls) as.patch32(c.at, static_cast<int64_t>(start[c.target]) - (c.at + 4));
+
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t size = (as.bytes.size() + page - 1) / page * page;
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) throw JITException("Cannot map JIT code buffer");
+    std::memcpy(base, as.bytes.data(), as.bytes.size());
+    if (::mprotect(base, size, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(base, size);
+        throw JITException("Cannot make JIT code executable");
+    }
+    buffers.push_back(Buffer{base, size});
+    totalBytes += as.bytes.size();
+
+    uint8_t* code = static_cast<uint8_t*>(base);
+    for (size_t f : order) {
+        entries[f] = code + start[f];
+        trampolines[f] = code + trampoline[f];
+    }
+}
+
+void JIT::compileAll() {
+    for (size_t fn = 0; fn < vm.functionCount(); ++fn) compile(fn);
+}
+
+Value JIT::call(const std::string& name, const std::vector<Value>& args) {
+    size_t fn;
+    if (!vm.findFunction(name, fn)) throw VMException("No function named " + name);
+    return call(fn, args);
+}
+
+Value JIT::call(size_t fn, const std::vector<Value>& args, size_t stackBudget) {
+    const BytecodeFunction& f = vm.function(fn);
+    if (args.size() != f.paramTypes.size()) {
+        throw VMException(f.name + " takes " + std::to_string(f.paramTypes.size()) + " arguments, got " +
+                          std::to_string(args.size()));
+    }
+    compile(fn);
+    std::vector<VMSlot> slots;
+    for (size_t i = 0; i < args.size(); ++i) slots.push_back(toSlot(args[i], f.paramTypes[i]));
+    return fromSlot(invoke(fn, slots.data(), stackBudget), f.returnType);
+}
+
+VMSlot JIT::invoke(size_t fn, const VMSlot* args, size_t stackBudget) {
+    typedef int64_t (*Trampoline)(const VMSlot*);
+    Trampoline entry = reinterpret_cast<Trampoline>(trampolines[fn]);
+    std::jmp_buf env;
+    std::jmp_buf* outer = activeTrap;
+    uintptr_t outerLimit = stackLimit;
+    char marker;
+    stackLimit = reinterpret_cast<uintptr_t>(&marker) - stackBudget;
+    activeTrap = &env;
+    if (setjmp(env)) {
+        activeTrap = outer;
+        stackLimit = outerLimit;
+        const std::string& where = vm.function(static_cast<size_t>(trapFunction)).name;
+        if (trapKind == TRAP_DIVISION) throw VMException("Integer division error in " + where);
+        throw VMException("Stack overflow calling " + where);
+    }
+    VMSlot result;
+    result.i = entry(args);
+    activeTrap = outer;
+    stackLimit = outerLimit;
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "bytecode_vm.h"
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+
+class JITException : public std::exception
+{
+    std::string message;
+public:
+    explicit JITException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// x86-64 code generator over the VM's typed register form. Every register
+// gets a stack slot, constants sit in a RIP-relative pool after each
+// function, ints go through rax/rcx and floats through xmm0 with SSE2.
+// Compiled functions follow the System V ABI (up to 6 int and 8 float
+// params), so address() can be cast to the matching C++ function type.
+//
+// compile() emits a function and every uncompiled function it can reach
+// into one fresh buffer, written while mapped read-write and then flipped
+// to read-execute. Calls into earlier buffers bind to their absolute
+// address. Integer division errors and running past the stack budget
+// trap back into call(), which rethrows them as VMExceptions; code entered
+// directly through address() aborts on those traps instead.
+class JIT {
+public:
+    static const size_t DEFAULT_STACK_BUDGET = 4 << 20;
+
+    explicit JIT(const BytecodeVM& vm) : vm(vm), entries(vm.functionCount(), nullptr),
+                                         trampolines(vm.functionCount(), nullptr) {}
+    ~JIT();
+    JIT(const JIT&) = delete;
+    JIT& operator=(const JIT&) = delete;
+
+    void compile(size_t fn);
+    void compileAll();
+    bool compiled(size_t fn) const { return entries[fn] != nullptr; }
+    void* address(size_t fn) const { return entries[fn]; }
+
+    Value call(size_t fn, const std::vector<Value>& args, size_t stackBudget = DEFAULT_STACK_BUDGET);
+    Value call(const std::string& name, const std::vector<Value>& args);
+    // Runs compiled fn on its params' registers, trapping like call().
+    VMSlot invoke(size_t fn, const VMSlot* args, size_t stackBudget = DEFAULT_STACK_BUDGET);
+
+    size_t codeBytes() const { return totalBytes; }
+
+private:
+    struct Buffer {
+        void* base;
+        size_t size;
+    };
+
+    const BytecodeVM& vm;
+    std::vector<void*> entries;
+    std::vector<void*> trampolines;     // int64_t(const VMSlot* args)
+    std::vector<Buffer> buffers;
+    size_t totalBytes = 0;
+    uintptr_t stackLimit = 0;           // read by every compiled prologue
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "linker.h"
+#include <unordered_map>
+#include <utility>
+
+void Linker::add(IRModule module, const std::string& origin) {
+    modules.push_back(Input{std::move(module), origin});
+}
+
+IRModule Linker::link(const std::vector<std::string>& entries) {
+    typedef std::pair<size_t, size_t> Definition;       // module, function
+    std::unordered_map<std::string, Definition> definitions;
+    std::vector<std::string> errors;
+
+    totalFunctions = 0;
+    for (size_t m = 0; m < modules.size(); ++m) {
+        const IRModule& module = modules[m].module;
+        totalFunctions += module.functionCount();
+        for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+            auto inserted = definitions.insert({module.functionName(fn), Definition(m, fn)});
+            if (!inserted.second) {
+                errors.push_back("duplicate symbol " + module.functionName(fn) + " in " + modules[m].origin +
+                                 " (first defined in " + modules[inserted.first->second.first].origin + ")");
+            }
+        }
+    }
+
+    std::vector<std::vector<char>> reachable(modules.size());
+    for (size_t m = 0; m < modules.size(); ++m) reachable[m].assign(modules[m].module.functionCount(), 0);
+    std::vector<Definition> worklist;
+    auto mark = [&](const Definition& d) {
+        if (reachable[d.first][d.second]) return;
+        reachable[d.first][d.second] = 1;
+        worklist.push_back(d);
+    };
+
+    if (!entries.empty()) {
+        for (const auto& name : entries) {
+            auto it = definitions.find(name);
+            if (it == definitions.end()) errors.push_back("undefined entry point " + name);
+            else mark(it->second);
+        }
+    } else if (definitions.count("main")) {
+        mark(definitions["main"]);
+    } else if (!modules.empty()) {
+        for (size_t fn = 0; fn < modules[0].module.functionCount(); ++fn) mark(Definition(0, fn));
+    }
+
+    while (!worklist.empty()) {
+        Definition d = worklist.back();
+        worklist.pop_back();
+        const IRModule& module = modules[d.first].module;
+        for (const TACInstruction& instr : module.code(d.second)) {
+            if (instr.op != Opcode::Call) continue;
+            const std::string& callee = module.symbols().name(instr.arg1.index());
+            auto it = definitions.find(callee);
+            if (it == definitions.end()) {
+                errors.push_back("undefined symbol " + callee + " called from " + module.functionName(d.second) +
+                                 " in " + modules[d.first].origin);
+                continue;
+            }
+            const IRModule& target = modules[it->second.first].module;
+            const Value& argc = module.symbols().constant(instr.arg2.index());
+            if (argc.i != static_cast<int64_t>(target.function(it->second.second).paramCount)) {
+                errors.push_back("call to " + callee + " from " + module.functionName(d.second) + " passes " +
+                                 std::to_string(argc.i) + " arguments, " + modules[it->second.first].origin +
+                                 " defines " + std::to_string(target.function(it->second.second).paramCount));
+            }
+            mark(it->second);
+        }
+    }
+
+    if (!errors.empty()) {
+        std::string message = "Link failed:";
+        for (const auto& e : errors) message += "\n  " + e;
+        throw LinkException(message);
+    }
+
+    // Copy the kept functions in input order, re-interning each module's
+    // names and constants into the linked module's pools.
+    IRModule linked;
+    IRSymbols& syms = linked.symbols();
+    keptFunctions = 0;
+    keptInstructions = 0;
+    std::vector<TACInstruction> body;
+    for (size_t m = 0; m < modules.size(); ++m) {
+        const IRModule& module = modules[m].module;
+        const IRSymbols& from = module.symbols();
+        std::vector<uint32_t> names(from.nameCount(), UINT32_MAX);
+        std::vector<uint32_t> constants(from.constantCount(), UINT32_MAX);
+        auto remap = [&](Operand o) {
+            switch (o.kind()) {
+                case OperandKind::Var:
+                case OperandKind::Func:
+                    if (names[o.index()] == UINT32_MAX) names[o.index()] = syms.internName(from.name(o.index()));
+                    return Operand(o.kind(), names[o.index()]);
+                case OperandKind::Const:
+                    if (constants[o.index()] == UINT32_MAX)
+                        constants[o.index()] = syms.internConstant(from.constant(o.index()), from.constantText(o.index()));
+                    return Operand::constant(constants[o.index()]);
+                default:
+                    return o;
+            }
+        };
+
+        for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+            if (!reachable[m][fn]) continue;
+            const IRFunction& f = module.function(fn);
+            std::vector<IRParam> params;
+            for (const IRParam& p : module.params(fn)) {
+                params.push_back(IRParam{remap(Operand::var(p.name)).index(), p.type});
+            }
+            size_t index = linked.addFunction(module.functionName(fn), f.returnType, params);
+            body.clear();
+            for (TACInstruction instr : module.code(fn)) {
+                instr.result = remap(instr.result);
+                instr.arg1 = remap(instr.arg1);
+                instr.arg2 = remap(instr.arg2);
+                body.push_back(instr);
+            }
+            linked.append(body.data(), body.size());
+            linked.setCounters(index, f.tempCount, f.labelCount);
+            linked.setSSA(index, f.ssa);
+            ++keptFunctions;
+            keptInstructions += body.size();
+        }
+    }
+    return linked;
+}
@@ -0,0 +1,46 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "ir_module.h"
+#include <exception>
+#include <string>
+#include <vector>
+
+class LinkException : public std::exception
+{
+    std::string message;
+public:
+    explicit LinkException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// Links IR modules into one. Calls resolve by function name across all
+// added modules; only functions reachable from the entry points are kept.
+// With no entry points, `main` is the root if some module defines it,
+// otherwise every function of the first module is. Duplicate definitions,
+// calls to functions no module defines and argument-count mismatches are
+// collected and reported together in one LinkException. Unreachable
+// functions are not checked.
+class Linker {
+public:
+    void add(IRModule module, const std::string& origin);
+    IRModule link(const std::vector<std::string>& entries = {});
+
+    size_t modulesLinked() const { return modules.size(); }
+    size_t functionsIn() const { return totalFunctions; }
+    size_t functionsKept() const { return keptFunctions; }
+    size_t instructionsKept() const { return keptInstructions; }
+
+private:
+    struct Input {
+        IRModule module;
+        std::string origin;
+    };
+
+    std::vector<Input> modules;
+    size_t totalFunctions = 0;
+    size_t keptFunctions = 0;
+    size_t keptInstructions = 0;
+};
+
+#endif
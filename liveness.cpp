@@ -0,0 +1,185 @@
+#include "liveness.h"
+#include <algorithm>
+
+const uint32_t LocalSymbols::NONE;
+
+void LocalSymbols::add(Operand o) {
+    uint32_t next = static_cast<uint32_t>(operands.size());
+    if (o.isVar()) {
+        if (!varIds.emplace(o.index(), next).second) return;
+    } else if (o.isTemp()) {
+        if (o.index() >= tempIds.size()) tempIds.resize(o.index() + 1, NONE);
+        if (tempIds[o.index()] != NONE) return;
+        tempIds[o.index()] = next;
+    } else {
+        return;
+    }
+    operands.push_back(o);
+}
+
+void LocalSymbols::build(const IRModule& module, size_t fn, const CFG* globalsOnly) {
+    varIds.clear();
+    tempIds.assign(module.function(fn).tempCount, NONE);
+    operands.clear();
+    Span<const TACInstruction> code = module.code(fn);
+
+    if (!globalsOnly) {
+        for (const auto& p : module.params(fn)) add(Operand::var(p.name));
+        for (const auto& instr : code) {
+            add(instr.result);
+            add(instr.arg1);
+            if (!instr.arg2.isLabel()) add(instr.arg2);
+        }
+        return;
+    }
+
+    // Upward-exposed uses per block; the defined-in-block set is tracked
+    // with a generation stamp so it need not be cleared between blocks.
+    std::unordered_map<uint32_t, uint32_t> varStamp;
+    std::vector<uint32_t> tempStamp(module.function(fn).tempCount, 0);
+    auto stampOf = [&](Operand o) -> uint32_t* {
+        if (o.isVar()) return &varStamp[o.index()];
+        if (o.isTemp() && o.index() < tempStamp.size()) return &tempStamp[o.index()];
+        return nullptr;
+    };
+    for (uint32_t b = 0; b < globalsOnly->size(); ++b) {
+        uint32_t stamp = b + 1;
+        const BasicBlock& bb = globalsOnly->block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            const TACInstruction& instr = code[i];
+            if (instr.op == Opcode::Phi) {
+                add(instr.arg1);
+            } else {
+                uint8_t mask = useMask(instr);
+                Operand uses[3] = {instr.result, instr.arg1, instr.arg2};
+                for (int k = 0; k < 3; ++k) {
+                    if (!(mask & (1 << k))) continue;
+                    uint32_t* st = stampOf(uses[k]);
+                    if (st && *st != stamp) add(uses[k]);
+                }
+            }
+            if (definesResult(instr)) {
+                uint32_t* st = stampOf(instr.result);
+                if (st) *st = stamp;
+            }
+        }
+    }
+}
+
+uint32_t LocalSymbols::id(Operand o) const {
+    if (o.isTemp()) return o.index() < tempIds.size() ? tempIds[o.index()] : NONE;
+    if (o.isVar()) {
+        auto it = varIds.find(o.index());
+        return it == varIds.end() ? NONE : it->second;
+    }
+    return NONE;
+}
+
+void Liveness::compute(const IRModule& module, size_t fn, const CFG& cfg, const LocalSymbols& symbols) {
+    Span<const TACInstruction> code = module.code(fn);
+    size_t n = cfg.size();
+    std::vector<BitSet> gen(n), kill(n);
+    in.assign(n, BitSet());
+    out.assign(n, BitSet());
+    for (size_t b = 0; b < n; ++b) {
+        gen[b].resize(symbols.size());
+        kill[b].resize(symbols.size());
+        in[b].resize(symbols.size());
+        out[b].resize(symbols.size());
+    }
+
+    auto use = [&](uint32_t b, Operand o) {
+        uint32_t id = symbols.id(o);
+        if (id != LocalSymbols::NONE && !kill[b].test(id)) gen[b].set(id);
+    };
+
+    for (uint32_t b = 0; b < n; ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            const TACInstruction& instr = code[i];
+            if (instr.op == Opcode::Phi) {
+                // The incoming value is used at the end of its predecessor.
+                uint32_t pred = cfg.blockOfLabel(instr.arg2.index());
+                uint32_t id = symbols.id(instr.arg1);
+                if (id != LocalSymbols::NONE) out[pred].set(id);
+            } else {
+                uint8_t mask = useMask(instr);
+                if (mask & USE_RESULT) use(b, instr.result);
+                if (mask & USE_ARG1) use(b, instr.arg1);
+                if (mask & USE_ARG2) use(b, instr.arg2);
+            }
+            if (definesResult(instr)) {
+                uint32_t id = symbols.id(instr.result);
+                if (id != LocalSymbols::NONE) kill[b].set(id);
+            }
+        }
+    }
+
+    // Phi uses recorded in out[] seed the fixed point and are kept as a
+    // floor, so copy them aside before iterating.
+    std::vector<BitSet> phiOut = out;
+    const std::vector<uint32_t>& rpo = cfg.reversePostorder();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t k = rpo.size(); k-- > 0;) {
+            uint32_t b = rpo[k];
+            BitSet newOut = phiOut[b];
+            for (uint32_t s : cfg.successors(b)) newOut.unionWith(in[s]);
+            out[b] = newOut;
+
+            BitSet newIn = gen[b];
+            BitSet through = out[b];
+            through.subtract(kill[b]);
+            newIn.unionWith(through);
+            if (in[b].unionWith(newIn)) changed = true;
+        }
+    }
+}
+
+void LiveIntervals::compute(const IRModule& module, size_t fn, const CFG& cfg, const LocalSymbols& symbols,
+                            const LocalSymbols& globals, const Liveness& live) {
+    Span<const TACInstruction> code = module.code(fn);
+    const uint32_t NONE = LocalSymbols::NONE;
+    std::vector<uint32_t> start(symbols.size(), NONE), end(symbols.size(), 0);
+    auto cover = [&](uint32_t s, uint32_t pos) {
+        if (s == NONE) return;
+        if (start[s] == NONE || pos < start[s]) start[s] = pos;
+        if (pos > end[s]) end[s] = pos;
+    };
+
+    auto readAt = [](uint32_t i) { return 2 * i + 2; };
+    auto writeAt = [](uint32_t i) { return 2 * i + 3; };
+    for (const auto& p : module.params(fn)) cover(symbols.id(Operand::var(p.name)), 0);
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op == Opcode::Phi) {
+            // Read at the end of the predecessor the phi names.
+            uint32_t pred = cfg.blockOfLabel(instr.arg2.index());
+            if (pred != CFG::NONE) cover(symbols.id(instr.arg1), writeAt(cfg.block(pred).end - 1));
+        } else {
+            uint8_t mask = useMask(instr);
+            if (mask & USE_RESULT) cover(symbols.id(instr.result), readAt(i));
+            if (mask & USE_ARG1) cover(symbols.id(instr.arg1), readAt(i));
+            if (mask & USE_ARG2) cover(symbols.id(instr.arg2), readAt(i));
+        }
+        if (definesResult(instr)) cover(symbols.id(instr.result), writeAt(i));
+    }
+
+    // Names live across block boundaries extend to the edges of the blocks
+    // they are live through.
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        if (bb.begin == bb.end) continue;
+        live.liveIn(b).forEach([&](size_t g) { cover(symbols.id(globals.operand(g)), readAt(bb.begin)); });
+        live.liveOut(b).forEach([&](size_t g) { cover(symbols.id(globals.operand(g)), writeAt(bb.end - 1)); });
+    }
+
+    sorted.clear();
+    for (uint32_t s = 0; s < symbols.size(); ++s) {
+        if (start[s] != NONE) sorted.push_back(LiveInterval{s, start[s], end[s]});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start < b.start || (a.start == b.start && a.symbol < b.symbol);
+    });
+}
@@ -0,0 +1,99 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "cfg.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class BitSet {
+public:
+    void resize(size_t bits) { words.assign((bits + 63) / 64, 0); }
+    void set(size_t i) { words[i >> 6] |= uint64_t(1) << (i & 63); }
+    void reset(size_t i) { words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+    void subtract(const BitSet& o) {
+        for (size_t w = 0; w < words.size(); ++w) words[w] &= ~o.words[w];
+    }
+    bool unionWith(const BitSet& o) {
+        bool changed = false;
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t merged = words[w] | o.words[w];
+            changed |= merged != words[w];
+            words[w] = merged;
+        }
+        return changed;
+    }
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t bits = words[w];
+            while (bits) {
+                f(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+// Dense numbering of the vars and temps used by one function, so that
+// dataflow sets can be bit vectors. Given a CFG, only the "global" names
+// that are read in some block before being written there are numbered;
+// nothing else can be live across a block boundary.
+class LocalSymbols {
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    void build(const IRModule& module, size_t fn, const CFG* globalsOnly = nullptr);
+    uint32_t id(Operand o) const;
+    Operand operand(uint32_t id) const { return operands[id]; }
+    size_t size() const { return operands.size(); }
+
+private:
+    std::unordered_map<uint32_t, uint32_t> varIds;
+    std::vector<uint32_t> tempIds;
+    std::vector<Operand> operands;
+
+    void add(Operand o);
+};
+
+// Block-level live-in/live-out sets. A phi operand is live out of the
+// predecessor it names rather than live into the phi's block.
+class Liveness {
+public:
+    void compute(const IRModule& module, size_t fn, const CFG& cfg, const LocalSymbols& symbols);
+    const BitSet& liveIn(uint32_t block) const { return in[block]; }
+    const BitSet& liveOut(uint32_t block) const { return out[block]; }
+
+private:
+    std::vector<BitSet> in, out;
+};
+
+// Live interval of one name over a function body, [start, end] inclusive.
+// Instruction i reads its operands at position 2i+2 and writes its result
+// at 2i+3; params are written at 0. Holes are not tracked: a name live
+// around a loop covers the whole loop.
+struct LiveInterval {
+    uint32_t symbol;    // id in the LocalSymbols the intervals were built from
+    uint32_t start;
+    uint32_t end;
+};
+
+class LiveIntervals {
+public:
+    // `symbols` must number every name (built without globalsOnly); `live`
+    // is block liveness over `globals` (built with the CFG).
+    void compute(const IRModule& module, size_t fn, const CFG& cfg, const LocalSymbols& symbols,
+                 const LocalSymbols& globals, const Liveness& live);
+    // Sorted by start position.
+    const std::vector<LiveInterval>& intervals() const { return sorted; }
+
+private:
+    std::vector<LiveInterval> sorted;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "loop_opt.h"
+#include <unordered_map>
+
+namespace {
+
+// Assignments to each name inside the loop. A store writes its array.
+std::unordered_map<uint32_t, uint32_t> countDefs(const std::vector<TACInstruction>& code, const CFG& cfg,
+                                                 const Loop& loop) {
+    std::unordered_map<uint32_t, uint32_t> defs;
+    for (uint32_t b : loop.blocks) {
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            const TACInstruction& instr = code[i];
+            if ((definesResult(instr) || instr.op == Opcode::Store) && isSymbol(instr.result))
+                ++defs[instr.result.bits];
+        }
+    }
+    return defs;
+}
+
+bool intConstant(const IRSymbols& pool, Operand o, int64_t& value) {
+    if (!o.isConst() || pool.constant(o.index()).type != T_INT) return false;
+    value = pool.constant(o.index()).i;
+    return true;
+}
+
+// Rebuilds the function with `preheader` in a new block in front of the
+// loop header, dropping the instructions marked in `drop` and adding
+// after[i] behind instruction i. Jumps to the header from outside the loop
+// are sent to the preheader; the block laid out just before the header
+// keeps falling into the header if it belongs to the loop.
+void rebuild(IRModule& module, size_t fn, const std::vector<TACInstruction>& code, const CFG& cfg,
+             const LoopInfo& loops, uint32_t l, const std::vector<TACInstruction>& preheader,
+             const std::vector<char>& drop, const std::vector<std::vector<TACInstruction>>& after) {
+    uint32_t headerBegin = cfg.block(loops.loop(l).header).begin;
+    Operand header = code[headerBegin].result;
+    Operand entry = module.newLabel(fn);
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size() + preheader.size() + 2);
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        if (i == headerBegin) {
+            if (i > 0 && loops.contains(l, cfg.blockOfInstruction(i - 1)) &&
+                code[i - 1].op != Opcode::Goto && code[i - 1].op != Opcode::Return)
+                out.push_back(TACInstruction(Opcode::Goto, header));
+            out.push_back(TACInstruction(Opcode::Label, entry));
+            out.insert(out.end(), preheader.begin(), preheader.end());
+        }
+        if (drop[i]) continue;
+        TACInstruction instr = code[i];
+        if ((instr.op == Opcode::Goto || isConditionalBranch(instr.op)) && instr.result == header &&
+            !loops.contains(l, cfg.blockOfInstruction(i)))
+            instr.result = entry;
+        out.push_back(instr);
+        out.insert(out.end(), after[i].begin(), after[i].end());
+    }
+    module.replaceCode(fn, out);
+}
+
+}
+
+bool LoopOptimizer::run(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    if (module.function(fn).ssa) return false;
+
+    // Every change adds a block, so start over on the fresh loop nest.
+    bool changedAny = false;
+    for (;;) {
+        bool changed = false;
+        size_t count = analyses.loops(fn).size();
+        for (uint32_t l = 0; l < count && !changed; ++l) {
+            changed = hoistInvariants(module, fn, l, analyses) || reduceStrength(module, fn, l, analyses);
+        }
+        if (!changed) break;
+        changedAny = true;
+    }
+    return changedAny;
+}
+
+bool LoopOptimizer::hoistInvariants(IRModule& module, size_t fn, uint32_t l, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg(fn);
+    const LoopInfo& loops = analyses.loops(fn);
+    const LocalSymbols& globals = analyses.globalSymbols(fn);
+    const Liveness& live = analyses.liveness(fn);
+    const IRSymbols& pool = module.symbols();
+    const Loop& loop = loops.loop(l);
+    std::vector<TACInstruction> code(module.code(fn).begin(), module.code(fn).end());
+    if (code[cfg.block(loop.header).begin].op != Opcode::Label) return false;
+
+    std::unordered_map<uint32_t, uint32_t> defs = countDefs(code, cfg, loop);
+    std::vector<std::pair<uint32_t, uint32_t>> exits;     // exiting block, block outside
+    for (uint32_t b : loop.blocks) {
+        for (uint32_t s : cfg.successors(b)) {
+            if (!loops.contains(l, s)) exits.push_back({b, s});
+        }
+    }
+    auto invariant = [&](Operand o) { return !isSymbol(o) || defs.find(o.bits) == defs.end(); };
+    auto runsEveryIteration = [&](uint32_t b) {
+        for (auto& e : exits) {
+            if (!cfg.dominates(b, e.first)) return false;
+        }
+        return true;
+    };
+
+    std::vector<TACInstruction> preheader;
+    std::vector<char> drop(code.size(), 0);
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (uint32_t b : loop.blocks) {
+            const BasicBlock& bb = cfg.block(b);
+            for (uint32_t i = bb.begin; i < bb.end; ++i) {
+                const TACInstruction& instr = code[i];
+                if (drop[i]) continue;
+                if (instr.op != Opcode::Copy && !isBinaryOpcode(instr.op) && !isUnaryOpcode(instr.op)) continue;
+                if (!invariant(instr.arg1) || !invariant(instr.arg2)) continue;
+                if (!isSymbol(instr.result) || defs[instr.result.bits] != 1) continue;
+
+                if (mayTrap(instr, pool) && !runsEveryIteration(b)) continue;
+
+                uint32_t id = globals.id(instr.result);
+                if (id != LocalSymbols::NONE) {
+                    if (live.liveIn(loop.header).test(id)) continue;
+                    bool exposed = false;
+                    for (auto& e : exits) exposed |= live.liveIn(e.second).test(id) && !cfg.dominates(b, e.first);
+                    if (exposed) continue;
+                }
+
+                preheader.push_back(instr);
+                drop[i] = 1;
+                defs.erase(instr.result.bits);
+                progress = true;
+            }
+        }
+    }
+    if (preheader.empty()) return false;
+
+    hoistCount += preheader.size();
+    rebuild(module, fn, code, cfg, loops, l, preheader, drop, std::vector<std::vector<TACInstruction>>(code.size()));
+    return true;
+}
+
+bool LoopOptimizer::reduceStrength(IRModule& module, size_t fn, uint32_t l, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg(fn);
+    const LoopInfo& loops = analyses.loops(fn);
+    IRSymbols& pool = module.symbols();
+    const Loop& loop = loops.loop(l);
+    std::vector<TACInstruction> code(module.code(fn).begin(), module.code(fn).end());
+    if (code[cfg.block(loop.header).begin].op != Opcode::Label) return false;
+
+    std::unordered_map<uint32_t, uint32_t> defs = countDefs(code, cfg, loop);
+    auto invariant = [&](Operand o) { return !isSymbol(o) || defs.find(o.bits) == defs.end(); };
+
+    // Basic induction variables: the step and where the update is. Out of
+    // SSA the update reads `i.3 = i.2 + c` and then `i.2 = i.3` in the same
+    // block; i.2 is the induction variable, updated at the copy.
+    struct Induction {
+        uint32_t update;
+        int64_t step;
+    };
+    std::unordered_map<uint32_t, Induction> inductions;
+    for (uint32_t b : loop.blocks) {
+        const BasicBlock& bb = cfg.block(b);
+        std::unordered_map<uint32_t, std::pair<Operand, int64_t>> stepped;     // y = x + c in this block
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            const TACInstruction& instr = code[i];
+            if (instr.valueType() != T_INT || !isSymbol(instr.result) || defs[instr.result.bits] != 1) continue;
+            int64_t c;
+            if (instr.op == Opcode::Copy) {
+                auto it = stepped.find(instr.arg1.bits);
+                if (it != stepped.end() && it->second.first == instr.result)
+                    inductions[instr.result.bits] = Induction{i, it->second.second};
+                continue;
+            }
+            Operand base;
+            if ((instr.op == Opcode::Add || instr.op == Opcode::Sub) && intConstant(pool, instr.arg2, c)) {
+                base = instr.arg1;
+                if (instr.op == Opcode::Sub) c = static_cast<int64_t>(0 - static_cast<uint64_t>(c));
+            } else if (instr.op == Opcode::Add && intConstant(pool, instr.arg1, c)) {
+                base = instr.arg2;
+            } else {
+                continue;
+            }
+            if (base == instr.result) inductions[instr.result.bits] = Induction{i, c};
+            else stepped[instr.result.bits] = {base, c};
+        }
+    }
+    if (inductions.empty()) return false;
+
+    std::vector<TACInstruction> preheader;
+    std::vector<char> drop(code.size(), 0);
+    std::vector<std::vector<TACInstruction>> after(code.size());
+    std::unordered_map<uint64_t, Operand> reduced;      // (iv, factor) -> running product
+    for (uint32_t b : loop.blocks) {
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction& instr = code[i];
+            if (instr.op != Opcode::Mul || instr.valueType() != T_INT) continue;
+            Operand iv = instr.arg1, factor = instr.arg2;
+            if (!inductions.count(iv.bits) || !invariant(factor)) std::swap(iv, factor);
+            if (!inductions.count(iv.bits) || !invariant(factor)) continue;
+            int64_t k = 0;
+            bool constantFactor = intConstant(pool, factor, k);
+            if (!constantFactor && !isSymbol(factor)) continue;
+
+            uint64_t key = (static_cast<uint64_t>(iv.bits) << 32) | factor.bits;
+            auto it = reduced.find(key);
+            if (it == reduced.end()) {
+                const Induction& ind = inductions[iv.bits];
+                Operand product = module.newTemp(fn);
+                preheader.push_back(TACInstruction(Opcode::Mul, product, iv, factor, T_INT));
+                Operand step;
+                if (constantFactor) {
+                    uint64_t scaled = static_cast<uint64_t>(ind.step) * static_cast<uint64_t>(k);
+                    step = Operand::constant(pool.internConstant(Value::makeInt(static_cast<int64_t>(scaled))));
+                } else {
+                    step = module.newTemp(fn);
+                    Operand c = Operand::constant(pool.internConstant(Value::makeInt(ind.step)));
+                    preheader.push_back(TACInstruction(Opcode::Mul, step, factor, c, T_INT));
+                }
+                after[ind.update].push_back(TACInstruction(Opcode::Add, product, product, step, T_INT));
+                it = reduced.emplace(key, product).first;
+            }
+            instr = TACInstruction(Opcode::Copy, instr.result, it->second, Operand(), T_INT);
+            ++reduceCount;
+        }
+    }
+    if (reduced.empty()) return false;
+
+    rebuild(module, fn, code, cfg, loops, l, preheader, drop, after);
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef LOOP_OPT_H
+#define LOOP_OPT_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+#include <vector>
+
+// Loop-invariant code motion and strength reduction over the natural loops
+// of a function not in SSA form, innermost loops first. Both place code in
+// a preheader: a new block in front of the header that every entry into
+// the loop, but no back edge, passes through.
+//
+// An instruction is hoisted when its operands are not assigned in the loop,
+// it is the loop's only assignment to its result, the result is not live
+// into the header, and every exit at which the result is live is dominated
+// by it. Division is only hoisted from blocks that run on every iteration.
+//
+// A multiply `j = i * k` of a basic induction variable (`i = i + c` is its
+// only assignment in the loop, c constant, or `i2 = i + c; i = i2` in one
+// block as SSA destruction leaves it) by an invariant k becomes a copy
+// of a new temp s that starts at i * k in the preheader and is advanced by
+// c * k right after i is.
+class LoopOptimizer {
+public:
+    bool run(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool run(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        return run(module, fn, analyses);
+    }
+
+    size_t hoisted() const { return hoistCount; }
+    size_t strengthReduced() const { return reduceCount; }
+
+private:
+    size_t hoistCount = 0;
+    size_t reduceCount = 0;
+
+    bool hoistInvariants(IRModule& module, size_t fn, uint32_t loop, AnalysisManager& analyses);
+    bool reduceStrength(IRModule& module, size_t fn, uint32_t loop, AnalysisManager& analyses);
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "loops.h"
+#include <algorithm>
+
+void LoopInfo::compute(const CFG& cfg) {
+    nest.clear();
+    member.clear();
+    size_t n = cfg.size();
+
+    std::vector<uint32_t> loopOfHeader(n, CFG::NONE);
+    std::vector<uint32_t> work;
+    for (uint32_t b = 0; b < n; ++b) {
+        if (!cfg.isReachable(b)) continue;
+        for (uint32_t header : cfg.successors(b)) {
+            if (!cfg.dominates(header, b)) continue;
+            if (loopOfHeader[header] == CFG::NONE) {
+                loopOfHeader[header] = static_cast<uint32_t>(nest.size());
+                nest.push_back(Loop{header, CFG::NONE, 0, {}, {}});
+                member.emplace_back(n, 0);
+                member.back()[header] = 1;
+            }
+            uint32_t l = loopOfHeader[header];
+            nest[l].latches.push_back(b);
+            std::vector<char>& in = member[l];
+            work.assign(1, b);
+            while (!work.empty()) {
+                uint32_t x = work.back();
+                work.pop_back();
+                if (in[x]) continue;
+                in[x] = 1;
+                for (uint32_t p : cfg.predecessors(x)) {
+                    if (cfg.isReachable(p)) work.push_back(p);
+                }
+            }
+        }
+    }
+
+    for (size_t l = 0; l < nest.size(); ++l) {
+        nest[l].blocks.push_back(nest[l].header);
+        for (uint32_t b = 0; b < n; ++b) {
+            if (member[l][b] && b != nest[l].header) nest[l].blocks.push_back(b);
+        }
+    }
+
+    // Two natural loops with different headers are either disjoint or
+    // nested, so an inner loop is always strictly smaller.
+    std::vector<uint32_t> order(nest.size());
+    for (uint32_t l = 0; l < order.size(); ++l) order[l] = l;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return nest[a].blocks.size() < nest[b].blocks.size();
+    });
+    std::vector<Loop> sortedNest;
+    std::vector<std::vector<char>> sortedMember;
+    for (uint32_t l : order) {
+        sortedNest.push_back(std::move(nest[l]));
+        sortedMember.push_back(std::move(member[l]));
+    }
+    nest.swap(sortedNest);
+    member.swap(sortedMember);
+
+    innermost.assign(n, CFG::NONE);
+    for (uint32_t l = 0; l < nest.size(); ++l) {
+        for (uint32_t b : nest[l].blocks) {
+            if (innermost[b] == CFG::NONE) innermost[b] = l;
+        }
+        for (uint32_t outer = l + 1; outer < nest.size(); ++outer) {
+            if (member[outer][nest[l].header] && nest[outer].header != nest[l].header) {
+                nest[l].parent = outer;
+                break;
+            }
+        }
+    }
+    for (uint32_t l = static_cast<uint32_t>(nest.size()); l-- > 0;) {
+        uint32_t parent = nest[l].parent;
+        nest[l].depth = parent == CFG::NONE ? 1 : nest[parent].depth + 1;
+    }
+}
+
+uint32_t LoopInfo::depth(uint32_t block) const {
+    uint32_t l = innermost[block];
+    return l == CFG::NONE ? 0 : nest[l].depth;
+}
@@ -0,0 +1,39 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "cfg.h"
+#include <cstdint>
+#include <vector>
+
+// A natural loop: the header plus every block that reaches one of its
+// back edges (latch -> header, where the header dominates the latch)
+// without passing through the header. Back edges sharing a header form
+// one loop.
+struct Loop {
+    uint32_t header;
+    uint32_t parent;                    // enclosing loop, or CFG::NONE
+    uint32_t depth;                     // 1 for an outermost loop
+    std::vector<uint32_t> blocks;       // header first, then by block number
+    std::vector<uint32_t> latches;
+};
+
+// The loop nest of one function. Loops are ordered innermost first, so a
+// loop always comes before the loops that enclose it.
+class LoopInfo {
+public:
+    void compute(const CFG& cfg);
+
+    size_t size() const { return nest.size(); }
+    const Loop& loop(uint32_t l) const { return nest[l]; }
+    bool contains(uint32_t l, uint32_t block) const { return member[l][block] != 0; }
+    // Innermost loop containing the block, or CFG::NONE.
+    uint32_t loopOf(uint32_t block) const { return innermost[block]; }
+    uint32_t depth(uint32_t block) const;
+
+private:
+    std::vector<Loop> nest;
+    std::vector<std::vector<char>> member;
+    std::vector<uint32_t> innermost;
+};
+
+#endif
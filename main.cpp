@@ -1,49 +1,481 @@
-#include "scope_analyzer.h"
-#include "ir_generator.h"
-#include "parser.h"
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <string>
-
-int main() {
-    std::ifstream file("program.txt"); 
-    if (!file) {
-        std::cerr << "Failed to open program.txt\n";
-        return 1;
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string program = buffer.str();
-
-    Scanner scan(program);
-    Parser parser(scan);
-
-    try {
-        std::cout << "=== PARSING ===" << std::endl;
-        auto ast = parser.parseProgram();
-        std::cout << "\nParsing completed successfully.\n";
-        
-        std::cout << "\n=== AST STRUCTURE ===" << std::endl;
-        ast->print();
-
-        std::cout << "\n=== SCOPE ANALYSIS ===" << std::endl;
-        ScopeAnalyzer sa;
-        sa.analyze(ast);
-        std::cout << "No scope errors detected.\n";
-        
-        std::cout << "\n=== IR GENERATION ===" << std::endl;
-        IRGenerator irGen;
-        irGen.generate(ast);
-        irGen.printIR();
-        
-        std::cout << "\nCompilation completed successfully!\n";
-    }
-    catch (const std::exception& e) {
-        std::cerr << "\n[ERROR] " << e.what() << std::endl;
-        return 1;
-    }
-    
-    return 0;
-}
\ No newline at end of file
+#include "scope_analyzer.h"
+#include "type_checker.h"
+#include "ir_generator.h"
+#include "effect_analysis.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "pass_manager.h"
+#include "register_allocator.h"
+#include "tac_reader.h"
+#include "ir_file.h"
+#include "linker.h"
+#include "memo_cache.h"
+#include "bytecode_vm.h"
+#include "jit.h"
+#include "asm_backend.h"
+#include "c_backend.h"
+#include "tiered.h"
+#include "batch.h"
+#include "profiler.h"
+#include "differential.h"
+#include "parser.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [source] [--emit-interface <file>] [--import <file>]... [--cfg] [--ssa]\n"
+              << "       [-O0|-O1|-O2] [--passes=<pass,...>] [--fold] [--gvn] [--peephole] [--dce]\n"
+              << "       [--regalloc <registers>] [--emit-tac <file>] [--emit-ir <file>]\n"
+              << "       [--link <ir-file>]... [--entry <function>]... [--run <function> [args...]] [--jit]\n"
+              << "       [--diff-test] [--emit-asm <file>] [--emit-c <file>] [--c-test]\n"
+              << "       [--tiered] [--tier-threshold <count>] [--repeat <count>] [--batch <rows>]\n"
+              << "       [--profile <file>] [--memo]\n"
+              << "A source ending in .tac is read as textual IR; binary IR files are detected.\n"
+              << "Passes:";
+    for (auto& name : passNames()) std::cerr << " " << name;
+    std::cerr << "\n";
+}
+
+// Loads a binary IR file, or textual TAC from anything else.
+static IRModule readModuleFile(const std::string& path) {
+    if (isIRFile(path)) return readIRFile(path);
+    std::ifstream file(path);
+    if (!file) throw IRException("Failed to open " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return TACReader().read(buffer.str());
+}
+
+// --batch: runs a function over generated columns, where row r adds r to
+// each int and float argument and bools alternate, then checks a sample of
+// rows against the scalar VM.
+static void runBatch(BytecodeVM& vm, const std::string& name, const std::vector<Value>& args, size_t rows) {
+    size_t fn;
+    if (!vm.findFunction(name, fn)) throw VMException("No function named " + name);
+    const BytecodeFunction& f = vm.function(fn);
+    if (args.size() != f.paramTypes.size()) {
+        throw VMException(f.name + " takes " + std::to_string(f.paramTypes.size()) + " arguments, got " +
+                          std::to_string(args.size()));
+    }
+    auto rowValue = [&](size_t p, size_t r) {
+        VMSlot base = toSlot(args[p], f.paramTypes[p]);
+        if (f.paramTypes[p] == T_FLOAT) return Value::makeFloat(base.f + static_cast<double>(r));
+        if (f.paramTypes[p] == T_BOOL) return Value::makeBool(((base.i + static_cast<int64_t>(r)) & 1) != 0);
+        return Value::makeInt(base.i + static_cast<int64_t>(r));
+    };
+
+    std::vector<std::vector<int64_t>> ints(args.size() + 1);
+    std::vector<std::vector<double>> floats(args.size() + 1);
+    std::vector<std::unique_ptr<bool[]>> bools(args.size() + 1);
+    auto makeColumn = [&](size_t p, BasicType type) {
+        if (type == T_FLOAT) {
+            floats[p].resize(rows);
+            return BatchColumn{T_FLOAT, floats[p].data()};
+        }
+        if (type == T_BOOL) {
+            bools[p].reset(new bool[rows]);
+            return BatchColumn{T_BOOL, bools[p].get()};
+        }
+        ints[p].resize(rows);
+        return BatchColumn{T_INT, ints[p].data()};
+    };
+    std::vector<BatchColumn> inputs;
+    for (size_t p = 0; p < args.size(); ++p) {
+        inputs.push_back(makeColumn(p, f.paramTypes[p]));
+        for (size_t r = 0; r < rows; ++r) {
+            Value v = rowValue(p, r);
+            if (v.type == T_FLOAT) floats[p][r] = v.f;
+            else if (v.type == T_BOOL) bools[p][r] = v.i != 0;
+            else ints[p][r] = v.i;
+        }
+    }
+    BatchColumn output = makeColumn(args.size(), f.returnType);
+    std::vector<uint8_t> errors(rows);
+
+    BatchExecutor batch(vm);
+    auto start = std::chrono::steady_clock::now();
+    size_t failures = batch.run(fn, inputs, output, rows, errors.data());
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Batch " << name << " over " << rows << " rows: " << elapsed.count() << " ns ("
+              << static_cast<uint64_t>(rows * 1e9 / std::max<int64_t>(1, elapsed.count())) << " rows/s), "
+              << failures << " failed";
+    if (failures) std::cout << " (first: " << batch.firstError() << ")";
+    std::cout << "\n";
+
+    size_t step = std::max<size_t>(1, rows / 1000), checked = 0, mismatches = 0;
+    std::chrono::nanoseconds scalar(0);
+    for (size_t r = 0; r < rows; r += step, ++checked) {
+        std::vector<Value> rowArgs;
+        for (size_t p = 0; p < args.size(); ++p) rowArgs.push_back(rowValue(p, r));
+        Value expected;
+        bool raised = false;
+        auto begin = std::chrono::steady_clock::now();
+        try {
+            expected = vm.call(fn, rowArgs);
+        } catch (const VMException&) {
+            raised = true;
+        }
+        scalar += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+        bool same = raised == (errors[r] != 0);
+        if (same && !raised && f.returnType != T_VOID) {
+            VMSlot got;
+            if (output.type == T_FLOAT) got.f = floats[args.size()][r];
+            else if (output.type == T_BOOL) got.i = bools[args.size()][r];
+            else got.i = ints[args.size()][r];
+            Value actual = fromSlot(got, f.returnType);
+            same = actual.type == T_FLOAT ? (actual.f == expected.f || (actual.f != actual.f && expected.f != expected.f))
+                                          : actual == expected;
+        }
+        mismatches += !same;
+    }
+    std::cout << "Checked " << checked << " rows against the VM (" << scalar.count() / std::max<size_t>(1, checked)
+              << " ns per scalar call): " << mismatches << " mismatches\n";
+}
+
+int main(int argc, char** argv) {
+    std::string sourcePath = "program.txt";
+    std::string interfaceOut;
+    std::string tacOut;
+    std::string irOut;
+    std::string asmOut;
+    std::string cOut;
+    std::vector<std::string> imports;
+    std::vector<std::string> links;
+    std::vector<std::string> entries;
+    std::string runFunction;
+    std::vector<Value> runArgs;
+    bool useJIT = false;
+    bool useTiered = false;
+    uint64_t tierThreshold = TieredRuntime::DEFAULT_THRESHOLD;
+    long repeat = 1;
+    size_t batchRows = 0;
+    std::string profileOut;
+    bool useMemo = false;
+    bool diffTest = false;
+    bool cTest = false;
+    bool dumpCFG = false;
+    bool dumpSSA = false;
+    PassManager passes;
+    std::string unknownPass;
+    int allocRegisters = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--emit-interface" && i + 1 < argc) {
+            interfaceOut = argv[++i];
+        } else if (arg == "--emit-tac" && i + 1 < argc) {
+            tacOut = argv[++i];
+        } else if (arg == "--emit-ir" && i + 1 < argc) {
+            irOut = argv[++i];
+        } else if (arg == "--emit-asm" && i + 1 < argc) {
+            asmOut = argv[++i];
+        } else if (arg == "--emit-c" && i + 1 < argc) {
+            cOut = argv[++i];
+        } else if (arg == "--link" && i + 1 < argc) {
+            links.push_back(argv[++i]);
+        } else if (arg == "--entry" && i + 1 < argc) {
+            entries.push_back(argv[++i]);
+        } else if (arg == "--run" && i + 1 < argc) {
+            runFunction = argv[++i];
+            while (i + 1 < argc && literalType(argv[i + 1]) != T_STRING) {
+                std::string lit = argv[++i];
+                runArgs.push_back(literalValue(lit, literalType(lit)));
+            }
+        } else if (arg == "--jit") {
+            useJIT = true;
+        } else if (arg == "--tiered") {
+            useTiered = true;
+        } else if (arg == "--tier-threshold" && i + 1 < argc) {
+            tierThreshold = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchRows = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profileOut = argv[++i];
+        } else if (arg == "--memo") {
+            useMemo = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "--diff-test") {
+            diffTest = true;
+        } else if (arg == "--c-test") {
+            cTest = true;
+        } else if (arg == "--import" && i + 1 < argc) {
+            imports.push_back(argv[++i]);
+        } else if (arg == "--cfg") {
+            dumpCFG = true;
+        } else if (arg == "--ssa") {
+            dumpSSA = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            passes.addOptimizationLevel(arg[2] - '0');
+        } else if (arg.compare(0, 9, "--passes=") == 0) {
+            if (!passes.addPipeline(arg.substr(9), unknownPass)) {
+                std::cerr << "Unknown pass '" << unknownPass << "'\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--fold") {
+            passes.addPipeline("fold", unknownPass);
+        } else if (arg == "--gvn") {
+            passes.addPipeline("ssa,gvn,out-of-ssa", unknownPass);
+        } else if (arg == "--peephole") {
+            passes.addPipeline("peephole", unknownPass);
+        } else if (arg == "--dce") {
+            passes.addPipeline("dce", unknownPass);
+        } else if (arg == "--regalloc" && i + 1 < argc) {
+            allocRegisters = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-') {
+            sourcePath = arg;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!profileOut.empty() && (useJIT || useTiered)) {
+        std::cerr << "--profile counts interpreted runs and cannot be combined with --jit or --tiered\n";
+        return 1;
+    }
+    if (useMemo && (useJIT || useTiered || !profileOut.empty())) {
+        std::cerr << "--memo caches interpreted calls and cannot be combined with --jit, --tiered or --profile\n";
+        return 1;
+    }
+
+    bool irInput = isIRFile(sourcePath) ||
+                   (sourcePath.size() > 4 && sourcePath.compare(sourcePath.size() - 4, 4, ".tac") == 0);
+    std::string program;
+    if (!irInput) {
+        std::ifstream file(sourcePath);
+        if (!file) {
+            std::cerr << "Failed to open " << sourcePath << "\n";
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        program = buffer.str();
+    }
+
+    try {
+        IRModule module;
+        if (irInput) {
+            // IR input skips the frontend.
+            std::cout << "=== LOADED IR ===" << std::endl;
+            module = readModuleFile(sourcePath);
+            module.print(std::cout);
+        } else {
+            Scanner scan(program);
+            Parser parser(scan);
+
+            std::cout << "=== PARSING ===" << std::endl;
+            auto ast = parser.parseProgram();
+            std::cout << "\nParsing completed successfully.\n";
+
+            std::cout << "\n=== AST STRUCTURE ===" << std::endl;
+            ast->print();
+
+            TypeChecker tc;
+            ScopeAnalyzer sa;
+            for (auto& path : imports) {
+                for (auto& name : tc.importInterface(path))
+                    sa.declareExternalFunction(name);
+                std::cout << "Imported interface " << path << "\n";
+            }
+
+            std::cout << "\n=== SCOPE ANALYSIS ===" << std::endl;
+            sa.analyze(ast);
+            std::cout << "No scope errors detected.\n";
+
+            std::cout << "\n=== TYPE CHECKING ===" << std::endl;
+            tc.analyze(ast);
+            if (!interfaceOut.empty()) {
+                tc.exportInterface(interfaceOut);
+                std::cout << "Wrote interface file " << interfaceOut << "\n";
+            }
+
+            std::cout << "\n=== IR GENERATION ===" << std::endl;
+            IRGenerator irGen;
+            irGen.generate(ast);
+            irGen.printIR();
+            module = irGen.takeModule();
+        }
+
+        if (!links.empty() || !entries.empty()) {
+            std::cout << "=== LINKING ===" << std::endl;
+            Linker linker;
+            linker.add(std::move(module), sourcePath);
+            for (auto& path : links) linker.add(readModuleFile(path), path);
+            module = linker.link(entries);
+            std::cout << "Linked " << linker.modulesLinked() << " modules: kept " << linker.functionsKept()
+                      << " of " << linker.functionsIn() << " functions (" << linker.instructionsKept()
+                      << " instructions)\n";
+            module.print(std::cout);
+            std::cout << std::endl;
+        }
+
+        if (!passes.empty()) {
+            std::cout << "=== OPTIMIZED IR ===" << std::endl;
+            passes.run(module);
+            module.print(std::cout);
+            std::cout << "\n=== PASS STATISTICS ===" << std::endl;
+            passes.printStatistics(std::cout);
+            std::cout << std::endl;
+        }
+
+        if (!tacOut.empty()) {
+            std::ofstream out(tacOut);
+            if (!out) throw IRException("Cannot write TAC file: " + tacOut);
+            module.print(out);
+            std::cout << "Wrote TAC file " << tacOut << "\n";
+        }
+        if (!irOut.empty()) {
+            writeIRFile(module, irOut);
+            std::cout << "Wrote IR file " << irOut << "\n";
+        }
+        if (!asmOut.empty()) {
+            BytecodeVM vm;
+            vm.load(module);
+            if (vm.functionCount() == 0) throw AsmException("No functions to compile");
+            size_t entry = 0;
+            if (!vm.findFunction(entries.empty() ? "main" : entries.front(), entry) && !entries.empty())
+                throw AsmException("Unknown entry function: " + entries.front());
+            std::ofstream out(asmOut);
+            if (!out) throw IRException("Cannot write assembly file: " + asmOut);
+            AsmBackend(vm).emit(out, entry);
+            std::cout << "Wrote assembly file " << asmOut << " (entry " << vm.function(entry).name << ")\n";
+        }
+
+        if (!cOut.empty()) {
+            CBackend(module).writeFiles(cOut);
+            std::cout << "Wrote C file " << cOut << " and its tac_runtime.h\n";
+        }
+
+        if (!runFunction.empty() || diffTest || cTest) {
+            std::cout << "=== EXECUTION ===" << std::endl;
+            BytecodeVM vm;
+            vm.load(module);
+            JIT jit(vm);
+            std::unique_ptr<TieredRuntime> tiered;
+            if (useTiered) tiered.reset(new TieredRuntime(module, tierThreshold));
+            if (!runFunction.empty()) {
+                if (!useJIT && !useTiered) vm.print(std::cout);
+                if (!profileOut.empty()) vm.setProfiling(true);
+                MemoCache memo;
+                if (useMemo) {
+                    EffectAnalyzer effects;
+                    effects.analyze(module);
+                    std::vector<bool> pure;
+                    for (size_t fn = 0; fn < module.functionCount(); ++fn) pure.push_back(effects.isPure(fn));
+                    vm.setMemoCache(&memo, pure);
+                }
+                Value result;
+                std::chrono::nanoseconds first(0), elapsed(0);
+                for (long n = 0; n < repeat; ++n) {
+                    auto start = std::chrono::steady_clock::now();
+                    result = tiered ? tiered->call(runFunction, runArgs)
+                                    : useJIT ? jit.call(runFunction, runArgs) : vm.call(runFunction, runArgs);
+                    elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                    if (n == 0) first = elapsed;
+                }
+                std::cout << runFunction << "(";
+                for (size_t i = 0; i < runArgs.size(); ++i) std::cout << (i ? ", " : "") << runArgs[i].toString();
+                std::cout << ") = " << result.toString() << "  [";
+                if (repeat > 1) std::cout << "first " << first.count() << " ns, last of " << repeat << " ";
+                std::cout << elapsed.count() << " ns";
+                if (useJIT) std::cout << ", " << jit.codeBytes() << " bytes of machine code";
+                std::cout << "]\n";
+                if (useMemo) {
+                    vm.setMemoCache(nullptr, {});
+                    std::cout << "Memo cache: " << memo.hits() << " hits, " << memo.misses() << " misses, "
+                              << memo.evictions() << " evictions, " << memo.size() << " entries\n";
+                }
+                if (tiered) {
+                    tiered->waitForCompiler();
+                    tiered->printStatistics(std::cout);
+                }
+                if (!profileOut.empty()) {
+                    vm.setProfiling(false);
+                    ExecutionProfile profile(module, vm);
+                    std::cout << "\n=== PROFILE ===" << std::endl;
+                    profile.printReport(std::cout);
+                    profile.writeFile(profileOut);
+                    std::cout << "Wrote profile file " << profileOut << "\n";
+                }
+            }
+            if (batchRows > 0 && !runFunction.empty()) runBatch(vm, runFunction, runArgs, batchRows);
+            if (diffTest) {
+                DifferentialTester tester(vm);
+                size_t bad = tester.run(tiered ? "tiered" : "jit", [&](size_t fn, const std::vector<Value>& args) {
+                    return tiered ? tiered->call(fn, args) : jit.call(fn, args);
+                }, std::cout);
+                std::cout << "Differential test: " << tester.casesRun() << " cases, " << bad << " mismatches\n";
+            }
+            if (cTest) {
+                CNativeModule native(module);
+                DifferentialTester tester(vm);
+                size_t bad = tester.run("c", [&](size_t fn, const std::vector<Value>& args) {
+                    return native.call(fn, args);
+                }, std::cout);
+                std::cout << "C backend test: " << tester.casesRun() << " cases, " << bad << " mismatches\n";
+            }
+            std::cout << std::endl;
+        }
+
+        if (allocRegisters >= 0) {
+            std::cout << "=== REGISTER ALLOCATION ===" << std::endl;
+            LinearScanAllocator allocator(static_cast<uint32_t>(allocRegisters));
+            for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+                allocator.allocate(module, fn);
+                std::cout << module.functionName(fn) << ":" << std::endl;
+                allocator.print(std::cout, module);
+            }
+            std::cout << std::endl;
+        }
+
+        if (dumpCFG) {
+            std::cout << "=== CONTROL FLOW GRAPHS ===" << std::endl;
+            for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+                CFG cfg;
+                cfg.build(module.code(fn), module.function(fn).labelCount);
+                std::cout << module.functionName(fn) << ":" << std::endl;
+                cfg.print(std::cout);
+            }
+            std::cout << std::endl;
+        }
+
+        if (dumpSSA) {
+            SSABuilder ssa;
+            std::cout << "=== SSA FORM ===" << std::endl;
+            for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+                ssa.construct(module, fn);
+                module.printFunction(std::cout, fn);
+            }
+            std::cout << "\n=== OUT OF SSA ===" << std::endl;
+            for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+                ssa.destruct(module, fn);
+                module.printFunction(std::cout, fn);
+            }
+            std::cout << "(" << ssa.phisInserted() << " phis, " << ssa.copiesInserted()
+                      << " copies)\n" << std::endl;
+        }
+
+        std::cout << "=== EFFECT ANALYSIS ===" << std::endl;
+        EffectAnalyzer effects;
+        effects.analyze(module);
+        effects.printSummary();
+        
+        std::cout << "\nCompilation completed successfully!\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "\n[ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
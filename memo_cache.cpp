@@ -0,0 +1,48 @@
+#include "memo_cache.h"
+
+size_t MemoCache::KeyHash::operator()(const Key& k) const {
+    size_t h = std::hash<std::string>()(k.function);
+    for (const auto& v : k.args) h ^= v.hash() + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+bool MemoCache::lookup(const std::string& function, const std::vector<Value>& args, Value& result) {
+    auto it = index.find(Key{function, args});
+    if (it == index.end()) {
+        ++missCount;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->result;
+    ++hitCount;
+    return true;
+}
+
+void MemoCache::insert(const std::string& function, const std::vector<Value>& args, const Value& result) {
+    if (capacity == 0) return;
+    Key key{function, args};
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->result = result;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+        ++evictionCount;
+    }
+    entries.push_front(Entry{std::move(key), result});
+    index[entries.front().key] = entries.begin();
+}
+
+void MemoCache::clear() {
+    entries.clear();
+    index.clear();
+    hitCount = missCount = evictionCount = 0;
+}
+
+double MemoCache::hitRate() const {
+    uint64_t total = hitCount + missCount;
+    return total == 0 ? 0.0 : static_cast<double>(hitCount) / total;
+}
@@ -0,0 +1,50 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include "value.h"
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bounded LRU cache of pure call results keyed by function and argument
+// values. Executors opt in by constructing one and consulting it only for
+// functions that EffectAnalyzer reported as pure.
+class MemoCache {
+public:
+    explicit MemoCache(size_t capacity = 4096) : capacity(capacity) {}
+
+    bool lookup(const std::string& function, const std::vector<Value>& args, Value& result);
+    void insert(const std::string& function, const std::vector<Value>& args, const Value& result);
+    void clear();
+
+    size_t size() const { return entries.size(); }
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    uint64_t evictions() const { return evictionCount; }
+    double hitRate() const;
+
+private:
+    struct Key {
+        std::string function;
+        std::vector<Value> args;
+        bool operator==(const Key& o) const { return function == o.function && args == o.args; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const;
+    };
+    struct Entry {
+        Key key;
+        Value result;
+    };
+
+    size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t evictionCount = 0;
+};
+
+#endif
@@ -0,0 +1,235 @@
+#include "pass_manager.h"
+#include "const_fold.h"
+#include "dce.h"
+#include "function_merge.h"
+#include "inliner.h"
+#include "loop_opt.h"
+#include "peephole.h"
+#include "ssa.h"
+#include "value_numbering.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+bool Pass::runOnModule(IRModule& module, AnalysisManager& analyses) {
+    bool changed = false;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) changed |= runOnFunction(module, fn, analyses);
+    return changed;
+}
+
+namespace {
+
+class SSAConstructionPass : public Pass {
+public:
+    const char* name() const override { return "ssa"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        if (module.function(fn).ssa) return false;
+        builder.construct(module, fn, analyses);
+        return true;
+    }
+    std::string counters() const override { return std::to_string(builder.phisInserted()) + " phis"; }
+
+private:
+    SSABuilder builder;
+};
+
+class SSADestructionPass : public Pass {
+public:
+    const char* name() const override { return "out-of-ssa"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        if (!module.function(fn).ssa) return false;
+        builder.destruct(module, fn, analyses);
+        return true;
+    }
+    std::string counters() const override { return std::to_string(builder.copiesInserted()) + " copies"; }
+
+private:
+    SSABuilder builder;
+};
+
+class MergePass : public Pass {
+public:
+    const char* name() const override { return "dedup"; }
+    bool runOnModule(IRModule& module, AnalysisManager&) override { return merger.run(module); }
+    std::string counters() const override {
+        return std::to_string(merger.merged()) + " merged, " + std::to_string(merger.callsRedirected()) +
+               " calls redirected";
+    }
+
+private:
+    FunctionMerger merger;
+};
+
+class InlinePass : public Pass {
+public:
+    const char* name() const override { return "inline"; }
+    bool runOnModule(IRModule& module, AnalysisManager& analyses) override {
+        return inliner.run(module, analyses);
+    }
+    std::string counters() const override {
+        return std::to_string(inliner.inlined()) + " inlined, " + std::to_string(inliner.tooCostly()) +
+               " too costly, " + std::to_string(inliner.recursiveSkipped()) + " recursive";
+    }
+
+private:
+    Inliner inliner;
+};
+
+class FoldPass : public Pass {
+public:
+    const char* name() const override { return "fold"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        return folder.run(module, fn, analyses);
+    }
+    std::string counters() const override {
+        return std::to_string(folder.folded()) + " folded, " + std::to_string(folder.removed()) + " removed";
+    }
+
+private:
+    ConstantFolder folder;
+};
+
+class ValueNumberingPass : public Pass {
+public:
+    const char* name() const override { return "gvn"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        return numbering.run(module, fn, analyses);
+    }
+    std::string counters() const override { return std::to_string(numbering.redundant()) + " redundant"; }
+
+private:
+    ValueNumbering numbering;
+};
+
+class LoopPass : public Pass {
+public:
+    const char* name() const override { return "loop"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        return optimizer.run(module, fn, analyses);
+    }
+    std::string counters() const override {
+        return std::to_string(optimizer.hoisted()) + " hoisted, " + std::to_string(optimizer.strengthReduced()) +
+               " strength-reduced";
+    }
+
+private:
+    LoopOptimizer optimizer;
+};
+
+class PeepholePass : public Pass {
+public:
+    const char* name() const override { return "peephole"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        return optimizer.run(module, fn, analyses);
+    }
+    std::string counters() const override {
+        return std::to_string(optimizer.copiesPropagated()) + " copies propagated, " +
+               std::to_string(optimizer.rewrites()) + " rewrites, " +
+               std::to_string(optimizer.jumpsThreaded()) + " jumps threaded";
+    }
+
+private:
+    PeepholeOptimizer optimizer;
+};
+
+class DeadCodePass : public Pass {
+public:
+    const char* name() const override { return "dce"; }
+    bool runOnFunction(IRModule& module, size_t fn, AnalysisManager& analyses) override {
+        return eliminator.run(module, fn, analyses);
+    }
+    std::string counters() const override {
+        return std::to_string(eliminator.unreachableRemoved()) + " unreachable, " +
+               std::to_string(eliminator.labelsRemoved()) + " labels, " +
+               std::to_string(eliminator.deadAssignmentsRemoved()) + " dead assignments";
+    }
+
+private:
+    DeadCodeEliminator eliminator;
+};
+
+size_t blockCount(const IRModule& module, AnalysisManager& analyses) {
+    size_t blocks = 0;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) blocks += analyses.cfg(fn).size();
+    return blocks;
+}
+
+}
+
+std::unique_ptr<Pass> createPass(const std::string& name) {
+    if (name == "ssa") return std::unique_ptr<Pass>(new SSAConstructionPass());
+    if (name == "out-of-ssa") return std::unique_ptr<Pass>(new SSADestructionPass());
+    if (name == "dedup") return std::unique_ptr<Pass>(new MergePass());
+    if (name == "inline") return std::unique_ptr<Pass>(new InlinePass());
+    if (name == "fold") return std::unique_ptr<Pass>(new FoldPass());
+    if (name == "gvn") return std::unique_ptr<Pass>(new ValueNumberingPass());
+    if (name == "loop") return std::unique_ptr<Pass>(new LoopPass());
+    if (name == "peephole") return std::unique_ptr<Pass>(new PeepholePass());
+    if (name == "dce") return std::unique_ptr<Pass>(new DeadCodePass());
+    return nullptr;
+}
+
+const std::vector<std::string>& passNames() {
+    static const std::vector<std::string> names = {"dedup", "inline", "ssa", "out-of-ssa", "fold", "gvn", "loop", "peephole", "dce"};
+    return names;
+}
+
+void PassManager::addOptimizationLevel(int level) {
+    std::string error;
+    if (level == 1) addPipeline("fold,peephole,dce", error);
+    else if (level >= 2) addPipeline("dedup,inline,ssa,fold,gvn,peephole,dce,out-of-ssa,peephole,loop,peephole,dce", error);
+}
+
+bool PassManager::addPipeline(const std::string& list, std::string& error) {
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name.empty()) continue;
+        std::unique_ptr<Pass> pass = createPass(name);
+        if (!pass) {
+            error = name;
+            return false;
+        }
+        add(std::move(pass));
+    }
+    return true;
+}
+
+void PassManager::run(IRModule& module) {
+    AnalysisManager analyses(module);
+    stats.clear();
+    for (auto& pass : passes) {
+        Stats s;
+        s.instructionsBefore = module.instructionCount();
+        s.blocksBefore = blockCount(module, analyses);
+        auto start = std::chrono::steady_clock::now();
+        s.changed = pass->runOnModule(module, analyses);
+        auto stop = std::chrono::steady_clock::now();
+        s.milliseconds = std::chrono::duration<double, std::milli>(stop - start).count();
+        s.instructionsAfter = module.instructionCount();
+        s.blocksAfter = blockCount(module, analyses);
+        stats.push_back(s);
+    }
+    analysesComputed = analyses.computed();
+    analysesReused = analyses.reused();
+}
+
+void PassManager::printStatistics(std::ostream& out) const {
+    out << std::left << std::setw(12) << "pass" << std::right << std::setw(10) << "time ms"
+        << std::setw(16) << "instructions" << std::setw(14) << "blocks" << "\n";
+    double total = 0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const Stats& s = stats[i];
+        std::ostringstream instrs, blocks;
+        instrs << s.instructionsBefore << " -> " << s.instructionsAfter;
+        blocks << s.blocksBefore << " -> " << s.blocksAfter;
+        out << std::left << std::setw(12) << passes[i]->name() << std::right << std::setw(10)
+            << std::fixed << std::setprecision(3) << s.milliseconds << std::setw(16) << instrs.str()
+            << std::setw(14) << blocks.str() << "   " << (s.changed ? "" : "(no change) ")
+            << passes[i]->counters() << "\n";
+        total += s.milliseconds;
+    }
+    out << std::left << std::setw(12) << "total" << std::right << std::setw(10) << total << "\n";
+    out.unsetf(std::ios::floatfield);
+    out << "analyses: " << analysesComputed << " computed, " << analysesReused << " reused\n";
+}
@@ -0,0 +1,59 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include "analysis_manager.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One optimization over the IR. Function passes override runOnFunction;
+// passes that look across functions override runOnModule instead. Both
+// return whether anything changed.
+class Pass {
+public:
+    virtual ~Pass() {}
+    virtual const char* name() const = 0;
+    virtual bool runOnModule(IRModule& module, AnalysisManager& analyses);
+    virtual bool runOnFunction(IRModule&, size_t, AnalysisManager&) { return false; }
+    // Pass-specific counters for the statistics report, e.g. "3 folded".
+    virtual std::string counters() const { return ""; }
+};
+
+// Registered passes by name; createPass returns null for an unknown name.
+std::unique_ptr<Pass> createPass(const std::string& name);
+const std::vector<std::string>& passNames();
+
+// Runs a pipeline of passes, sharing one AnalysisManager so a CFG or
+// liveness computed for one pass is reused by the next one as long as the
+// function has not changed in between. Records wall time and instruction
+// and block counts around every pass.
+class PassManager {
+public:
+    void add(std::unique_ptr<Pass> pass) { passes.push_back(std::move(pass)); }
+    // -O0 runs nothing, -O1 cleans up locally, -O2 merges duplicate functions,
+    // inlines, optimizes in SSA form and then optimizes loops.
+    void addOptimizationLevel(int level);
+    // Comma-separated pass names; on an unknown name returns false and
+    // leaves it in `error`.
+    bool addPipeline(const std::string& list, std::string& error);
+    bool empty() const { return passes.empty(); }
+
+    void run(IRModule& module);
+    void printStatistics(std::ostream& out) const;
+
+private:
+    struct Stats {
+        double milliseconds;
+        size_t instructionsBefore, instructionsAfter;
+        size_t blocksBefore, blocksAfter;
+        bool changed;
+    };
+
+    std::vector<std::unique_ptr<Pass>> passes;
+    std::vector<Stats> stats;
+    size_t analysesComputed = 0;
+    size_t analysesReused = 0;
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "peephole.h"
+#include "ssa.h"
+#include <unordered_map>
+
+namespace {
+
+// Per-name definition and use counts, shared by the patterns.
+struct Context {
+    const IRSymbols& pool;
+    const LocalSymbols& syms;
+    const std::vector<uint32_t>& defs;
+    const std::vector<uint32_t>& uses;
+
+    // Defined once and read once, so the definition can be folded into
+    // its reader.
+    bool singleUse(Operand o) const {
+        uint32_t s = syms.id(o);
+        return s != LocalSymbols::NONE && defs[s] == 1 && uses[s] == 1;
+    }
+    bool isIntConstant(Operand o, int64_t v) const {
+        if (!o.isConst()) return false;
+        const Value& c = pool.constant(o.index());
+        return c.type == T_INT && c.i == v;
+    }
+};
+
+// A pattern inspects the instructions starting at `w` (`n` of them are
+// left in the function). When it matches it appends the replacement to
+// `out` and returns how many instructions it consumed; otherwise 0.
+typedef size_t (*Rewrite)(const TACInstruction* w, size_t n, const Context& ctx,
+                          std::vector<TACInstruction>& out);
+
+// x = x
+size_t dropSelfCopy(const TACInstruction* w, size_t, const Context&, std::vector<TACInstruction>&) {
+    return w[0].op == Opcode::Copy && w[0].result == w[0].arg1 ? 1 : 0;
+}
+
+// x = y + 0, x = 0 + y, x = y - 0, x = y * 1, x = 1 * y, x = y / 1 on ints
+size_t simplifyIdentity(const TACInstruction* w, size_t, const Context& ctx,
+                        std::vector<TACInstruction>& out) {
+    const TACInstruction& in = w[0];
+    if (in.valueType() != T_INT) return 0;
+    Operand keep;
+    switch (in.op) {
+        case Opcode::Add:
+            if (ctx.isIntConstant(in.arg2, 0)) keep = in.arg1;
+            else if (ctx.isIntConstant(in.arg1, 0)) keep = in.arg2;
+            break;
+        case Opcode::Sub:
+            if (ctx.isIntConstant(in.arg2, 0)) keep = in.arg1;
+            break;
+        case Opcode::Mul:
+            if (ctx.isIntConstant(in.arg2, 1)) keep = in.arg1;
+            else if (ctx.isIntConstant(in.arg1, 1)) keep = in.arg2;
+            break;
+        case Opcode::Div:
+            if (ctx.isIntConstant(in.arg2, 1)) keep = in.arg1;
+            break;
+        default:
+            break;
+    }
+    if (keep.empty()) return 0;
+    out.emplace_back(Opcode::Copy, in.result, keep, Operand(), T_INT);
+    return 1;
+}
+
+// t = a op b; x = t  =>  x = a op b
+size_t mergeTempIntoCopy(const TACInstruction* w, size_t n, const Context& ctx,
+                         std::vector<TACInstruction>& out) {
+    if (n < 2 || w[1].op != Opcode::Copy || w[1].arg1 != w[0].result) return 0;
+    if (!definesResult(w[0]) || w[0].op == Opcode::Phi || w[0].type != w[1].type) return 0;
+    if (!ctx.singleUse(w[0].result)) return 0;
+    out.push_back(w[0]);
+    out.back().result = w[1].result;
+    return 2;
+}
+
+// t = a < b; ifFalse t goto L  =>  ifFalse a < b goto L
+// The negated sense is kept as a flag rather than inverting the comparison,
+// which would be wrong for NaN; == and != are inverted since that is exact.
+size_t fuseCompareBranch(const TACInstruction* w, size_t n, const Context& ctx,
+                         std::vector<TACInstruction>& out) {
+    if (n < 2 || w[0].op < Opcode::Eq || w[0].op > Opcode::Ge) return 0;
+    if ((w[1].op != Opcode::If && w[1].op != Opcode::IfFalse) || w[1].arg1 != w[0].result) return 0;
+    if (!ctx.singleUse(w[0].result)) return 0;
+    Opcode cmp = w[0].op;
+    bool negated = w[1].op == Opcode::IfFalse;
+    if (negated && (cmp == Opcode::Eq || cmp == Opcode::Ne)) {
+        cmp = cmp == Opcode::Eq ? Opcode::Ne : Opcode::Eq;
+        negated = false;
+    }
+    out.emplace_back(fusedBranchFor(cmp), w[1].result, w[0].arg1, w[0].arg2);
+    if (negated) out.back().flags |= BRANCH_IF_FALSE;
+    return 2;
+}
+
+// t = !c; ifFalse t goto L  =>  if c goto L  (and the other way round)
+size_t invertNotBranch(const TACInstruction* w, size_t n, const Context& ctx,
+                       std::vector<TACInstruction>& out) {
+    if (n < 2 || w[0].op != Opcode::Not) return 0;
+    if ((w[1].op != Opcode::If && w[1].op != Opcode::IfFalse) || w[1].arg1 != w[0].result) return 0;
+    if (!ctx.singleUse(w[0].result)) return 0;
+    Opcode branch = w[1].op == Opcode::If ? Opcode::IfFalse : Opcode::If;
+    out.emplace_back(branch, w[1].result, w[0].arg1);
+    return 2;
+}
+
+// goto L; L:  =>  L:  (likewise a conditional branch to L)
+size_t dropGotoNext(const TACInstruction* w, size_t n, const Context&, std::vector<TACInstruction>&) {
+    if (w[0].op != Opcode::Goto && !isConditionalBranch(w[0].op)) return 0;
+    for (size_t j = 1; j < n && w[j].op == Opcode::Label; ++j) {
+        if (w[j].result == w[0].result) return fallsThroughTo(w, n, 0, j) ? 1 : 0;
+    }
+    return 0;
+}
+
+struct Pattern {
+    const char* name;
+    Rewrite rewrite;
+};
+
+const Pattern patterns[] = {
+    {"self-copy", dropSelfCopy},
+    {"identity", simplifyIdentity},
+    {"temp-into-copy", mergeTempIntoCopy},
+    {"compare-branch", fuseCompareBranch},
+    {"not-branch", invertNotBranch},
+    {"goto-next", dropGotoNext},
+};
+
+}
+
+bool PeepholeOptimizer::run(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    bool changedAny = false;
+    for (;;) {
+        bool changed = applyPatterns(module, fn, analyses);
+        changed |= propagateCopies(module, fn, analyses);
+        changed |= threadJumps(module, fn);
+        if (!changed) break;
+        changedAny = true;
+    }
+    return changedAny;
+}
+
+bool PeepholeOptimizer::propagateCopies(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> code = module.code(fn);
+    const IRSymbols& pool = module.symbols();
+    const CFG& cfg = analyses.cfg(fn);
+    const LocalSymbols& syms = analyses.symbols(fn);
+    const uint32_t NONE = LocalSymbols::NONE;
+
+    // Params count as a definition at entry.
+    std::vector<uint32_t> defs(syms.size(), 0);
+    std::vector<uint8_t> defType(syms.size(), T_VOID);
+    for (const auto& p : module.params(fn)) {
+        uint32_t s = syms.id(Operand::var(p.name));
+        ++defs[s];
+        defType[s] = p.type;
+    }
+    for (const auto& instr : code) {
+        if (!definesResult(instr)) continue;
+        uint32_t s = syms.id(instr.result);
+        ++defs[s];
+        defType[s] = instr.type;
+    }
+    auto sameType = [&](Operand o, uint8_t type) {
+        if (o.isConst()) return pool.constant(o.index()).type == type;
+        uint32_t s = syms.id(o);
+        return s != NONE && defType[s] == type;
+    };
+    auto stable = [&](Operand o) {
+        if (o.isConst()) return true;
+        uint32_t s = syms.id(o);
+        return s != NONE && defs[s] == 1;
+    };
+
+    std::vector<uint32_t> copyAt(syms.size(), NONE);
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op != Opcode::Copy || instr.result == instr.arg1) continue;
+        uint32_t s = syms.id(instr.result);
+        if (defs[s] == 1 && stable(instr.arg1) && sameType(instr.arg1, instr.type)) copyAt[s] = i;
+    }
+    // The source of a chain of such copies; every link dominates the next.
+    auto source = [&](Operand o) {
+        for (size_t guard = 0; guard < code.size(); ++guard) {
+            uint32_t s = syms.id(o);
+            if (s == NONE || copyAt[s] == NONE) break;
+            o = code[copyAt[s]].arg1;
+        }
+        return o;
+    };
+    // Whether the copy has executed by `at` in `block` (NONE: block end).
+    auto reaches = [&](uint32_t copy, uint32_t block, uint32_t at) {
+        uint32_t cb = cfg.blockOfInstruction(copy);
+        if (cb == block) return at == NONE || copy < at;
+        return cfg.isReachable(block) && cfg.dominates(cb, block);
+    };
+
+    std::vector<TACInstruction> out(code.begin(), code.end());
+    std::vector<uint32_t> remaining(syms.size(), 0);
+    std::unordered_map<uint32_t, Operand> local;
+    bool changed = false;
+
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        local.clear();
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction& instr = out[i];
+            auto substitute = [&](Operand& o, uint32_t block, uint32_t at, bool blockLocal) {
+                uint32_t s = syms.id(o);
+                if (s == NONE) return;
+                if (copyAt[s] != NONE && reaches(copyAt[s], block, at)) {
+                    o = source(o);
+                } else if (blockLocal && local.count(s)) {
+                    o = local[s];
+                } else {
+                    ++remaining[s];
+                    return;
+                }
+                ++copyCount;
+                changed = true;
+            };
+
+            if (instr.op == Opcode::Phi) {
+                // The incoming value is read at the end of its predecessor.
+                substitute(instr.arg1, cfg.blockOfLabel(instr.arg2.index()), NONE, false);
+            } else {
+                uint8_t mask = useMask(instr);
+                // Array bases of Load and Store are not values to propagate.
+                if ((mask & USE_RESULT) && instr.op != Opcode::Store) substitute(instr.result, b, i, true);
+                if ((mask & USE_ARG1) && instr.op != Opcode::Load) substitute(instr.arg1, b, i, true);
+                if (mask & USE_ARG2) substitute(instr.arg2, b, i, true);
+            }
+
+            if (!definesResult(instr)) continue;
+            uint32_t s = syms.id(instr.result);
+            local.erase(s);
+            for (auto it = local.begin(); it != local.end();) {
+                if (it->second == instr.result) it = local.erase(it);
+                else ++it;
+            }
+            if (instr.op == Opcode::Copy && copyAt[s] == NONE && instr.arg1 != instr.result &&
+                (instr.arg1.isConst() || isSymbol(instr.arg1)) && sameType(instr.arg1, instr.type)) {
+                local[s] = instr.arg1;
+            }
+        }
+    }
+
+    // Copies whose every use was replaced are no longer needed.
+    std::vector<TACInstruction> kept;
+    kept.reserve(out.size());
+    for (uint32_t i = 0; i < out.size(); ++i) {
+        const TACInstruction& instr = out[i];
+        if (instr.op == Opcode::Copy) {
+            uint32_t s = syms.id(instr.result);
+            if (s != NONE && copyAt[s] == i && remaining[s] == 0) {
+                changed = true;
+                continue;
+            }
+        }
+        kept.push_back(instr);
+    }
+
+    if (changed) module.replaceCode(fn, kept);
+    return changed;
+}
+
+bool PeepholeOptimizer::applyPatterns(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> code = module.code(fn);
+    const LocalSymbols& syms = analyses.symbols(fn);
+    std::vector<uint32_t> defs(syms.size(), 0), uses(syms.size(), 0);
+    for (const auto& p : module.params(fn)) ++defs[syms.id(Operand::var(p.name))];
+    auto count = [&](std::vector<uint32_t>& counts, Operand o) {
+        uint32_t s = syms.id(o);
+        if (s != LocalSymbols::NONE) ++counts[s];
+    };
+    for (const auto& instr : code) {
+        uint8_t mask = instr.op == Opcode::Phi ? static_cast<uint8_t>(USE_ARG1) : useMask(instr);
+        if (mask & USE_RESULT) count(uses, instr.result);
+        if (mask & USE_ARG1) count(uses, instr.arg1);
+        if (mask & USE_ARG2) count(uses, instr.arg2);
+        if (definesResult(instr)) count(defs, instr.result);
+    }
+    Context ctx{module.symbols(), syms, defs, uses};
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    bool changed = false;
+    for (size_t i = 0; i < code.size();) {
+        size_t consumed = 0;
+        for (const Pattern& p : patterns) {
+            consumed = p.rewrite(code.begin() + i, code.size() - i, ctx, out);
+            if (consumed) break;
+        }
+        if (consumed) {
+            ++rewriteCount;
+            changed = true;
+            i += consumed;
+        } else {
+            out.push_back(code[i++]);
+        }
+    }
+
+    if (changed) module.replaceCode(fn, out);
+    return changed;
+}
+
+bool PeepholeOptimizer::threadJumps(IRModule& module, size_t fn) {
+    Span<const TACInstruction> code = module.code(fn);
+    uint32_t labels = module.function(fn).labelCount;
+    const uint32_t NONE = CFG::NONE;
+
+    // For each label, the label its block immediately jumps to, and whether
+    // its block starts with phis (those name their predecessors, so the
+    // set of predecessors must not change).
+    std::vector<uint32_t> next(labels, NONE);
+    std::vector<char> hasPhis(labels, 0);
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op != Opcode::Label) continue;
+        size_t j = i + 1;
+        while (j < code.size() && code[j].op == Opcode::Label) ++j;
+        if (j == code.size()) continue;
+        uint32_t l = code[i].result.index();
+        if (code[j].op == Opcode::Goto) next[l] = code[j].result.index();
+        if (code[j].op == Opcode::Phi) hasPhis[l] = 1;
+    }
+    auto finalTarget = [&](uint32_t start) {
+        uint32_t l = start;
+        for (uint32_t steps = 0; next[l] != NONE && !hasPhis[next[l]]; ++steps) {
+            if (steps == labels) return start;   // a cycle of gotos
+            l = next[l];
+        }
+        return l;
+    };
+
+    std::vector<TACInstruction> out(code.begin(), code.end());
+    bool changed = false;
+    for (auto& instr : out) {
+        if (instr.op != Opcode::Goto && !isConditionalBranch(instr.op)) continue;
+        uint32_t target = finalTarget(instr.result.index());
+        if (target == instr.result.index()) continue;
+        instr.result = Operand::label(target);
+        ++threadCount;
+        changed = true;
+    }
+
+    if (changed) module.replaceCode(fn, out);
+    return changed;
+}
@@ -0,0 +1,36 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+
+// A table of local rewrite patterns (see peephole.cpp), copy propagation
+// and jump threading, repeated until nothing changes.
+//
+// A copy `x = y` of a constant or of a singly defined name into a singly
+// defined x is propagated to every use it dominates and then removed.
+// Other copies are propagated within their block until either side is
+// reassigned. Copies that convert between types are left alone.
+class PeepholeOptimizer {
+public:
+    bool run(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool run(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        return run(module, fn, analyses);
+    }
+
+    size_t copiesPropagated() const { return copyCount; }
+    size_t rewrites() const { return rewriteCount; }
+    size_t jumpsThreaded() const { return threadCount; }
+
+private:
+    size_t copyCount = 0;
+    size_t rewriteCount = 0;
+    size_t threadCount = 0;
+
+    bool propagateCopies(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool applyPatterns(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool threadJumps(IRModule& module, size_t fn);
+};
+
+#endif
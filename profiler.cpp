@@ -0,0 +1,171 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+bool isJump(VMOp op) { return op >= VMOp::Jump && op <= VMOp::JumpLeF; }
+
+// Count column of the annotated listing; code that never ran stands out.
+std::string countText(uint64_t n) { return n ? std::to_string(n) : "#####"; }
+
+}
+
+ExecutionProfile::ExecutionProfile(const IRModule& module, const BytecodeVM& vm) : module(module) {
+    if (vm.functionCount() != module.functionCount())
+        throw ProfileException("Profile counts do not come from this module");
+    functions.resize(module.functionCount());
+    size_t line = 1;
+    for (size_t fn = 0; fn < module.functionCount(); ++fn) {
+        const BytecodeFunction& lowered = vm.function(fn);
+        if (lowered.name != module.functionName(fn) || lowered.tacStart.size() != module.code(fn).size() + 1)
+            throw ProfileException("Profile counts for " + lowered.name + " do not come from this module");
+        functions[fn].headerLine = line;
+        line += module.params(fn).size() + module.code(fn).size() + 2;
+        countFunction(fn, lowered, vm);
+    }
+}
+
+// An instruction runs as often as control falls into it, jumps to it or,
+// for the first one, enters the function. The VM counted the jumps, each
+// the last instruction its TAC jump lowers to, so one pass in code order
+// settles every count.
+void ExecutionProfile::countFunction(size_t fn, const BytecodeFunction& lowered, const BytecodeVM& vm) {
+    FunctionProfile& p = functions[fn];
+    Span<const TACInstruction> body = module.code(fn);
+    p.calls = vm.callCount(fn);
+    p.counts.assign(body.size(), 0);
+    p.taken.assign(body.size(), 0);
+    p.cfg.build(body, module.function(fn).labelCount);
+    if (!lowered.loweringError.empty()) return;     // its calls fail at once
+
+    std::vector<uint64_t> jumps(body.size(), 0);
+    std::vector<uint64_t> jumpedTo(module.function(fn).labelCount, 0);
+    for (size_t i = 0; i < body.size(); ++i) {
+        Opcode op = body[i].op;
+        if (op != Opcode::Goto && !isConditionalBranch(op)) continue;
+        uint32_t end = lowered.tacStart[i + 1];
+        if (end > lowered.tacStart[i] && isJump(lowered.code[end - 1].op)) jumps[i] = vm.takenCount(fn, end - 1);
+        jumpedTo[body[i].result.index()] += jumps[i];
+    }
+
+    uint64_t fallThrough = p.calls;
+    for (size_t i = 0; i < body.size(); ++i) {
+        const TACInstruction& instr = body[i];
+        p.counts[i] = fallThrough + (instr.op == Opcode::Label ? jumpedTo[instr.result.index()] : 0);
+        if (isConditionalBranch(instr.op)) p.taken[i] = std::min(p.counts[i], jumps[i]);
+        if (instr.op == Opcode::Goto || instr.op == Opcode::Return) fallThrough = 0;
+        else fallThrough = p.counts[i] - p.taken[i];
+    }
+}
+
+uint64_t ExecutionProfile::instructionsExecuted(size_t fn) const {
+    Span<const TACInstruction> body = module.code(fn);
+    uint64_t total = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (body[i].op != Opcode::Label) total += functions[fn].counts[i];
+    }
+    return total;
+}
+
+void ExecutionProfile::printReport(std::ostream& out) const {
+    uint64_t total = 0;
+    for (size_t fn = 0; fn < functions.size(); ++fn) total += instructionsExecuted(fn);
+
+    out << std::left << std::setw(20) << "function" << std::right << std::setw(12) << "calls" << std::setw(16)
+        << "instructions" << std::setw(9) << "share" << "\n";
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        uint64_t n = instructionsExecuted(fn);
+        out << std::left << std::setw(20) << module.functionName(fn) << std::right << std::setw(12)
+            << functions[fn].calls << std::setw(16) << n << std::setw(8) << std::fixed << std::setprecision(1)
+            << (total ? 100.0 * n / total : 0.0) << "%\n";
+    }
+
+    // Blocks ranked by the instructions they executed.
+    struct HotBlock {
+        size_t fn;
+        uint32_t block;
+        uint64_t instructions;
+    };
+    std::vector<HotBlock> hot;
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        const CFG& cfg = functions[fn].cfg;
+        Span<const TACInstruction> body = module.code(fn);
+        for (uint32_t b = 0; b < cfg.size(); ++b) {
+            uint64_t size = 0;
+            for (uint32_t i = cfg.block(b).begin; i < cfg.block(b).end; ++i) size += body[i].op != Opcode::Label;
+            if (blockCount(fn, b) && size) hot.push_back(HotBlock{fn, b, blockCount(fn, b) * size});
+        }
+    }
+    std::sort(hot.begin(), hot.end(), [](const HotBlock& x, const HotBlock& y) {
+        return x.instructions > y.instructions;
+    });
+    if (hot.size() > 10) hot.resize(10);
+    out << "\nHottest blocks:\n";
+    for (const HotBlock& h : hot) {
+        const BasicBlock& block = functions[h.fn].cfg.block(h.block);
+        std::ostringstream where;
+        where << module.functionName(h.fn) << " B" << h.block;
+        out << "  " << std::left << std::setw(20) << where.str() << std::right << " lines " << std::setw(5)
+            << printedLine(h.fn, block.begin) << "-" << std::left << std::setw(5) << printedLine(h.fn, block.end - 1)
+            << std::right << std::setw(12) << blockCount(h.fn, h.block) << " runs" << std::setw(16)
+            << h.instructions << " instructions\n";
+    }
+
+    const IRSymbols& syms = module.symbols();
+    out << "\n" << std::right << std::setw(12) << "count" << std::setw(6) << "line" << std::setw(6) << "block"
+        << "\n";
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        const FunctionProfile& p = functions[fn];
+        size_t line = p.headerLine;
+        out << std::setw(12) << p.calls << std::setw(6) << line++ << std::setw(6) << "" << "  func_"
+            << module.functionName(fn) << ":\n";
+        for (const auto& param : module.params(fn)) {
+            out << std::setw(12) << "" << std::setw(6) << line++ << std::setw(6) << "" << "      param "
+                << syms.name(param.name) << "\n";
+        }
+        Span<const TACInstruction> body = module.code(fn);
+        for (uint32_t i = 0; i < body.size(); ++i) {
+            uint32_t b = p.cfg.blockOfInstruction(i);
+            std::string mark = p.cfg.block(b).begin == i ? "B" + std::to_string(b) : "";
+            out << std::setw(12) << countText(p.counts[i]) << std::setw(6) << line++ << std::setw(6) << mark << "  "
+                << body[i].toString(syms);
+            if (isConditionalBranch(body[i].op)) {
+                out << "    [taken " << p.taken[i] << ", not taken " << p.counts[i] - p.taken[i] << "]";
+            }
+            out << "\n";
+        }
+        out << std::setw(12) << "" << std::setw(6) << line++ << std::setw(6) << "" << "  end_"
+            << module.functionName(fn) << ":\n";
+    }
+}
+
+void ExecutionProfile::write(std::ostream& out) const {
+    out << "# TAC execution profile; lines are those of the printed module\n";
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        const FunctionProfile& p = functions[fn];
+        out << "function\t" << fn << "\t" << module.functionName(fn) << "\t" << p.headerLine << "\t" << p.calls
+            << "\t" << instructionsExecuted(fn) << "\n";
+        for (uint32_t b = 0; b < p.cfg.size(); ++b) {
+            const BasicBlock& block = p.cfg.block(b);
+            out << "block\t" << fn << "\t" << b << "\t" << printedLine(fn, block.begin) << "\t"
+                << printedLine(fn, block.end - 1) << "\t" << blockCount(fn, b) << "\n";
+        }
+        Span<const TACInstruction> body = module.code(fn);
+        for (size_t i = 0; i < body.size(); ++i) {
+            out << "instr\t" << fn << "\t" << i << "\t" << printedLine(fn, i) << "\t" << p.counts[i] << "\n";
+            if (isConditionalBranch(body[i].op)) {
+                out << "branch\t" << fn << "\t" << i << "\t" << printedLine(fn, i) << "\t" << p.taken[i] << "\t"
+                    << p.counts[i] - p.taken[i] << "\n";
+            }
+        }
+    }
+}
+
+void ExecutionProfile::writeFile(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) throw ProfileException("Cannot write profile file: " + path);
+    write(out);
+}
@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "bytecode_vm.h"
+#include "cfg.h"
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class ProfileException : public std::exception
+{
+    std::string message;
+public:
+    explicit ProfileException(const std::string& msg) : message(msg) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
+// Execution counts for a module, read from a BytecodeVM that ran it in
+// profiling mode. The VM only counts calls and taken jumps; every other
+// count follows from those along the lowered code, so the instrumented
+// interpreter stays close to full speed. Counts are then mapped back to
+// TAC instructions and their basic blocks. A run stopped by a VM error
+// leaves the rest of the block it stopped in counted as executed.
+//
+// Line numbers refer to the module as IRModule::print writes it, which is
+// also the --emit-tac output.
+class ExecutionProfile {
+public:
+    ExecutionProfile(const IRModule& module, const BytecodeVM& vm);
+
+    uint64_t calls(size_t fn) const { return functions[fn].calls; }
+    uint64_t count(size_t fn, size_t instr) const { return functions[fn].counts[instr]; }
+    // For conditional branches; zero elsewhere.
+    uint64_t taken(size_t fn, size_t instr) const { return functions[fn].taken[instr]; }
+    uint64_t instructionsExecuted(size_t fn) const;
+    size_t printedLine(size_t fn, size_t instr) const {
+        return functions[fn].headerLine + module.params(fn).size() + 1 + instr;
+    }
+
+    // Per-function summary, the hottest blocks, then every function's TAC
+    // annotated with its counts.
+    void printReport(std::ostream& out) const;
+    // One tab-separated record per line:
+    //   function <fn> <name> <line> <calls> <instructions executed>
+    //   block    <fn> <block> <first line> <last line> <count>
+    //   instr    <fn> <index> <line> <count>
+    //   branch   <fn> <index> <line> <taken> <not taken>
+    void write(std::ostream& out) const;
+    void writeFile(const std::string& path) const;
+
+private:
+    struct FunctionProfile {
+        uint64_t calls = 0;
+        size_t headerLine = 0;      // the func_ line
+        std::vector<uint64_t> counts;
+        std::vector<uint64_t> taken;
+        CFG cfg;
+    };
+
+    const IRModule& module;
+    std::vector<FunctionProfile> functions;
+
+    void countFunction(size_t fn, const BytecodeFunction& lowered, const BytecodeVM& vm);
+    uint64_t blockCount(size_t fn, uint32_t b) const {
+        return functions[fn].counts[functions[fn].cfg.block(b).begin];
+    }
+};
+
+#endif
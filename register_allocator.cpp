@@ -0,0 +1,76 @@
+#include "register_allocator.h"
+#include <algorithm>
+
+void LinearScanAllocator::allocate(const IRModule& module, size_t fn, AnalysisManager& analyses) {
+    syms = analyses.symbols(fn);
+    live.compute(module, fn, analyses.cfg(fn), syms, analyses.globalSymbols(fn), analyses.liveness(fn));
+    locations.assign(syms.size(), Location());
+    usedRegisters = 0;
+    usedSlots = 0;
+    spilledCount = 0;
+
+    const std::vector<LiveInterval>& intervals = live.intervals();
+    // Active register intervals ordered by end. A spill slot is free for an
+    // interval once its previous owner ended before that interval starts.
+    std::vector<const LiveInterval*> active;
+    std::vector<uint32_t> freeRegisters, slotEnd;
+    for (uint32_t r = registerCount; r-- > 0;) freeRegisters.push_back(r);
+
+    auto byEnd = [](const LiveInterval* a, const LiveInterval* b) { return a->end < b->end; };
+    auto spill = [&](const LiveInterval& iv) {
+        uint32_t slot = 0;
+        while (slot < slotEnd.size() && slotEnd[slot] >= iv.start) ++slot;
+        if (slot == slotEnd.size()) slotEnd.push_back(0);
+        slotEnd[slot] = iv.end;
+        usedSlots = std::max(usedSlots, slot + 1);
+        locations[iv.symbol] = Location(Location::STACK, slot);
+        ++spilledCount;
+    };
+
+    for (const LiveInterval& cur : intervals) {
+        size_t expired = 0;
+        while (expired < active.size() && active[expired]->end < cur.start) {
+            freeRegisters.push_back(locations[active[expired]->symbol].index);
+            ++expired;
+        }
+        active.erase(active.begin(), active.begin() + expired);
+
+        if (!freeRegisters.empty()) {
+            uint32_t r = freeRegisters.back();
+            freeRegisters.pop_back();
+            locations[cur.symbol] = Location(Location::REGISTER, r);
+            usedRegisters = std::max(usedRegisters, r + 1);
+            active.insert(std::upper_bound(active.begin(), active.end(), &cur, byEnd), &cur);
+            continue;
+        }
+        if (active.empty()) {
+            spill(cur);
+            continue;
+        }
+        const LiveInterval* last = active.back();
+        if (last->end > cur.end) {
+            locations[cur.symbol] = locations[last->symbol];
+            active.pop_back();
+            spill(*last);
+            active.insert(std::upper_bound(active.begin(), active.end(), &cur, byEnd), &cur);
+        } else {
+            spill(cur);
+        }
+    }
+}
+
+Location LinearScanAllocator::location(Operand o) const {
+    uint32_t s = syms.id(o);
+    return s == LocalSymbols::NONE ? Location() : locations[s];
+}
+
+void LinearScanAllocator::print(std::ostream& out, const IRModule& module) const {
+    for (const LiveInterval& iv : live.intervals()) {
+        const Location& loc = locations[iv.symbol];
+        out << "    " << module.symbols().render(syms.operand(iv.symbol)) << " -> "
+            << (loc.kind == Location::REGISTER ? "r" : "s") << loc.index << " [" << iv.start << ", "
+            << iv.end << "]\n";
+    }
+    out << "    (" << usedRegisters << " registers, " << usedSlots << " spill slots, " << spilledCount
+        << " spilled)\n";
+}
@@ -0,0 +1,53 @@
+#ifndef REGISTER_ALLOCATOR_H
+#define REGISTER_ALLOCATOR_H
+
+#include "analysis_manager.h"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Where a var or temp lives for the whole function.
+struct Location {
+    enum Kind : uint8_t { NONE, REGISTER, STACK };
+    Kind kind;
+    uint32_t index;     // register number or spill slot
+
+    Location() : kind(NONE), index(0) {}
+    Location(Kind k, uint32_t i) : kind(k), index(i) {}
+};
+
+// Linear-scan allocation (Poletto and Sarkar) of the vars and temps of one
+// function onto a fixed number of registers. When every register is taken
+// the interval that ends last is spilled to a stack slot; registers and
+// slots are reused once their interval has ended. A value whose last read
+// is the instruction defining another may share its register, since reads
+// and writes of an instruction get distinct positions.
+class LinearScanAllocator {
+public:
+    explicit LinearScanAllocator(uint32_t registers = 16) : registerCount(registers) {}
+
+    void allocate(const IRModule& module, size_t fn, AnalysisManager& analyses);
+    void allocate(const IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        allocate(module, fn, analyses);
+    }
+
+    Location location(Operand o) const;
+    const LocalSymbols& symbols() const { return syms; }
+    uint32_t registersUsed() const { return usedRegisters; }
+    uint32_t spillSlots() const { return usedSlots; }
+    size_t spilled() const { return spilledCount; }
+
+    void print(std::ostream& out, const IRModule& module) const;
+
+private:
+    uint32_t registerCount;
+    LocalSymbols syms;
+    LiveIntervals live;
+    std::vector<Location> locations;
+    uint32_t usedRegisters = 0;
+    uint32_t usedSlots = 0;
+    size_t spilledCount = 0;
+};
+
+#endif
@@ -0,0 +1,335 @@
+#include "ssa.h"
+#include "cfg.h"
+#include "liveness.h"
+#include "ir_generator.h"
+#include <algorithm>
+
+namespace {
+
+struct PhiNode {
+    uint32_t symbol;
+    Operand dest;
+    std::vector<std::pair<Operand, Operand>> incoming;  // (pred label, value)
+};
+
+struct ParallelCopy {
+    Operand dest;
+    Operand src;
+    BasicType type;
+};
+
+// Gives every reachable block a label, drops unreachable blocks, and adds
+// an empty entry block when the first block is itself a jump target.
+std::vector<TACInstruction> normalizeBlocks(IRModule& module, size_t fn, const CFG& cfg) {
+    Span<const TACInstruction> code = module.code(fn);
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size() + cfg.size() + 1);
+    if (cfg.size() > 0 && !cfg.predecessors(0).empty())
+        out.emplace_back(Opcode::Label, module.newLabel(fn));
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        if (!cfg.isReachable(b)) continue;
+        const BasicBlock& bb = cfg.block(b);
+        if (code[bb.begin].op != Opcode::Label) out.emplace_back(Opcode::Label, module.newLabel(fn));
+        out.insert(out.end(), code.begin() + bb.begin, code.begin() + bb.end);
+    }
+    return out;
+}
+
+}
+
+void removeStalePhiInputs(std::vector<TACInstruction>& code, uint32_t labelCount) {
+    bool hasPhi = false;
+    for (const auto& instr : code) hasPhi |= instr.op == Opcode::Phi;
+    if (!hasPhi) return;
+
+    CFG cfg;
+    cfg.build(Span<const TACInstruction>(code.data(), code.size()), labelCount);
+    std::vector<TACInstruction> kept;
+    kept.reserve(code.size());
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instr = code[i];
+        if (instr.op == Opcode::Phi) {
+            uint32_t pred = cfg.blockOfLabel(instr.arg2.index());
+            bool live = false;
+            if (pred != CFG::NONE) {
+                for (uint32_t p : cfg.predecessors(cfg.blockOfInstruction(i))) live |= p == pred;
+            }
+            if (!live) continue;
+        }
+        kept.push_back(instr);
+    }
+    code.swap(kept);
+}
+
+void SSABuilder::construct(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    if (module.function(fn).ssa) return;
+    module.replaceCode(fn, normalizeBlocks(module, fn, analyses.cfg(fn)));
+
+    Span<const TACInstruction> view = module.code(fn);
+    std::vector<TACInstruction> code(view.begin(), view.end());
+    const CFG& cfg = analyses.cfg(fn);
+    const LocalSymbols& all = analyses.symbols(fn);
+    const LocalSymbols& globals = analyses.globalSymbols(fn);
+    const Liveness& live = analyses.liveness(fn);
+
+    const uint32_t NONE = LocalSymbols::NONE;
+    uint32_t nb = static_cast<uint32_t>(cfg.size());
+    size_t ns = all.size();
+    IRSymbols& syms = module.symbols();
+
+    std::vector<uint32_t> defCount(ns, 0);
+    std::vector<BasicType> symType(ns, T_UNKNOWN);
+    std::vector<std::vector<uint32_t>> defBlocks(ns);
+    for (const auto& p : module.params(fn)) {
+        uint32_t s = all.id(Operand::var(p.name));
+        ++defCount[s];
+        symType[s] = p.type;
+        defBlocks[s].push_back(0);
+    }
+    for (uint32_t b = 0; b < nb; ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            if (!definesResult(code[i])) continue;
+            uint32_t s = all.id(code[i].result);
+            if (s == NONE) continue;
+            ++defCount[s];
+            if (symType[s] == T_UNKNOWN) symType[s] = code[i].valueType();
+            if (defBlocks[s].empty() || defBlocks[s].back() != b) defBlocks[s].push_back(b);
+        }
+    }
+
+    // Dominance frontiers by walking up from each join's predecessors.
+    std::vector<std::vector<uint32_t>> frontier(nb);
+    for (uint32_t b = 0; b < nb; ++b) {
+        Span<const uint32_t> preds = cfg.predecessors(b);
+        if (preds.size() < 2) continue;
+        for (uint32_t p : preds) {
+            for (uint32_t runner = p; runner != cfg.idom(b); runner = cfg.idom(runner)) {
+                if (frontier[runner].empty() || frontier[runner].back() != b) frontier[runner].push_back(b);
+            }
+        }
+    }
+
+    // Symbols with a single definition already satisfy SSA and keep their
+    // names; the others get phis wherever a merged value is live.
+    std::vector<std::vector<PhiNode>> phis(nb);
+    std::vector<uint32_t> hasPhi(nb, NONE), inWork(nb, NONE);
+    std::vector<uint32_t> worklist;
+    for (uint32_t s = 0; s < ns; ++s) {
+        if (defCount[s] < 2) continue;
+        uint32_t g = globals.id(all.operand(s));
+        if (g == NONE) continue;
+        worklist = defBlocks[s];
+        for (uint32_t d : worklist) inWork[d] = s;
+        while (!worklist.empty()) {
+            uint32_t d = worklist.back();
+            worklist.pop_back();
+            for (uint32_t y : frontier[d]) {
+                if (hasPhi[y] == s || !live.liveIn(y).test(g)) continue;
+                phis[y].push_back(PhiNode{s, Operand(), {}});
+                hasPhi[y] = s;
+                if (inWork[y] != s) {
+                    inWork[y] = s;
+                    worklist.push_back(y);
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<Operand>> stacks(ns);
+    std::vector<uint32_t> versions(ns, 0);
+    auto fresh = [&](uint32_t s) {
+        Operand orig = all.operand(s);
+        if (orig.isTemp()) return module.newTemp(fn);
+        const std::string base = syms.name(orig.index());
+        for (;;) {
+            std::string name = base + "." + std::to_string(++versions[s]);
+            uint32_t idx;
+            if (syms.findName(name, idx) && all.id(Operand::var(idx)) != NONE) continue;
+            return Operand::var(syms.internName(name));
+        }
+    };
+    auto current = [&](Operand o) {
+        uint32_t s = all.id(o);
+        if (s == NONE || stacks[s].empty()) return o;
+        return stacks[s].back();
+    };
+
+    // Rename over the dominator tree with an explicit stack; pushLog
+    // records which stacks each block pushed so they can be unwound.
+    struct Frame {
+        uint32_t block;
+        uint32_t child;
+        size_t mark;
+    };
+    std::vector<Frame> walk;
+    std::vector<uint32_t> pushLog;
+    auto enter = [&](uint32_t b) {
+        size_t mark = pushLog.size();
+        for (auto& phi : phis[b]) {
+            phi.dest = fresh(phi.symbol);
+            stacks[phi.symbol].push_back(phi.dest);
+            pushLog.push_back(phi.symbol);
+        }
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction& instr = code[i];
+            uint8_t mask = useMask(instr);
+            if (mask & USE_RESULT) instr.result = current(instr.result);
+            if (mask & USE_ARG1) instr.arg1 = current(instr.arg1);
+            if (mask & USE_ARG2) instr.arg2 = current(instr.arg2);
+            if (definesResult(instr)) {
+                uint32_t s = all.id(instr.result);
+                if (s != NONE && defCount[s] >= 2) {
+                    instr.result = fresh(s);
+                    stacks[s].push_back(instr.result);
+                    pushLog.push_back(s);
+                }
+            }
+        }
+        Operand label = code[bb.begin].result;
+        for (uint32_t succ : cfg.successors(b)) {
+            for (auto& phi : phis[succ]) phi.incoming.push_back({label, current(all.operand(phi.symbol))});
+        }
+        walk.push_back(Frame{b, 0, mark});
+    };
+
+    if (nb > 0) enter(0);
+    while (!walk.empty()) {
+        Frame& top = walk.back();
+        Span<const uint32_t> kids = cfg.domChildren(top.block);
+        if (top.child < kids.size()) {
+            uint32_t c = kids[top.child++];
+            enter(c);
+        } else {
+            while (pushLog.size() > top.mark) {
+                stacks[pushLog.back()].pop_back();
+                pushLog.pop_back();
+            }
+            walk.pop_back();
+        }
+    }
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    for (uint32_t b = 0; b < nb; ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        out.push_back(code[bb.begin]);
+        for (const auto& phi : phis[b]) {
+            for (const auto& in : phi.incoming)
+                out.emplace_back(Opcode::Phi, phi.dest, in.second, in.first, symType[phi.symbol]);
+            ++phiCount;
+        }
+        out.insert(out.end(), code.begin() + bb.begin + 1, code.begin() + bb.end);
+    }
+    module.replaceCode(fn, out);
+    module.setSSA(fn, true);
+}
+
+void SSABuilder::destruct(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    if (!module.function(fn).ssa) return;
+
+    Span<const TACInstruction> view = module.code(fn);
+    std::vector<TACInstruction> code(view.begin(), view.end());
+    const CFG& cfg = analyses.cfg(fn);
+    uint32_t nb = static_cast<uint32_t>(cfg.size());
+
+    struct Split {
+        Operand label;
+        Operand target;
+        std::vector<ParallelCopy> copies;
+    };
+    std::vector<std::vector<ParallelCopy>> endCopies(nb), afterCopies(nb);
+    std::vector<uint8_t> toGoto(nb, 0);
+    std::vector<Split> splits;
+
+    for (uint32_t b = 0; b < nb; ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        std::vector<std::pair<uint32_t, std::vector<ParallelCopy>>> byPred;
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            const TACInstruction& instr = code[i];
+            if (instr.op != Opcode::Phi) continue;
+            uint32_t pred = cfg.blockOfLabel(instr.arg2.index());
+            size_t k = 0;
+            while (k < byPred.size() && byPred[k].first != pred) ++k;
+            if (k == byPred.size()) byPred.push_back({pred, {}});
+            byPred[k].second.push_back(ParallelCopy{instr.result, instr.arg1, instr.valueType()});
+        }
+
+        for (auto& entry : byPred) {
+            uint32_t p = entry.first;
+            TACInstruction& last = code[cfg.block(p).end - 1];
+            if (cfg.successors(p).size() == 1) {
+                if (isConditionalBranch(last.op)) toGoto[p] = 1;
+                auto& dst = endCopies[p];
+                dst.insert(dst.end(), entry.second.begin(), entry.second.end());
+            } else if (b == p + 1) {
+                auto& dst = afterCopies[p];
+                dst.insert(dst.end(), entry.second.begin(), entry.second.end());
+            } else {
+                Operand splitLabel = module.newLabel(fn);
+                splits.push_back(Split{splitLabel, code[bb.begin].result, entry.second});
+                last.result = splitLabel;
+            }
+        }
+    }
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    auto emitCopies = [&](std::vector<ParallelCopy> pending) {
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                     [](const ParallelCopy& c) { return c.dest == c.src; }),
+                      pending.end());
+        while (!pending.empty()) {
+            bool progress = false;
+            for (size_t k = 0; k < pending.size() && !progress; ++k) {
+                bool blocked = false;
+                for (size_t j = 0; j < pending.size() && !blocked; ++j)
+                    blocked = j != k && pending[j].src == pending[k].dest;
+                if (blocked) continue;
+                out.emplace_back(Opcode::Copy, pending[k].dest, pending[k].src, Operand(), pending[k].type);
+                ++copyCount;
+                pending.erase(pending.begin() + k);
+                progress = true;
+            }
+            if (progress) continue;
+            // Every destination is still needed as a source: a cycle.
+            ParallelCopy& c = pending.front();
+            Operand saved = module.newTemp(fn);
+            out.emplace_back(Opcode::Copy, saved, c.dest, Operand(), c.type);
+            ++copyCount;
+            for (auto& other : pending) {
+                if (other.src == c.dest) other.src = saved;
+            }
+        }
+    };
+
+    for (uint32_t b = 0; b < nb; ++b) {
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction instr = code[i];
+            if (instr.op == Opcode::Phi) continue;
+            bool terminator = i + 1 == bb.end && endsBlock(instr.op);
+            if (terminator) {
+                emitCopies(endCopies[b]);
+                if (toGoto[b]) instr = TACInstruction(Opcode::Goto, instr.result);
+            }
+            out.push_back(instr);
+        }
+        if (!endsBlock(code[bb.end - 1].op)) emitCopies(endCopies[b]);
+        emitCopies(afterCopies[b]);
+    }
+    for (auto& split : splits) {
+        out.emplace_back(Opcode::Label, split.label);
+        emitCopies(split.copies);
+        out.emplace_back(Opcode::Goto, split.target);
+    }
+
+    module.replaceCode(fn, out);
+    module.setSSA(fn, false);
+}
+
+bool fallsThroughTo(const TACInstruction* code, size_t size, size_t jump, size_t target) {
+    return target == jump + 1 || target + 1 == size || code[target + 1].op != Opcode::Phi;
+}
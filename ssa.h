@@ -0,0 +1,45 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+#include <vector>
+
+// Converts a function body to pruned SSA and back. Phi nodes are placed
+// on iterated dominance frontiers only where the variable is live in, and
+// are written as one Phi instruction per incoming edge, naming the
+// predecessor by its label; construction therefore gives every block a
+// label. Destruction lowers phis to parallel copies on each edge,
+// splitting critical edges and sequentialising copy cycles through a temp.
+class SSABuilder {
+public:
+    void construct(IRModule& module, size_t fn, AnalysisManager& analyses);
+    void destruct(IRModule& module, size_t fn, AnalysisManager& analyses);
+    void construct(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        construct(module, fn, analyses);
+    }
+    void destruct(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        destruct(module, fn, analyses);
+    }
+
+    size_t phisInserted() const { return phiCount; }
+    size_t copiesInserted() const { return copyCount; }
+
+private:
+    size_t phiCount = 0;
+    size_t copyCount = 0;
+};
+
+// Drops phi inputs whose named predecessor no longer branches to the phi's
+// block, e.g. after a pass folded a conditional branch away.
+void removeStalePhiInputs(std::vector<TACInstruction>& code, uint32_t labelCount);
+
+// Whether the jump at code[jump] to the label at code[target], with only
+// labels in between, can be dropped. Each skipped label starts an empty
+// block that would become the target's predecessor, so it cannot when the
+// target's block starts with phis.
+bool fallsThroughTo(const TACInstruction* code, size_t size, size_t jump, size_t target);
+
+#endif
@@ -0,0 +1,214 @@
+#include "tac.h"
+#include "ir_generator.h"
+
+const uint32_t Operand::INDEX_BITS;
+const uint32_t Operand::INDEX_MASK;
+
+uint32_t IRSymbols::internName(const std::string& name) {
+    auto it = nameIndex.find(name);
+    if (it != nameIndex.end()) return it->second;
+    uint32_t index = static_cast<uint32_t>(names.size());
+    if (index > Operand::INDEX_MASK) throw IRException("Name pool overflow");
+    names.push_back(name);
+    nameIndex[name] = index;
+    return index;
+}
+
+bool IRSymbols::findName(const std::string& name, uint32_t& index) const {
+    auto it = nameIndex.find(name);
+    if (it == nameIndex.end()) return false;
+    index = it->second;
+    return true;
+}
+
+uint32_t IRSymbols::internConstant(const Value& value, const std::string& spelling) {
+    std::string key = std::to_string(value.type) + ":" + spelling;
+    auto it = constantIndex.find(key);
+    if (it != constantIndex.end()) return it->second;
+    uint32_t index = static_cast<uint32_t>(constants.size());
+    if (index > Operand::INDEX_MASK) throw IRException("Constant pool overflow");
+    constants.push_back(value);
+    constantSpellings.push_back(spelling);
+    constantIndex[key] = index;
+    return index;
+}
+
+uint32_t IRSymbols::internConstant(const Value& value) {
+    if (value.type == T_STRING) return internConstant(value, "\"" + value.s + "\"");
+    return internConstant(value, value.toString());
+}
+
+std::string IRSymbols::render(Operand operand) const {
+    switch (operand.kind()) {
+        case OperandKind::Temp: return "t" + std::to_string(operand.index());
+        case OperandKind::Label: return "L" + std::to_string(operand.index());
+        case OperandKind::Var:
+        case OperandKind::Func: return names[operand.index()];
+        case OperandKind::Const: return constantSpellings[operand.index()];
+        default: return "";
+    }
+}
+
+const char* opcodeSymbol(Opcode op) {
+    switch (op) {
+        case Opcode::Add: return "+";
+        case Opcode::Sub: return "-";
+        case Opcode::Mul: return "*";
+        case Opcode::Div: return "/";
+        case Opcode::Mod: return "%";
+        case Opcode::Eq: return "==";
+        case Opcode::Ne: return "!=";
+        case Opcode::Lt: return "<";
+        case Opcode::Gt: return ">";
+        case Opcode::Le: return "<=";
+        case Opcode::Ge: return ">=";
+        case Opcode::And: return "&&";
+        case Opcode::Or: return "||";
+        case Opcode::Not: return "!";
+        case Opcode::Neg: return "-";
+        case Opcode::Pos: return "+";
+        default: return "?";
+    }
+}
+
+bool isBinaryOpcode(Opcode op) {
+    return op >= Opcode::Add && op <= Opcode::Or;
+}
+
+bool isUnaryOpcode(Opcode op) {
+    return op == Opcode::Not || op == Opcode::Neg || op == Opcode::Pos;
+}
+
+bool isCommutative(Opcode op) {
+    return op == Opcode::Add || op == Opcode::Mul || op == Opcode::Eq ||
+           op == Opcode::Ne || op == Opcode::And || op == Opcode::Or;
+}
+
+bool isConditionalBranch(Opcode op) {
+    return op == Opcode::If || op == Opcode::IfFalse || isFusedBranch(op);
+}
+
+bool isFusedBranch(Opcode op) {
+    return op >= Opcode::IfEq && op <= Opcode::IfGe;
+}
+
+Opcode fusedBranchFor(Opcode comparison) {
+    return static_cast<Opcode>(static_cast<uint8_t>(Opcode::IfEq) +
+                               (static_cast<uint8_t>(comparison) - static_cast<uint8_t>(Opcode::Eq)));
+}
+
+Opcode comparisonOf(Opcode fusedBranch) {
+    return static_cast<Opcode>(static_cast<uint8_t>(Opcode::Eq) +
+                               (static_cast<uint8_t>(fusedBranch) - static_cast<uint8_t>(Opcode::IfEq)));
+}
+
+bool endsBlock(Opcode op) {
+    return op == Opcode::Goto || op == Opcode::Return || isConditionalBranch(op);
+}
+
+uint8_t useMask(const TACInstruction& instr) {
+    switch (instr.op) {
+        case Opcode::Copy:
+        case Opcode::Not:
+        case Opcode::Neg:
+        case Opcode::Pos:
+        case Opcode::If:
+        case Opcode::IfFalse:
+        case Opcode::Phi: return USE_ARG1;
+        case Opcode::Load:
+        case Opcode::IfEq:
+        case Opcode::IfNe:
+        case Opcode::IfLt:
+        case Opcode::IfGt:
+        case Opcode::IfLe:
+        case Opcode::IfGe: return USE_ARG1 | USE_ARG2;
+        case Opcode::Store: return USE_RESULT | USE_ARG1 | USE_ARG2;
+        case Opcode::Param:
+        case Opcode::Return: return USE_RESULT;
+        default: return isBinaryOpcode(instr.op) ? (USE_ARG1 | USE_ARG2) : 0;
+    }
+}
+
+bool mayTrap(const TACInstruction& instr, const IRSymbols& symbols) {
+    if (instr.op != Opcode::Div && instr.op != Opcode::Mod) return false;
+    if (instr.arg2.isConst() && symbols.constant(instr.arg2.index()).type == T_INT) {
+        int64_t divisor = symbols.constant(instr.arg2.index()).i;
+        return divisor == 0 || divisor == -1;
+    }
+    return instr.valueType() != T_FLOAT;
+}
+
+bool definesResult(const TACInstruction& instr) {
+    switch (instr.op) {
+        case Opcode::Copy:
+        case Opcode::Load:
+        case Opcode::Not:
+        case Opcode::Neg:
+        case Opcode::Pos:
+        case Opcode::Phi: return true;
+        case Opcode::Call: return !instr.result.empty();
+        default: return isBinaryOpcode(instr.op);
+    }
+}
+
+Opcode binaryOpcodeFor(const std::string& op) {
+    if (op == "+") return Opcode::Add;
+    if (op == "-") return Opcode::Sub;
+    if (op == "*") return Opcode::Mul;
+    if (op == "/") return Opcode::Div;
+    if (op == "%") return Opcode::Mod;
+    if (op == "==") return Opcode::Eq;
+    if (op == "!=") return Opcode::Ne;
+    if (op == "<") return Opcode::Lt;
+    if (op == ">") return Opcode::Gt;
+    if (op == "<=") return Opcode::Le;
+    if (op == ">=") return Opcode::Ge;
+    if (op == "&&") return Opcode::And;
+    if (op == "||") return Opcode::Or;
+    throw IRException("Unknown binary operator: " + op);
+}
+
+Value literalValue(const std::string& text, BasicType type) {
+    switch (type) {
+        case T_INT: return Value::makeInt(std::stoll(text));
+        case T_FLOAT: return Value::makeFloat(std::stod(text));
+        case T_BOOL: return Value::makeBool(text == "true");
+        default: return Value::makeString(text);
+    }
+}
+
+std::string TACInstruction::toString(const IRSymbols& symbols) const {
+    std::string r = symbols.render(result);
+    std::string a1 = symbols.render(arg1);
+    std::string a2 = symbols.render(arg2);
+
+    switch (op) {
+        case Opcode::Label: return r + ":";
+        case Opcode::Goto: return "    goto " + r;
+        case Opcode::If: return "    if " + a1 + " goto " + r;
+        case Opcode::IfFalse: return "    ifFalse " + a1 + " goto " + r;
+        case Opcode::Param: return "    param " + r;
+        case Opcode::Call:
+            if (!result.empty()) return "    " + r + " = call " + a1 + ", " + a2;
+            return "    call " + a1 + ", " + a2;
+        case Opcode::Return:
+            if (!result.empty()) return "    return " + r;
+            return "    return";
+        case Opcode::Copy: return "    " + r + " = " + a1;
+        case Opcode::Load: return "    " + r + " = " + a1 + "[" + a2 + "]";
+        case Opcode::Store: return "    " + r + "[" + a1 + "] = " + a2;
+        case Opcode::Phi: return "    " + r + " = phi " + a1 + " [" + a2 + "]";
+        case Opcode::Not:
+        case Opcode::Neg:
+        case Opcode::Pos: return "    " + r + " = " + opcodeSymbol(op) + a1;
+        case Opcode::IfEq:
+        case Opcode::IfNe:
+        case Opcode::IfLt:
+        case Opcode::IfGt:
+        case Opcode::IfLe:
+        case Opcode::IfGe:
+            return std::string(flags & BRANCH_IF_FALSE ? "    ifFalse " : "    if ") + a1 + " " +
+                   opcodeSymbol(comparisonOf(op)) + " " + a2 + " goto " + r;
+        default: return "    " + r + " = " + a1 + " " + opcodeSymbol(op) + " " + a2;
+    }
+}
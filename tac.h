@@ -0,0 +1,140 @@
+#ifndef TAC_H
+#define TAC_H
+
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+enum class Opcode : uint8_t {
+    Label,      // result: label
+    Goto,       // result: label
+    If,         // if arg1 goto result
+    IfFalse,    // ifFalse arg1 goto result
+    Param,      // result: call argument
+    Call,       // result = call arg1(func), arg2(argument count)
+    Return,     // result: value or none
+    Copy,       // result = arg1
+    Load,       // result = arg1[arg2]
+    Store,      // result[arg1] = arg2
+    Add, Sub, Mul, Div, Mod,
+    Eq, Ne, Lt, Gt, Le, Ge,
+    And, Or,
+    Not, Neg, Pos,
+    Phi,        // result = arg1 when control arrives from the block labelled arg2
+    IfEq, IfNe, IfLt, IfGt, IfLe, IfGe  // if arg1 <cmp> arg2 goto result
+};
+
+enum class OperandKind : uint8_t {
+    None,
+    Temp,
+    Var,
+    Const,
+    Label,
+    Func
+};
+
+// A 32-bit operand handle: 3-bit kind tag over a 29-bit index. Temps and
+// labels are numbered, vars and funcs index the name pool, consts index
+// the constant pool.
+struct Operand {
+    uint32_t bits;
+
+    static const uint32_t INDEX_BITS = 29;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    Operand() : bits(0) {}
+    Operand(OperandKind kind, uint32_t index)
+        : bits((static_cast<uint32_t>(kind) << INDEX_BITS) | (index & INDEX_MASK)) {}
+
+    static Operand temp(uint32_t n) { return Operand(OperandKind::Temp, n); }
+    static Operand var(uint32_t n) { return Operand(OperandKind::Var, n); }
+    static Operand constant(uint32_t n) { return Operand(OperandKind::Const, n); }
+    static Operand label(uint32_t n) { return Operand(OperandKind::Label, n); }
+    static Operand func(uint32_t n) { return Operand(OperandKind::Func, n); }
+
+    OperandKind kind() const { return static_cast<OperandKind>(bits >> INDEX_BITS); }
+    uint32_t index() const { return bits & INDEX_MASK; }
+    bool empty() const { return kind() == OperandKind::None; }
+    bool isTemp() const { return kind() == OperandKind::Temp; }
+    bool isVar() const { return kind() == OperandKind::Var; }
+    bool isConst() const { return kind() == OperandKind::Const; }
+    bool isLabel() const { return kind() == OperandKind::Label; }
+    bool isFunc() const { return kind() == OperandKind::Func; }
+
+    bool operator==(const Operand& o) const { return bits == o.bits; }
+    bool operator!=(const Operand& o) const { return bits != o.bits; }
+};
+
+// Name pool shared by variables and functions, and the constant pool.
+class IRSymbols {
+public:
+    uint32_t internName(const std::string& name);
+    const std::string& name(uint32_t index) const { return names[index]; }
+    bool findName(const std::string& name, uint32_t& index) const;
+    size_t nameCount() const { return names.size(); }
+
+    uint32_t internConstant(const Value& value, const std::string& spelling);
+    uint32_t internConstant(const Value& value);
+    const Value& constant(uint32_t index) const { return constants[index]; }
+    const std::string& constantText(uint32_t index) const { return constantSpellings[index]; }
+    size_t constantCount() const { return constants.size(); }
+
+    std::string render(Operand operand) const;
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameIndex;
+    std::vector<Value> constants;
+    std::vector<std::string> constantSpellings;
+    std::unordered_map<std::string, uint32_t> constantIndex;
+};
+
+// Instruction flags. A fused compare-and-branch with BRANCH_IF_FALSE jumps
+// when the comparison does not hold (`ifFalse a < b goto L`).
+enum : uint16_t { BRANCH_IF_FALSE = 1 };
+
+struct TACInstruction {
+    Opcode op;
+    uint8_t type;       // BasicType of the value produced, T_VOID if none
+    uint16_t flags;
+    Operand result;
+    Operand arg1;
+    Operand arg2;
+
+    TACInstruction(Opcode operation, Operand res = Operand(), Operand a1 = Operand(),
+                   Operand a2 = Operand(), BasicType t = T_VOID)
+        : op(operation), type(static_cast<uint8_t>(t)), flags(0), result(res), arg1(a1), arg2(a2) {}
+
+    BasicType valueType() const { return static_cast<BasicType>(type); }
+    std::string toString(const IRSymbols& symbols) const;
+};
+
+static_assert(sizeof(TACInstruction) == 16, "TACInstruction must stay 16 bytes");
+
+const char* opcodeSymbol(Opcode op);
+bool isBinaryOpcode(Opcode op);
+bool isUnaryOpcode(Opcode op);
+bool isCommutative(Opcode op);
+bool isConditionalBranch(Opcode op);
+bool isFusedBranch(Opcode op);
+Opcode fusedBranchFor(Opcode comparison);
+Opcode comparisonOf(Opcode fusedBranch);
+bool endsBlock(Opcode op);
+
+// Which operand slots an instruction reads, and whether it writes result.
+enum : uint8_t { USE_RESULT = 1, USE_ARG1 = 2, USE_ARG2 = 4 };
+uint8_t useMask(const TACInstruction& instr);
+bool definesResult(const TACInstruction& instr);
+// Integer division and remainder raise a run-time error unless the divisor
+// is a constant other than 0 and -1; passes must not delete or speculate
+// them.
+bool mayTrap(const TACInstruction& instr, const IRSymbols& symbols);
+inline bool isSymbol(Operand o) { return o.isTemp() || o.isVar(); }
+Opcode binaryOpcodeFor(const std::string& op);
+
+// Typed constant for a literal spelling, following TypeChecker's rules.
+Value literalValue(const std::string& text, BasicType type);
+
+#endif
@@ -0,0 +1,366 @@
+#include "tac_reader.h"
+#include "ir_generator.h"
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+bool isNumbered(const std::string& name, char prefix) {
+    if (name.size() < 2 || name[0] != prefix) return false;
+    for (size_t i = 1; i < name.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i]))) return false;
+    }
+    return true;
+}
+
+bool isComparison(const std::string& op) {
+    return op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=";
+}
+
+}
+
+void TACReader::fail(const std::string& message) const {
+    throw IRException("TAC line " + std::to_string(line) + ": " + message);
+}
+
+void TACReader::tokenize(const std::string& text) {
+    tokens.clear();
+    pos = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = i;
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_' || text[i] == '.'))
+                ++i;
+            tokens.push_back({Token::NAME, text.substr(start, i - start)});
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '-' && i + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[i + 1])) &&
+                    !tokens.empty() && tokens.back().kind == Token::PUNCT && tokens.back().text != "]")) {
+            // A '-' straight after an operator or '=' starts a negative constant.
+            size_t start = i++;
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '.' ||
+                                       ((text[i] == '+' || text[i] == '-') && (text[i - 1] == 'e' || text[i - 1] == 'E'))))
+                ++i;
+            tokens.push_back({Token::NUMBER, text.substr(start, i - start)});
+        } else if (c == '"') {
+            size_t end = text.find('"', i + 1);
+            if (end == std::string::npos) fail("unterminated string");
+            tokens.push_back({Token::STRING, text.substr(i + 1, end - i - 1)});
+            i = end + 1;
+        } else {
+            static const char* const twoChar[] = {"==", "!=", "<=", ">=", "&&", "||"};
+            std::string punct(1, c);
+            for (const char* op : twoChar) {
+                if (text.compare(i, 2, op) == 0) punct = op;
+            }
+            tokens.push_back({Token::PUNCT, punct});
+            i += punct.size();
+        }
+    }
+}
+
+const TACReader::Token& TACReader::peek(size_t ahead) const {
+    static const Token end = {Token::END, ""};
+    return pos + ahead < tokens.size() ? tokens[pos + ahead] : end;
+}
+
+bool TACReader::accept(const std::string& text) {
+    if (peek().kind == Token::END || peek().kind == Token::STRING || peek().text != text) return false;
+    ++pos;
+    return true;
+}
+
+void TACReader::expect(const std::string& text) {
+    if (!accept(text)) fail("expected '" + text + "'");
+}
+
+std::string TACReader::expectName() {
+    if (peek().kind != Token::NAME) fail("expected a name");
+    return tokens[pos++].text;
+}
+
+Operand TACReader::label() {
+    std::string name = expectName();
+    if (!isNumbered(name, 'L')) fail("expected a label, got " + name);
+    return Operand::label(static_cast<uint32_t>(std::stoul(name.substr(1))));
+}
+
+Operand TACReader::operand() {
+    IRSymbols& pool = module.symbols();
+    const Token& tok = peek();
+    switch (tok.kind) {
+        case Token::NUMBER: {
+            ++pos;
+            BasicType type = literalType(tok.text);
+            if (type != T_STRING) return Operand::constant(pool.internConstant(literalValue(tok.text, type), tok.text));
+            // Folded floats print in exponent form.
+            char* end = nullptr;
+            double f = std::strtod(tok.text.c_str(), &end);
+            if (*end != '\0') fail("malformed number " + tok.text);
+            return Operand::constant(pool.internConstant(Value::makeFloat(f), tok.text));
+        }
+        case Token::STRING:
+            ++pos;
+            return Operand::constant(pool.internConstant(Value::makeString(tok.text), "\"" + tok.text + "\""));
+        case Token::NAME: {
+            ++pos;
+            if (tok.text == "inf" || tok.text == "nan")
+                return Operand::constant(pool.internConstant(Value::makeFloat(std::strtod(tok.text.c_str(), nullptr)), tok.text));
+            if (tok.text == "true" || tok.text == "false")
+                return Operand::constant(pool.internConstant(Value::makeBool(tok.text == "true"), tok.text));
+            if (isNumbered(tok.text, 't')) return Operand::temp(static_cast<uint32_t>(std::stoul(tok.text.substr(1))));
+            if (isNumbered(tok.text, 'L')) return Operand::label(static_cast<uint32_t>(std::stoul(tok.text.substr(1))));
+            return Operand::var(pool.internName(tok.text));
+        }
+        default:
+            fail("expected an operand");
+    }
+}
+
+TACInstruction TACReader::instruction() {
+    std::string head = peek().kind == Token::NAME ? peek().text : "";
+
+    if (head == "goto") {
+        ++pos;
+        return TACInstruction(Opcode::Goto, label());
+    }
+    if (head == "if" || head == "ifFalse") {
+        ++pos;
+        Operand a = operand();
+        if (peek().kind == Token::PUNCT && isComparison(peek().text)) {
+            Opcode cmp = binaryOpcodeFor(tokens[pos++].text);
+            Operand b = operand();
+            expect("goto");
+            TACInstruction branch(fusedBranchFor(cmp), label(), a, b);
+            if (head == "ifFalse") branch.flags = BRANCH_IF_FALSE;
+            return branch;
+        }
+        expect("goto");
+        return TACInstruction(head == "if" ? Opcode::If : Opcode::IfFalse, label(), a);
+    }
+    if (head == "param") {
+        ++pos;
+        return TACInstruction(Opcode::Param, operand());
+    }
+    if (head == "return") {
+        ++pos;
+        if (peek().kind == Token::END) return TACInstruction(Opcode::Return);
+        return TACInstruction(Opcode::Return, operand());
+    }
+    if (head == "call" && peek(1).kind == Token::NAME) {
+        ++pos;
+        Operand func = Operand::func(module.symbols().internName(expectName()));
+        expect(",");
+        return TACInstruction(Opcode::Call, Operand(), func, operand());
+    }
+
+    Operand result = operand();
+    if (accept("[")) {
+        Operand index = operand();
+        expect("]");
+        expect("=");
+        return TACInstruction(Opcode::Store, result, index, operand());
+    }
+    expect("=");
+
+    if (peek().kind == Token::NAME && peek(1).kind == Token::NAME && peek().text == "call") {
+        ++pos;
+        Operand func = Operand::func(module.symbols().internName(expectName()));
+        expect(",");
+        return TACInstruction(Opcode::Call, result, func, operand());
+    }
+    if (peek().kind == Token::NAME && peek().text == "phi" && peek(1).kind != Token::END) {
+        ++pos;
+        Operand value = operand();
+        expect("[");
+        Operand pred = label();
+        expect("]");
+        return TACInstruction(Opcode::Phi, result, value, pred);
+    }
+    if (peek().kind == Token::PUNCT && (peek().text == "!" || peek().text == "-" || peek().text == "+")) {
+        const std::string& sign = tokens[pos++].text;
+        Opcode op = sign == "!" ? Opcode::Not : sign == "-" ? Opcode::Neg : Opcode::Pos;
+        return TACInstruction(op, result, operand());
+    }
+
+    Operand a = operand();
+    if (accept("[")) {
+        Operand index = operand();
+        expect("]");
+        return TACInstruction(Opcode::Load, result, a, index);
+    }
+    if (peek().kind == Token::PUNCT) {
+        Opcode op = binaryOpcodeFor(tokens[pos++].text);
+        return TACInstruction(op, result, a, operand());
+    }
+    return TACInstruction(Opcode::Copy, result, a);
+}
+
+IRModule TACReader::read(const std::string& text) {
+    module = IRModule();
+    functions.clear();
+
+    std::istringstream in(text);
+    std::string raw;
+    Function* current = nullptr;
+    line = 0;
+    while (std::getline(in, raw)) {
+        ++line;
+        size_t first = raw.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        size_t last = raw.find_last_not_of(" \t\r");
+        std::string stmt = raw.substr(first, last - first + 1);
+
+        if (!current) {
+            if (stmt.compare(0, 5, "func_") != 0 || stmt.back() != ':') fail("expected func_<name>:");
+            functions.push_back(Function{stmt.substr(5, stmt.size() - 6), {}, T_UNKNOWN, {}});
+            current = &functions.back();
+            continue;
+        }
+        if (stmt == "end_" + current->name + ":") {
+            current = nullptr;
+            continue;
+        }
+        if (stmt.back() == ':' && isNumbered(stmt.substr(0, stmt.size() - 1), 'L')) {
+            current->body.push_back(
+                TACInstruction(Opcode::Label, Operand::label(static_cast<uint32_t>(std::stoul(stmt.substr(1))))));
+            continue;
+        }
+        tokenize(stmt);
+        current->body.push_back(instruction());
+        if (peek().kind != Token::END) fail("unexpected '" + peek().text + "'");
+    }
+    if (current) fail("missing end_" + current->name + ":");
+
+    // Leading params are the function's own, except for a run that feeds
+    // the call right after it.
+    for (auto& f : functions) {
+        size_t run = 0;
+        while (run < f.body.size() && f.body[run].op == Opcode::Param) ++run;
+        size_t own = run;
+        if (run < f.body.size() && f.body[run].op == Opcode::Call && f.body[run].arg2.isConst()) {
+            const Value& argc = module.symbols().constant(f.body[run].arg2.index());
+            if (argc.type == T_INT && argc.i >= 0 && static_cast<size_t>(argc.i) <= run) own = run - argc.i;
+        }
+        for (size_t i = 0; i < own; ++i) {
+            if (!f.body[i].result.isVar()) fail("param of " + f.name + " is not a name");
+            f.params.push_back(IRParam{f.body[i].result.index(), T_UNKNOWN});
+        }
+        f.body.erase(f.body.begin(), f.body.begin() + own);
+    }
+
+    inferTypes();
+
+    for (auto& f : functions) {
+        size_t fn = module.addFunction(f.name, f.returnType, f.params);
+        module.append(f.body.data(), f.body.size());
+        uint32_t temps = 0, labels = 0;
+        bool ssa = false;
+        for (const auto& instr : f.body) {
+            for (Operand o : {instr.result, instr.arg1, instr.arg2}) {
+                if (o.isTemp()) temps = std::max(temps, o.index() + 1);
+                if (o.isLabel()) labels = std::max(labels, o.index() + 1);
+            }
+            ssa |= instr.op == Opcode::Phi;
+        }
+        module.setCounters(fn, temps, labels);
+        module.setSSA(fn, ssa);
+    }
+    IRModule result = std::move(module);
+    module = IRModule();
+    return result;
+}
+
+void TACReader::inferTypes() {
+    const IRSymbols& pool = module.symbols();
+    std::unordered_map<uint32_t, BasicType> returns;        // by function name index
+    std::vector<std::unordered_map<uint32_t, BasicType>> types(functions.size());
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t fn = 0; fn < functions.size(); ++fn) {
+            std::unordered_map<uint32_t, BasicType>& names = types[fn];
+            auto typeOf = [&](Operand o) -> BasicType {
+                if (o.isConst()) return pool.constant(o.index()).type;
+                auto it = names.find(o.bits);
+                return it == names.end() ? T_UNKNOWN : it->second;
+            };
+            auto assign = [&](Operand o, BasicType t) {
+                if (!isSymbol(o) || t == T_UNKNOWN || t == T_VOID || typeOf(o) != T_UNKNOWN) return;
+                names[o.bits] = t;
+                changed = true;
+            };
+            // Operands of arithmetic and comparisons take each other's type.
+            auto unify = [&](const TACInstruction& instr) {
+                BasicType a = typeOf(instr.arg1), b = typeOf(instr.arg2);
+                if (a == T_UNKNOWN && b != T_BOOL) assign(instr.arg1, b);
+                if (b == T_UNKNOWN && a != T_BOOL) assign(instr.arg2, a);
+            };
+
+            BasicType returnType = T_VOID;
+            for (auto& instr : functions[fn].body) {
+                Opcode op = instr.op;
+                BasicType t = T_VOID;
+                if (op >= Opcode::Add && op <= Opcode::Mod) {
+                    unify(instr);
+                    BasicType a = typeOf(instr.arg1), b = typeOf(instr.arg2);
+                    if (a == T_STRING && b == T_STRING) t = T_STRING;
+                    else if (a == T_FLOAT || b == T_FLOAT) t = T_FLOAT;
+                    else if (a == T_INT && b == T_INT) t = T_INT;
+                    else t = T_UNKNOWN;
+                } else if (op >= Opcode::Eq && op <= Opcode::Ge) {
+                    unify(instr);
+                    t = T_BOOL;
+                } else if (op == Opcode::And || op == Opcode::Or || op == Opcode::Not) {
+                    assign(instr.arg1, T_BOOL);
+                    assign(instr.arg2, T_BOOL);
+                    t = T_BOOL;
+                } else if (isFusedBranch(op)) {
+                    unify(instr);
+                } else if (op == Opcode::If || op == Opcode::IfFalse) {
+                    assign(instr.arg1, T_BOOL);
+                } else if (op == Opcode::Neg || op == Opcode::Pos || op == Opcode::Copy || op == Opcode::Phi) {
+                    assign(instr.result, typeOf(instr.arg1));
+                    assign(instr.arg1, typeOf(instr.result));
+                    t = typeOf(instr.result);
+                } else if (op == Opcode::Load) {
+                    t = typeOf(instr.result);
+                } else if (op == Opcode::Call) {
+                    auto it = returns.find(instr.arg1.index());
+                    BasicType r = it == returns.end() ? T_UNKNOWN : it->second;
+                    if (!instr.result.empty()) {
+                        assign(instr.result, r);
+                        t = r;
+                    }
+                } else if (op == Opcode::Param) {
+                    t = typeOf(instr.result);
+                } else if (op == Opcode::Return && !instr.result.empty()) {
+                    t = typeOf(instr.result);
+                    if (returnType == T_VOID || returnType == T_UNKNOWN) returnType = t;
+                }
+                if (definesResult(instr)) assign(instr.result, t);
+                instr.type = static_cast<uint8_t>(t);
+            }
+
+            if (functions[fn].returnType != returnType) {
+                functions[fn].returnType = returnType;
+                uint32_t name;
+                if (pool.findName(functions[fn].name, name)) returns[name] = returnType;
+                changed = true;
+            }
+        }
+    }
+
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        for (auto& p : functions[fn].params) {
+            auto it = types[fn].find(Operand::var(p.name).bits);
+            if (it != types[fn].end()) p.type = it->second;
+        }
+    }
+}
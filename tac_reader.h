@@ -0,0 +1,53 @@
+#ifndef TAC_READER_H
+#define TAC_READER_H
+
+#include "ir_module.h"
+#include <string>
+#include <vector>
+
+// Reads IR back from the syntax IRModule::print writes. `tN` and `LN` are
+// temps and labels, other names are vars, and `call f, n` names a
+// function. Function params are the leading `param` lines, less those that
+// feed a call right after them.
+//
+// The printed form has no types, so they are inferred the way IRGenerator
+// assigns them: from constants, through arithmetic in both directions
+// (`a + 1` makes a an int), and from callees' returns across the module.
+// Names nothing constrains stay T_UNKNOWN. Errors are IRExceptions that
+// carry the line number.
+class TACReader {
+public:
+    IRModule read(const std::string& text);
+
+private:
+    struct Token {
+        enum Kind { NAME, NUMBER, STRING, PUNCT, END } kind;
+        std::string text;
+    };
+
+    struct Function {
+        std::string name;
+        std::vector<IRParam> params;
+        BasicType returnType;
+        std::vector<TACInstruction> body;
+    };
+
+    IRModule module;
+    std::vector<Function> functions;
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    size_t line = 0;
+
+    void tokenize(const std::string& text);
+    const Token& peek(size_t ahead = 0) const;
+    bool accept(const std::string& punct);
+    void expect(const std::string& text);
+    std::string expectName();
+    Operand operand();
+    Operand label();
+    TACInstruction instruction();
+    void inferTypes();
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#!/bin/sh
+# Runs every program in tests/regress. Each <name>.txt has its cases in
+# <name>.cases, one per line; lines starting with # are comments.
+#
+#     <function> <args...> = <result>
+#         Run at -O0, -O1, -O2 and under the JIT. <result> is the printed
+#         value, or `error` for a run the VM stops.
+#     check <flags...> [=> <text>]
+#         Run the compiler with these flags; it must succeed, report no
+#         mismatches and, when given, print <text> somewhere.
+#     asm <function> <args...> = <output>
+#         Build the function with --emit-asm at -O0 and -O2, assemble it
+#         with cc and run it with these command-line arguments. <output>
+#         is what it prints, or `error` for a nonzero exit.
+#
+# Every program is also put through the differential harnesses of the JIT
+# (--diff-test) and the C backend (--c-test) at -O0 and -O2.
+# Usage: tests/run_regressions.sh <compiler>
+
+compiler=${1:?usage: $0 <compiler>}
+dir=$(dirname "$0")/regress
+log=$(mktemp)
+work=$(mktemp -d)
+
+# Runs the compiler on a program and records whether the output passes.
+check() {
+    program=$1 flags=$2 want=$3
+    output=$("$compiler" "$program" $flags 2>&1)
+    status=$?
+    if [ $status -ne 0 ] || echo "$output" | grep -q ' [1-9][0-9]* mismatches' ||
+       { [ -n "$want" ] && ! echo "$output" | grep -qF -- "$want"; }; then
+        echo "FAIL $(basename "$program") $flags${want:+ => $want}" >> "$log"
+        echo "$output" | grep -E 'ERROR|mismatch' | head -5 | sed 's/^/    /' >> "$log"
+    else
+        echo pass >> "$log"
+    fi
+}
+
+for program in "$dir"/*.txt; do
+    grep -v '^#' "${program%.txt}.cases" | grep . | while read -r line; do
+        case "$line" in
+            check\ *)
+                spec=${line#check }
+                want=
+                case "$spec" in *" => "*) want=${spec#* => } ;; esac
+                check "$program" "${spec%% => *}" "$want"
+                continue
+                ;;
+            asm\ *)
+                spec=${line#asm }
+                call=$(echo ${spec%%=*})
+                expected=$(echo ${spec#*=})
+                fn=${call%% *}
+                for level in -O0 -O2; do
+                    rm -f "$work/prog"
+                    "$compiler" "$program" $level --entry $fn --emit-asm "$work/prog.s" > /dev/null 2>&1 &&
+                        cc "$work/prog.s" -o "$work/prog" 2> /dev/null
+                    if [ ! -x "$work/prog" ]; then
+                        actual="no program"
+                    elif ! actual=$("$work/prog" ${call#"$fn"}); then
+                        actual=error
+                    fi
+                    if [ "$actual" != "$expected" ]; then
+                        echo "FAIL $(basename "$program") asm $level: $call gave '${actual}', expected '$expected'" >> "$log"
+                    else
+                        echo pass >> "$log"
+                    fi
+                done
+                continue
+                ;;
+        esac
+        call=$(echo ${line%%=*})
+        expected=$(echo ${line#*=})
+        fn=${call%% *}
+        for mode in -O0 -O1 -O2 "-O2 --jit"; do
+            output=$("$compiler" "$program" $mode --run $call 2>&1)
+            actual=$(echo "$output" | sed -n "s/^$fn(.*) = \([^ ]*\)  \[.*/\1/p")
+            [ -z "$actual" ] && echo "$output" | grep -q '^\[ERROR\]' && actual=error
+            if [ "$actual" != "$expected" ]; then
+                echo "FAIL $(basename "$program") $mode: $call gave '${actual}', expected '$expected'" >> "$log"
+            else
+                echo pass >> "$log"
+            fi
+        done
+    done
+    for level in -O0 -O2; do
+        check "$program" "$level --diff-test" "Differential test:"
+        check "$program" "$level --c-test" "C backend test:"
+    done
+done
+
+grep -v '^pass$' "$log"
+failures=$(grep -c '^FAIL' "$log")
+echo "$(grep -c -e '^pass$' -e '^FAIL' "$log") cases, $failures failed"
+rm -rf "$log" "$work"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,125 @@
+#include "tiered.h"
+#include <chrono>
+#include <iomanip>
+
+namespace {
+
+// The compiler's copy needs no interpreter stack.
+BytecodeVM lowerForCompiler(const IRModule& module) {
+    BytecodeVM lowered(0);
+    lowered.load(module);
+    return lowered;
+}
+
+}
+
+TieredRuntime::TieredRuntime(const IRModule& module, uint64_t threshold)
+    : compileSource(lowerForCompiler(module)), jit(compileSource) {
+    vm.load(module);
+
+    size_t count = vm.functionCount();
+    ready.reset(new std::atomic<bool>[count]);
+    for (size_t fn = 0; fn < count; ++fn) ready[fn].store(false);
+    nativeCalls.assign(count, 0);
+    queued.assign(count, 0);
+    compileNanos.assign(count, 0);
+    failures.assign(count, "");
+    vm.setTierListener(this, threshold);
+    compiler = std::thread(&TieredRuntime::compileLoop, this);
+}
+
+TieredRuntime::~TieredRuntime() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    compiler.join();
+}
+
+void TieredRuntime::hot(size_t fn) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (queued[fn]) return;
+        queued[fn] = 1;
+        queue.push_back(fn);
+    }
+    wake.notify_one();
+}
+
+// Runs on the compiler thread. A compile publishes every function it made
+// native, callees included.
+void TieredRuntime::compileLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        wake.wait(guard, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+        size_t fn = queue.front();
+        queue.pop_front();
+        busy = true;
+        guard.unlock();
+
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            jit.compile(fn);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        guard.lock();
+        compileNanos[fn] = static_cast<uint64_t>(elapsed.count());
+        failures[fn] = error;
+        codeBytes = jit.codeBytes();
+        for (size_t g = 0; g < compileSource.functionCount(); ++g) {
+            if (jit.compiled(g) && !ready[g].load(std::memory_order_relaxed)) {
+                queued[g] = 1;
+                ready[g].store(true, std::memory_order_release);
+            }
+        }
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+void TieredRuntime::waitForCompiler() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this] { return queue.empty() && !busy; });
+}
+
+Value TieredRuntime::call(const std::string& name, const std::vector<Value>& args) {
+    size_t fn;
+    if (!vm.findFunction(name, fn)) throw VMException("No function named " + name);
+    return call(fn, args);
+}
+
+Value TieredRuntime::call(size_t fn, const std::vector<Value>& args) {
+    if (!isNative(fn)) return vm.call(fn, args);
+    const BytecodeFunction& f = vm.function(fn);
+    if (args.size() != f.paramTypes.size()) {
+        throw VMException(f.name + " takes " + std::to_string(f.paramTypes.size()) + " arguments, got " +
+                          std::to_string(args.size()));
+    }
+    std::vector<VMSlot> slots;
+    for (size_t i = 0; i < args.size(); ++i) slots.push_back(toSlot(args[i], f.paramTypes[i]));
+    ++nativeCalls[fn];
+    return fromSlot(jit.invoke(fn, slots.data()), f.returnType);
+}
+
+void TieredRuntime::printStatistics(std::ostream& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    out << std::left << std::setw(20) << "function" << std::right << std::setw(12) << "calls" << std::setw(12)
+        << "back edges" << std::setw(12) << "native" << "  tier\n";
+    for (size_t fn = 0; fn < vm.functionCount(); ++fn) {
+        out << std::left << std::setw(20) << vm.function(fn).name << std::right << std::setw(12)
+            << vm.callCount(fn) << std::setw(12) << vm.backEdgeCount(fn) << std::setw(12)
+            << nativeCalls[fn] << "  ";
+        if (!failures[fn].empty()) out << "interpreted (" << failures[fn] << ")";
+        else if (isNative(fn) && compileNanos[fn]) out << "native, compiled in " << compileNanos[fn] / 1000 << " us";
+        else if (isNative(fn)) out << "native, compiled with a caller";
+        else out << "interpreted";
+        out << "\n";
+    }
+    out << "Machine code: " << codeBytes << " bytes\n";
+}
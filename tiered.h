@@ -0,0 +1,75 @@
+#ifndef TIERED_H
+#define TIERED_H
+
+#include "bytecode_vm.h"
+#include "jit.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tiered execution of a module. Functions start in the bytecode
+// interpreter, which counts their calls and loop back edges. A function
+// whose count reaches the threshold is queued for a background thread that
+// JIT-compiles it along with everything it calls; interpreted call sites to
+// a compiled function are then patched to enter its native code, and calls
+// from outside go straight to it. There is no on-stack replacement: an
+// activation already running in the interpreter finishes there. Functions
+// the JIT rejects stay interpreted.
+//
+// The compiler thread reads its own lowered copy of the module, so the
+// interpreter's code can be patched while it works.
+class TieredRuntime : private VMTierListener {
+public:
+    static const uint64_t DEFAULT_THRESHOLD = 1000;
+
+    explicit TieredRuntime(const IRModule& module, uint64_t threshold = DEFAULT_THRESHOLD);
+    ~TieredRuntime();
+    TieredRuntime(const TieredRuntime&) = delete;
+    TieredRuntime& operator=(const TieredRuntime&) = delete;
+
+    Value call(size_t fn, const std::vector<Value>& args);
+    Value call(const std::string& name, const std::vector<Value>& args);
+
+    // Blocks until every queued function has been compiled.
+    void waitForCompiler();
+    bool isNative(size_t fn) const { return ready[fn].load(std::memory_order_acquire); }
+    const BytecodeVM& interpreter() const { return vm; }
+
+    // Per function: calls and back edges seen by the interpreter, calls
+    // entered natively from call(), tier and compile time.
+    void printStatistics(std::ostream& out);
+
+private:
+    BytecodeVM vm;
+    BytecodeVM compileSource;
+    JIT jit;
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    std::vector<uint64_t> nativeCalls;          // entered from call()
+
+    // Shared with the compiler thread.
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<size_t> queue;
+    std::vector<char> queued;
+    std::vector<uint64_t> compileNanos;
+    std::vector<std::string> failures;
+    size_t codeBytes = 0;
+    bool busy = false;
+    bool stopping = false;
+    std::thread compiler;
+
+    void compileLoop();
+
+    void hot(size_t fn) override;
+    bool hasNative(size_t fn) override { return isNative(fn); }
+    VMSlot callNative(size_t fn, const VMSlot* args) override { return jit.invoke(fn, args); }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "type_checker.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <functional>
+
+// A runtime value as seen by executors of the IR. Bools live in `i`.
+struct Value {
+    BasicType type;
+    int64_t i;
+    double f;
+    std::string s;
+
+    Value() : type(T_VOID), i(0), f(0.0) {}
+
+    static Value makeInt(int64_t v) { Value r; r.type = T_INT; r.i = v; return r; }
+    static Value makeFloat(double v) { Value r; r.type = T_FLOAT; r.f = v; return r; }
+    static Value makeBool(bool v) { Value r; r.type = T_BOOL; r.i = v ? 1 : 0; return r; }
+    static Value makeString(std::string v) { Value r; r.type = T_STRING; r.s = std::move(v); return r; }
+
+    bool operator==(const Value& o) const {
+        if (type != o.type) return false;
+        switch (type) {
+            case T_INT: case T_BOOL: return i == o.i;
+            case T_FLOAT: return f == o.f;
+            case T_STRING: return s == o.s;
+            default: return true;
+        }
+    }
+    bool operator!=(const Value& o) const { return !(*this == o); }
+
+    size_t hash() const {
+        size_t h = std::hash<int>()(type);
+        switch (type) {
+            case T_INT: case T_BOOL: h ^= std::hash<int64_t>()(i) + 0x9e3779b97f4a7c15ULL + (h << 6); break;
+            case T_FLOAT: h ^= std::hash<double>()(f) + 0x9e3779b97f4a7c15ULL + (h << 6); break;
+            case T_STRING: h ^= std::hash<std::string>()(s) + 0x9e3779b97f4a7c15ULL + (h << 6); break;
+            default: break;
+        }
+        return h;
+    }
+
+    std::string toString() const {
+        switch (type) {
+            case T_INT: return std::to_string(i);
+            case T_FLOAT: {
+                char buf[32];
+                std::snprintf(buf, sizeof(buf), "%.15g", f);
+                if (std::strtod(buf, nullptr) != f) std::snprintf(buf, sizeof(buf), "%.17g", f);
+                std::string r = buf;
+                if (r.find_first_of(".eni") == std::string::npos) r += ".0";
+                return r;
+            }
+            case T_BOOL: return i ? "true" : "false";
+            case T_STRING: return s;
+            default: return "void";
+        }
+    }
+};
+
+// Float to int conversion as every executor performs it: truncation, with
+// NaN and out-of-range values giving INT64_MIN as x86-64's cvttsd2si does
+// (a plain cast of those is undefined).
+inline int64_t floatToInt(double x) {
+    if (!(x >= -9223372036854775808.0 && x < 9223372036854775808.0)) return INT64_MIN;
+    return static_cast<int64_t>(x);
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "value_numbering.h"
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+struct ExprKey {
+    uint8_t op;
+    uint8_t type;
+    uint32_t a;
+    uint32_t b;
+
+    bool operator==(const ExprKey& o) const {
+        return op == o.op && type == o.type && a == o.a && b == o.b;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& k) const {
+        uint64_t h = (static_cast<uint64_t>(k.op) << 8) | k.type;
+        h = h * 0x9E3779B97F4A7C15ull ^ k.a;
+        h = h * 0x9E3779B97F4A7C15ull ^ k.b;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+bool isNumberable(const TACInstruction& instr) {
+    return isBinaryOpcode(instr.op) || isUnaryOpcode(instr.op);
+}
+
+// Value numbers per operand. Constants and names seen before their
+// definition (params, phi results) get a fresh number on first use.
+class Numbering {
+public:
+    uint32_t of(Operand o) {
+        if (o.empty()) return 0;
+        auto it = numbers.find(o.bits);
+        if (it != numbers.end()) return it->second;
+        uint32_t n = fresh();
+        numbers.emplace(o.bits, n);
+        return n;
+    }
+    void set(Operand o, uint32_t n) { numbers[o.bits] = n; }
+    uint32_t fresh() { return ++last; }
+    void clear() { numbers.clear(); }
+
+private:
+    std::unordered_map<uint32_t, uint32_t> numbers;
+    uint32_t last = 0;
+};
+
+ExprKey keyFor(const TACInstruction& instr, Numbering& vn) {
+    Opcode op = instr.op;
+    uint32_t a = vn.of(instr.arg1);
+    uint32_t b = vn.of(instr.arg2);
+    if (op == Opcode::Gt) { op = Opcode::Lt; std::swap(a, b); }
+    else if (op == Opcode::Ge) { op = Opcode::Le; std::swap(a, b); }
+    // String + concatenates and is not commutative.
+    else if (isCommutative(op) && instr.type != T_STRING && a > b) std::swap(a, b);
+    return ExprKey{static_cast<uint8_t>(op), instr.type, a, b};
+}
+
+}
+
+bool ValueNumbering::run(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    if (module.function(fn).ssa) return runDominatorScoped(module, fn, analyses);
+    return runLocal(module, fn, analyses);
+}
+
+bool ValueNumbering::runDominatorScoped(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> code = module.code(fn);
+    const CFG& cfg = analyses.cfg(fn);
+
+    Numbering vn;
+    std::unordered_map<ExprKey, Operand, ExprKeyHash> available;
+    std::vector<ExprKey> scopeLog;
+    std::unordered_map<uint32_t, Operand> replacement;
+    std::vector<char> removed(code.size(), 0);
+
+    // Preorder walk of the dominator tree; entries made in a block are
+    // popped when its subtree is done.
+    struct Frame { uint32_t block; uint32_t child; size_t logMark; };
+    std::vector<Frame> stack;
+    if (cfg.size() > 0) stack.push_back(Frame{0, 0, 0});
+    bool entering = true;
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        if (entering) {
+            top.logMark = scopeLog.size();
+            const BasicBlock& bb = cfg.block(top.block);
+            for (uint32_t i = bb.begin; i < bb.end; ++i) {
+                const TACInstruction& instr = code[i];
+                if (!definesResult(instr)) continue;
+                if (instr.op == Opcode::Copy) {
+                    vn.set(instr.result, vn.of(instr.arg1));
+                } else if (instr.op == Opcode::Phi) {
+                    vn.of(instr.result);
+                } else if (isNumberable(instr)) {
+                    ExprKey key = keyFor(instr, vn);
+                    auto it = available.find(key);
+                    if (it != available.end()) {
+                        replacement[instr.result.bits] = it->second;
+                        vn.set(instr.result, vn.of(it->second));
+                        removed[i] = 1;
+                        ++redundantCount;
+                    } else {
+                        available.emplace(key, instr.result);
+                        scopeLog.push_back(key);
+                        vn.set(instr.result, vn.fresh());
+                    }
+                } else {
+                    vn.set(instr.result, vn.fresh());
+                }
+            }
+        }
+        Span<const uint32_t> children = cfg.domChildren(top.block);
+        if (top.child < children.size()) {
+            uint32_t next = children[top.child++];
+            stack.push_back(Frame{next, 0, 0});
+            entering = true;
+            continue;
+        }
+        while (scopeLog.size() > top.logMark) {
+            available.erase(scopeLog.back());
+            scopeLog.pop_back();
+        }
+        stack.pop_back();
+        entering = false;
+    }
+
+    if (replacement.empty()) return false;
+
+    auto rewrite = [&](Operand& o) {
+        auto it = replacement.find(o.bits);
+        if (it != replacement.end()) o = it->second;
+    };
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        if (removed[i]) continue;
+        TACInstruction instr = code[i];
+        uint8_t mask = instr.op == Opcode::Phi ? static_cast<uint8_t>(USE_ARG1) : useMask(instr);
+        if (mask & USE_RESULT) rewrite(instr.result);
+        if (mask & USE_ARG1) rewrite(instr.arg1);
+        if (mask & USE_ARG2) rewrite(instr.arg2);
+        out.push_back(instr);
+    }
+    module.replaceCode(fn, out);
+    return true;
+}
+
+bool ValueNumbering::runLocal(IRModule& module, size_t fn, AnalysisManager& analyses) {
+    Span<const TACInstruction> code = module.code(fn);
+    const CFG& cfg = analyses.cfg(fn);
+
+    // An entry remembers the number its result had when it was made; if
+    // the name has been reassigned since, the entry is stale.
+    struct Entry { Operand result; uint32_t number; };
+    Numbering vn;
+    std::unordered_map<ExprKey, Entry, ExprKeyHash> available;
+    std::vector<TACInstruction> out(code.begin(), code.end());
+    bool changed = false;
+
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        vn.clear();
+        available.clear();
+        const BasicBlock& bb = cfg.block(b);
+        for (uint32_t i = bb.begin; i < bb.end; ++i) {
+            TACInstruction& instr = out[i];
+            if (!definesResult(instr)) continue;
+            if (instr.op == Opcode::Copy) {
+                vn.set(instr.result, vn.of(instr.arg1));
+                continue;
+            }
+            if (!isNumberable(instr)) {
+                vn.set(instr.result, vn.fresh());
+                continue;
+            }
+            ExprKey key = keyFor(instr, vn);
+            auto it = available.find(key);
+            if (it != available.end() && vn.of(it->second.result) == it->second.number) {
+                Operand earlier = it->second.result;
+                instr = TACInstruction(Opcode::Copy, instr.result, earlier, Operand(), instr.valueType());
+                vn.set(instr.result, it->second.number);
+                ++redundantCount;
+                changed = true;
+                continue;
+            }
+            uint32_t n = vn.fresh();
+            vn.set(instr.result, n);
+            available[key] = Entry{instr.result, n};
+        }
+    }
+
+    if (changed) module.replaceCode(fn, out);
+    return changed;
+}
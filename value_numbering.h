@@ -0,0 +1,32 @@
+#ifndef VALUE_NUMBERING_H
+#define VALUE_NUMBERING_H
+
+#include "analysis_manager.h"
+#include <cstddef>
+
+// Value numbering of pure unary and binary operations. Operands of
+// commutative operators are ordered canonically and `a > b` is keyed as
+// `b < a`, so either spelling finds the earlier result.
+//
+// In SSA form the table is scoped over the dominator tree: a redundant
+// computation is deleted and its uses read the dominating result. Outside
+// SSA form numbering is local to each block and the redundant instruction
+// becomes a copy of the earlier result (copy propagation removes it).
+class ValueNumbering {
+public:
+    bool run(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool run(IRModule& module, size_t fn) {
+        AnalysisManager analyses(module);
+        return run(module, fn, analyses);
+    }
+
+    size_t redundant() const { return redundantCount; }
+
+private:
+    size_t redundantCount = 0;
+
+    bool runDominatorScoped(IRModule& module, size_t fn, AnalysisManager& analyses);
+    bool runLocal(IRModule& module, size_t fn, AnalysisManager& analyses);
+};
+
+#endif